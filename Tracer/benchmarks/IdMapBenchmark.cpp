@@ -0,0 +1,101 @@
+/*
+ *  IdMapBenchmark.cpp
+ *  LPTracer
+ *
+ *  http://www.logicpoet.com
+ *
+ *  Copyright 2008 Logic Poet. All rights reserved.
+ *
+ *  The MIT License
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without
+ *  restriction, including without limitation the rights to use,
+ *  copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following
+ *  conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *  OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+//Measures the per-mark cost of looking up a trace id as a function of the
+//number of live traces, comparing the std::map the Tracer used to keep with
+//the open addressing IdMap.  Each lookup is followed, every so often, by a 
+//retire/register pair to mimic payloads being recycled.
+//
+//This does not need SystemC.  Build and run with:
+//  g++ -O2 -I../source IdMapBenchmark.cpp -o IdMapBenchmark && ./IdMapBenchmark
+
+#include "IdMap.h"
+#include <map>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+using lpt::IdMap;
+
+struct Payload{ char data[64]; };
+
+static double seconds(){
+    return (double)clock() / CLOCKS_PER_SEC;
+}
+
+int main(){
+    const int lookups = 10000000;
+    printf("%12s %14s %14s\n", "live traces", "std::map ns", "IdMap ns");
+    for (int live = 16; live <= (1 << 20); live *= 4){
+        //Scatter the payloads across the heap like a real memory manager would
+        vector<Payload *> payloads(live);
+        for (int i = 0; i < live; i++) payloads[i] = new Payload;
+        vector<int> order(live * 4);
+        for (size_t i = 0; i < order.size(); i++) order[i] = rand() % live;
+
+        std::map<Payload *, int> treeMap;
+        IdMap<Payload *, int> hashMap;
+        for (int i = 0; i < live; i++){
+            treeMap[payloads[i]] = i+1;
+            hashMap.insert(payloads[i], i+1);
+        }
+
+        long long sum = 0;
+        double start = seconds();
+        for (int i = 0; i < lookups; i++){
+            Payload *p = payloads[order[i % order.size()]];
+            std::map<Payload *, int>::iterator iter = treeMap.find(p);
+            sum += iter->second;
+            if ((i & 15) == 0){
+                treeMap.erase(iter);
+                treeMap[p] = i;
+            }
+        }
+        double treeTime = seconds() - start;
+
+        start = seconds();
+        for (int i = 0; i < lookups; i++){
+            Payload *p = payloads[order[i % order.size()]];
+            sum += *hashMap.find(p);
+            if ((i & 15) == 0){
+                hashMap.erase(p);
+                hashMap.insert(p, i);
+            }
+        }
+        double hashTime = seconds() - start;
+
+        printf("%12d %14.1f %14.1f\n", live, treeTime * 1e9 / lookups, hashTime * 1e9 / lookups);
+        if (sum == 42) printf(" ");     //Keep the loops from being optimized away
+        for (int i = 0; i < live; i++) delete payloads[i];
+    }
+    return 0;
+}
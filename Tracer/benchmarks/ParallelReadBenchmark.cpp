@@ -0,0 +1,155 @@
+/*
+ *  ParallelReadBenchmark.cpp
+ *  LPTracer
+ *
+ *  http://www.logicpoet.com
+ *
+ *  Copyright 2008 Logic Poet. All rights reserved.
+ *
+ *  The MIT License
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without
+ *  restriction, including without limitation the rights to use,
+ *  copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following
+ *  conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *  OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+//Measures how parsing a large XML trace scales with the number of threads.
+//Writes a synthetic trace in the format XmlTraceWriter produces (a few
+//thousand live traces, four properties per event), then reads it once with
+//TraceReader and once with ParallelTraceReader for each thread count.  A
+//binary trace can be passed on the command line instead; it needs its index
+//file to be read on more than one thread.
+//
+//Speedups are only meaningful up to the number of cores, which is printed
+//first.  So far this has only been run on a single core machine, where it
+//shows the overhead of chunking (none measurable) but not the scaling, which
+//is still to be measured on a machine with 8 to 32 cores.
+//
+//This does not need SystemC.  Build and run with:
+//  g++ -O2 -I../source -I../reader ParallelReadBenchmark.cpp ../reader/TraceReader.cpp ../reader/IndexReader.cpp ../reader/ParallelTraceReader.cpp -lpthread -o ParallelReadBenchmark && ./ParallelReadBenchmark [tracefile]
+
+#include "ParallelTraceReader.h"
+#include <cstdio>
+#include <cstdlib>
+#include <sys/time.h>
+#include <unistd.h>
+
+using namespace lpt;
+
+static double seconds(){
+    //Wall clock time, clock() adds up the time of all threads
+    struct timeval now;
+    gettimeofday(&now, 0);
+    return now.tv_sec + now.tv_usec * 1e-6;
+}
+
+static void writeTrace(const char *filename, int events){
+    FILE *out = fopen(filename, "w");
+    if (!out){
+        printf("Cannot write %s\n", filename);
+        exit(1);
+    }
+    fprintf(out, "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n");
+    fprintf(out, "<document resolution=\"1e-12\">\n");
+    fprintf(out, "<module id=\"M1\" name=\"top\">\n</module>\n");
+    fprintf(out, "<eventtype id=\"E1\" name=\"Request\">\n</eventtype>\n");
+    fprintf(out, "<eventtype id=\"E2\" name=\"Response\">\n</eventtype>\n");
+    const int live = 4096;
+    for (int i = 0; i < events; i++){
+        int trace = i / 2 + 1;
+        if (i % 2 == 0){
+            fprintf(out, "<trace id=\"T%d\" name=\"T%d\">\n", trace, trace);
+            fprintf(out, "<property name=\"Command\" value=\"%s\"/>\n", (rand() & 1) ? "Read" : "Write");
+            fprintf(out, "<property name=\"Adress\" value=\"0x%X\"/>\n", rand() & 0xFFFF);
+            fprintf(out, "</trace>\n");
+        }
+        fprintf(out, "<event type=\"E%d\" trace=\"T%d\" module=\"M1\" time=\"%llu\">\n", i % 2 + 1, (trace > live) ? trace - rand() % live : trace, i * 1000ULL);
+        fprintf(out, "<property name=\"Response Status\" value=\"TLM_OK_RESPONSE\"/>\n");
+        fprintf(out, "<property name=\"Data Length\" value=\"4\"/>\n");
+        fprintf(out, "<property name=\"Streaming Width\" value=\"4\"/>\n");
+        fprintf(out, "<property name=\"Data\" value=\"0x%08X\"/>\n", rand());
+        fprintf(out, "</event>\n");
+    }
+    fprintf(out, "</document>\n");
+    fclose(out);
+}
+
+//Does a little work per record so the loop isn't optimized away
+class CountingVisitor : public ChunkVisitor{
+public:
+    unsigned long long events;
+    unsigned long long properties;
+    CountingVisitor(){ events = properties = 0; }
+    virtual void visit(const TraceRecord &record, TraceReader &){
+        if (record.kind != RECORD_EVENT) return;
+        events++;
+        properties += record.properties.size();
+    }
+};
+
+int main(int argc, char **argv){
+    string filename;
+    if (argc > 1){
+        filename = argv[1];
+    }
+    else {
+        filename = "ParallelReadBenchmark.scnx";
+        printf("Writing %s\n", filename.c_str());
+        writeTrace(filename.c_str(), 2000000);
+    }
+
+    TraceReader reader;
+    if (!reader.open(filename)){
+        printf("%s\n", reader.getError().c_str());
+        return 1;
+    }
+    CountingVisitor sequential;
+    double start = seconds();
+    TraceRecord record;
+    while (reader.next(record)) sequential.visit(record, reader);
+    double baseline = seconds() - start;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    printf("%ld cores online%s\n", cores, (cores < 32) ? ", speedups past that only show overhead" : "");
+    printf("%8s %8s %10s %10s %8s\n", "threads", "chunks", "seconds", "MB/s", "speedup");
+    double megabytes = reader.getSize() / 1e6;
+    printf("%8s %8d %10.3f %10.1f %8.2f\n", "seq", 1, baseline, megabytes / baseline, 1.0);
+
+    for (unsigned int threads = 1; threads <= 32; threads *= 2){
+        ParallelTraceReader parallel;
+        start = seconds();
+        if (!parallel.open(filename, threads)){
+            printf("%s\n", parallel.getError().c_str());
+            return 1;
+        }
+        vector<CountingVisitor> counters(threads);
+        vector<ChunkVisitor *> visitors;
+        for (unsigned int i = 0; i < threads; i++) visitors.push_back(&counters[i]);
+        parallel.read(visitors);
+        double elapsed = seconds() - start;
+        unsigned long long events = 0;
+        for (unsigned int i = 0; i < threads; i++) events += counters[i].events;
+        if (events != sequential.events){
+            printf("Parallel read found %llu events, expected %llu\n", events, sequential.events);
+            return 1;
+        }
+        printf("%8u %8u %10.3f %10.1f %8.2f\n", threads, parallel.getChunkCount(), elapsed, megabytes / elapsed, baseline / elapsed);
+    }
+    return 0;
+}
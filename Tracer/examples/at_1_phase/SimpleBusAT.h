@@ -28,6 +28,7 @@
 
 //LOGICPOET:Include the tracer header
 #include "lptracer/Tracer.h"
+#include "trace_events.h"
 
 template <int NR_OF_INITIATORS, int NR_OF_TARGETS>
 class SimpleBusAT : public sc_core::sc_module
@@ -116,7 +117,7 @@ public:
                 
                 phase_type phase = tlm::BEGIN_REQ;
                 sc_core::sc_time t = sc_core::SC_ZERO_TIME;
-                MarkEvent(trans, "BUS FW: Send "+report::print(phase));//LOGICPOET
+                MarkPhaseEvent(trans, trace_events::bus_fw_send[phase]);//LOGICPOET
                 // FIXME: No limitation on number of pending transactions
                 //        All targets (that return false) must support multiple transactions
                 switch ((*decodeSocket)->nb_transport_fw(*trans, phase, t)) {
@@ -182,7 +183,7 @@ public:
                 target_socket_type* initiatorSocket = it->second.from;
                 // if BEGIN_RESP is send first we don't have to send END_REQ anymore
                 it->second.from = 0;
-                MarkEvent(trans, "BUS BW: Send "+report::print(phase));//LOGICPOET
+                MarkPhaseEvent(trans, trace_events::bus_bw_send[phase]);//LOGICPOET
                 switch ((*initiatorSocket)->nb_transport_bw(*trans, phase, t)) {
                     case tlm::TLM_COMPLETED:
                         // Transaction finished
@@ -225,8 +226,8 @@ public:
                                         sc_core::sc_time& t)
     {
         //LOGICPOET:Since this is non-blocking, back to back events are overkill but help illustrate the flow
-        MarkEvent(&trans, "BUS FW: Receieve "+report::print(phase));//LOGICPOET
-        MarkEvent(&trans, "BUS FW: Return "+report::print(tlm::TLM_ACCEPTED));//LOGICPOET
+        MarkPhaseEvent(&trans, trace_events::bus_fw_receive[phase]);//LOGICPOET
+        MarkDebugEvent(&trans, trace_events::bus_fw_return[tlm::TLM_ACCEPTED]);//LOGICPOET
         if (phase == tlm::BEGIN_REQ) {
             trans.acquire();
             addPendingTransaction(trans, 0, initiator_id);
@@ -235,7 +236,7 @@ public:
             
         } else if (phase == tlm::END_RESP) {
             mEndResponseEvent.notify(t);
-            MarkEvent(&trans, "BUS BW: Return "+report::print(tlm::TLM_COMPLETED));//LOGICPOET
+            MarkDebugEvent(&trans, trace_events::bus_bw_return[tlm::TLM_COMPLETED]);//LOGICPOET
 
             return tlm::TLM_COMPLETED;
             
@@ -253,7 +254,7 @@ public:
                                      sc_core::sc_time& t)
     {
         //LOGICPOET:Since this is non-blocking, back to back events are overkill but help illustrate the flow
-        MarkEvent(&trans, "BUS BW: Receieve "+report::print(phase));//LOGICPOET
+        MarkPhaseEvent(&trans, trace_events::bus_bw_receive[phase]);//LOGICPOET
         if (phase != tlm::END_REQ && phase != tlm::BEGIN_RESP) {
             std::cout << "ERROR: '" << name()
             << "': Illegal phase received from target." << std::endl;
@@ -265,7 +266,7 @@ public:
             mResponsePEQ.notify(trans, t);
         }
         return tlm::TLM_ACCEPTED;
-        MarkEvent(&trans, "BUS BW: Return "+report::print(tlm::TLM_ACCEPTED));//LOGICPOET
+        MarkDebugEvent(&trans, trace_events::bus_bw_return[tlm::TLM_ACCEPTED]);//LOGICPOET
     }
     
     unsigned int transportDebug(int initiator_id, transaction_type& trans)
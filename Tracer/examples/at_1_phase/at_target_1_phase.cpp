@@ -31,6 +31,7 @@
 
 //LOGICPOET:Include the tracer header
 #include "lptracer/Tracer.h"
+#include "trace_events.h"
 
 using namespace  std;
 
@@ -108,7 +109,7 @@ at_target_1_phase::b_transport
     
     msg << " = " << delay_time;
     REPORT_INFO(filename,  __FUNCTION__, msg.str());
-    MarkEvent(&payload, "Target: Receive");//LOGICPOET
+    MarkTransactionEvent(&payload, trace_events::target_receive);//LOGICPOET
     return;     
 }
 
@@ -133,7 +134,7 @@ at_target_1_phase::nb_transport_fw                  // non-blocking transport ca
     
     tlm::tlm_sync_enum  return_status = tlm::TLM_COMPLETED;
     
-    MarkEvent(&gp, "Target FW: Receive "+report::print(phase));//LOGICPOET
+    MarkPhaseEvent(&gp, trace_events::target_fw_receive[phase]);//LOGICPOET
 
     //-----------------------------------------------------------------------------
     // decode phase argument 
@@ -229,7 +230,7 @@ at_target_1_phase::nb_transport_fw                  // non-blocking transport ca
             break;
         }
     }
-    MarkEvent(&gp, "Target FW: Return "+report::print(return_status));//LOGICPOET
+    MarkDebugEvent(&gp, trace_events::target_fw_return[return_status]);//LOGICPOET
 
     return return_status;  
 } //end nb_transport_fw
@@ -267,7 +268,7 @@ void at_target_1_phase::begin_response_method (void)
         << " nb_transport_bw(GP, BEGIN_RESP, SC_ZERO_TIME)"
         << endl << "      ";
         REPORT_INFO(filename,  __FUNCTION__, msg.str());
-        MarkEvent(transaction_ptr, "Target BW: Send BEGIN_RESP");//LOGICPOET
+        MarkPhaseEvent(transaction_ptr, trace_events::target_bw_send[tlm::BEGIN_RESP]);//LOGICPOET
         
         
         
@@ -281,7 +282,7 @@ void at_target_1_phase::begin_response_method (void)
         << report::print(phase) << ", "
         << delay << ")"; 
         REPORT_INFO(filename,  __FUNCTION__, msg.str());
-        MarkEvent(transaction_ptr, "Target BW: Receive "+report::print(status));//LOGICPOET
+        MarkDebugEvent(transaction_ptr, trace_events::target_bw_receive[status]);//LOGICPOET
         switch (status)
         { 
                 
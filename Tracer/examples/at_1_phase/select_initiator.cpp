@@ -34,6 +34,7 @@ using namespace sc_core;
 
 //LOGICPOET:Include the tracer header
 #include "lptracer/Tracer.h"
+#include "trace_events.h"
 
 static const char *filename = "select_initiator.cpp";  ///  filename for reporting
 
@@ -101,7 +102,7 @@ void select_initiator::initiator_thread(void)   // initiator thread
         REPORT_INFO(filename,  __FUNCTION__, msg.str());
         //LOGICPOET:Since we are recycling the transaction pointer we need to retire the last one before starting a new one
         RetireTrace(transaction_ptr);
-        MarkEvent(transaction_ptr, "Initiator FW: Send "+report::print(phase));
+        MarkPhaseEvent(transaction_ptr, trace_events::initiator_fw_send[phase]);
         
         //-----------------------------------------------------------------------------
         // Make the non-blocking call and decode returned status (tlm_sync_enum) 
@@ -114,7 +115,7 @@ void select_initiator::initiator_thread(void)   // initiator thread
         << " " << report::print(return_value) <<  " (GP, "
         << report::print(phase) << ", "
         << delay << ")" << endl; 
-        MarkEvent(transaction_ptr, "Initiator FW: Receive "+report::print(return_value));//LOGICPOET
+        MarkDebugEvent(transaction_ptr, trace_events::initiator_fw_receive[return_value]);//LOGICPOET
         switch (return_value) 
         {
                 //-----------------------------------------------------------------------------
@@ -257,7 +258,7 @@ select_initiator::nb_transport_bw                       // inbound nb_transport_
     //    Decode backward path phase 
     //=============================================================================
     else { 
-        MarkEvent(&transaction_ref, "Initiator BW: Receive "+report::print(phase));//LOGICPOET
+        MarkPhaseEvent(&transaction_ref, trace_events::initiator_bw_receive[phase]);//LOGICPOET
         msg.str ("");
         msg << "Initiator: " << m_ID               
         << " nb_transport_bw (GP, " 
@@ -415,7 +416,7 @@ select_initiator::nb_transport_bw                       // inbound nb_transport_
             }
         } // end switch (phase)
     }
-    MarkEvent(&transaction_ref, "Initiator BW: Return "+report::print(status));//LOGICPOET
+    MarkDebugEvent(&transaction_ref, trace_events::initiator_bw_return[status]);//LOGICPOET
     return status;
 } // end backward nb transport 
 
@@ -453,7 +454,7 @@ void select_initiator::send_end_rsp_method(void)    // send end response method
         << report::print(phase) << ", "
         << delay << ")";
         REPORT_INFO(filename,  __FUNCTION__, msg.str());
-        MarkEvent(transaction_ptr, "Initiator FW: Send END_RESP");//LOGICPOET
+        MarkPhaseEvent(transaction_ptr, trace_events::initiator_fw_send[tlm::END_RESP]);//LOGICPOET
 
         // call begin response and then decode return status
         tlm::tlm_sync_enum 
@@ -464,7 +465,7 @@ void select_initiator::send_end_rsp_method(void)    // send end response method
         << " " << report::print(return_value) <<  " (GP, "
         << report::print(phase) << ", "
         << delay << ")"; 
-        MarkEvent(transaction_ptr, "Initiator FW: Receive "+report::print(return_value));//LOGICPOET
+        MarkDebugEvent(transaction_ptr, trace_events::initiator_fw_receive[return_value]);//LOGICPOET
 
         switch (return_value)    
         {
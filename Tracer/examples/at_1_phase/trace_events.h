@@ -0,0 +1,78 @@
+/*****************************************************************************
+ 
+ LOGICPOET:Event types used by this example, declared once up front.  Marking 
+           with these handles is an array index inside the tracer instead of
+           building a string like "BUS FW: Send "+report::print(phase) and 
+           looking it up on every event.  The names are the same as before so
+           the trace file looks the same.
+ 
+ *****************************************************************************/
+
+#ifndef __TRACE_EVENTS_H__
+#define __TRACE_EVENTS_H__
+
+#include "tlm.h"
+#include "lptracer/Tracer.h"
+
+//One event type per TLM phase, named prefix + phase name
+class PhaseEventTypes
+{
+public:
+    PhaseEventTypes(const std::string &prefix)
+    {
+        handles[0]               = lpt::EventType::declare(prefix + "UNKNOWN");
+        handles[tlm::BEGIN_REQ]  = lpt::EventType::declare(prefix + "BEGIN_REQ");
+        handles[tlm::END_REQ]    = lpt::EventType::declare(prefix + "END_REQ");
+        handles[tlm::BEGIN_RESP] = lpt::EventType::declare(prefix + "BEGIN_RESP");
+        handles[tlm::END_RESP]   = lpt::EventType::declare(prefix + "END_RESP");
+    }
+    lpt::EventTypeHandle operator[](const tlm::tlm_phase &phase) const
+    {
+        unsigned int index = phase;
+        return (index <= tlm::END_RESP) ? handles[index] : handles[0];
+    }
+private:
+    lpt::EventTypeHandle handles[tlm::END_RESP + 1];
+};
+
+//One event type per tlm_sync_enum value, named prefix + status name
+class SyncEventTypes
+{
+public:
+    SyncEventTypes(const std::string &prefix)
+    {
+        handles[tlm::TLM_ACCEPTED]  = lpt::EventType::declare(prefix + "ACCEPTED");
+        handles[tlm::TLM_UPDATED]   = lpt::EventType::declare(prefix + "UPDATED");
+        handles[tlm::TLM_COMPLETED] = lpt::EventType::declare(prefix + "COMPLETED");
+    }
+    lpt::EventTypeHandle operator[](const tlm::tlm_sync_enum status) const
+    {
+        return handles[status];
+    }
+private:
+    lpt::EventTypeHandle handles[tlm::TLM_COMPLETED + 1];
+};
+
+namespace trace_events
+{
+    //Bus
+    static const PhaseEventTypes      bus_fw_send      ("BUS FW: Send ");
+    static const PhaseEventTypes      bus_fw_receive   ("BUS FW: Receieve ");
+    static const SyncEventTypes       bus_fw_return    ("BUS FW: Return ");
+    static const PhaseEventTypes      bus_bw_send      ("BUS BW: Send ");
+    static const PhaseEventTypes      bus_bw_receive   ("BUS BW: Receieve ");
+    static const SyncEventTypes       bus_bw_return    ("BUS BW: Return ");
+    //Initiator
+    static const PhaseEventTypes      initiator_fw_send    ("Initiator FW: Send ");
+    static const SyncEventTypes       initiator_fw_receive ("Initiator FW: Receive ");
+    static const PhaseEventTypes      initiator_bw_receive ("Initiator BW: Receive ");
+    static const SyncEventTypes       initiator_bw_return  ("Initiator BW: Return ");
+    //Target
+    static const lpt::EventTypeHandle target_receive = lpt::EventType::declare("Target: Receive");
+    static const PhaseEventTypes      target_fw_receive ("Target FW: Receive ");
+    static const SyncEventTypes       target_fw_return  ("Target FW: Return ");
+    static const PhaseEventTypes      target_bw_send    ("Target BW: Send ");
+    static const SyncEventTypes       target_bw_receive ("Target BW: Receive ");
+}
+
+#endif /* __TRACE_EVENTS_H__ */
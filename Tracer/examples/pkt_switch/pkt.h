@@ -41,6 +41,22 @@
 //          done by adding Trace to the public ingeritance of the pkt class and 
 //          overriding the getProperties() method of Trace to return the properties.
 #include "lptracer/Tracer.h"
+
+//LOGICPOET:Event types declared once up front so marking an event is an array
+//          index in the tracer rather than a string lookup
+namespace trace_events{
+    static const lpt::EventTypeHandle send_packet            = lpt::EventType::declare("Send Packet");
+    static const lpt::EventTypeHandle receive_packet         = lpt::EventType::declare("Receive Packet");
+    static const lpt::EventTypeHandle switch_received_packet = lpt::EventType::declare("Switch Received Packet");
+    static const lpt::EventTypeHandle register_ring_load     = lpt::EventType::declare("Register Ring Load");
+    static const lpt::EventTypeHandle register_ring_unload[4] = {
+        lpt::EventType::declare("Register Ring Unload 0"),
+        lpt::EventType::declare("Register Ring Unload 1"),
+        lpt::EventType::declare("Register Ring Unload 2"),
+        lpt::EventType::declare("Register Ring Unload 3")
+    };
+}
+
 struct pkt{
        sc_int<8> data;
        sc_int<4> id;
@@ -49,22 +65,47 @@ struct pkt{
        bool dest2;
        bool dest3;
 
-    //LOGICPOET:Added a trace pointer member
+    //LOGICPOET:Added a trace pointer member, and whether it is a child trace
+    //          this copy owns (see outputCopy)
     Trace *trace;
+    bool childTrace;
+
+    pkt() : trace(0), childTrace(false) {}
     
-    //LOGICPOET:Added method to get properties in a map to pass to the tracer
-    map<string,string> getProperties() {
-        char buffer[8];
-        map<string,string> properties;
-        sprintf(buffer, "%d", id.to_int());
-        properties["Sender"] = string(buffer);
-        properties["Targets Receiver 0"] = dest0 ? "True" : "False";
-        properties["Targets Receiver 1"] = dest1 ? "True" : "False";
-        properties["Targets Receiver 2"] = dest2 ? "True" : "False";
-        properties["Targets Receiver 3"] = dest3 ? "True" : "False";
-        sprintf(buffer, "%X", data.to_int());
-        properties["Data"] = "0x"+string(buffer);
-        return properties;
+    //LOGICPOET:Added method to copy the packet's fields onto its trace.  The
+    //          values are stored typed and only formatted when written.
+    void setTraceProperties() {
+        unsigned char dataByte = (unsigned char)data.to_int();
+        trace->addProperty("Sender", id.to_int());
+        trace->addProperty("Targets Receiver 0", dest0);
+        trace->addProperty("Targets Receiver 1", dest1);
+        trace->addProperty("Targets Receiver 2", dest2);
+        trace->addProperty("Targets Receiver 3", dest3);
+        trace->addBlobProperty("Data", &dataByte, 1);
+    }
+
+    //LOGICPOET:The copy of a multicast packet sent to one output gets a child
+    //          trace of its own, so the path to each receiver can be followed.
+    //          Nothing is allocated unless tracing is on.  The receiver frees
+    //          the child with releaseChildTrace.
+    pkt outputCopy() const {
+        pkt copy = *this;
+#ifndef LPTRACE_OFF
+        if (lpt::Tracer::enabled){
+            copy.trace = new Trace();
+            copy.childTrace = true;
+            AddChildTrace(trace, copy.trace);
+        }
+#endif
+        return copy;
+    }
+
+    void releaseChildTrace() {
+        if (!childTrace) return;
+        RetireTrace(trace);
+        delete trace;
+        trace = 0;
+        childTrace = false;
     }
     
     
@@ -45,13 +45,15 @@ void receiver:: entry()
     else {
         temp_val = pkt_in.read();
         //LOGICPOET: Marking the send event just prior to writing
-        MarkEvent(temp_val.trace, "Receive Packet");
+        MarkEvent(temp_val.trace, trace_events::receive_packet);
         cout << "                                  .........................." << endl;
         cout << "                                  New Packet Received" << endl;
         cout << "                                  Receiver ID: " << (int)sink_id.read() + 1 << endl;
         cout << "                                  Packet Value: " << (int)temp_val.data << endl;
         cout << "                                  Sender ID: " << (int)temp_val.id + 1 << endl;
         cout << "                                  .........................." << endl;
+        //LOGICPOET:The packet's child trace ends here
+        temp_val.releaseChildTrace();
     } 
 
 }
@@ -67,9 +67,9 @@ void sender:: entry()
         //LOGICPOET:Create a new trace instance for this packet
         pkt_data.trace = new Trace();
         //LOGICPOET:Setting the trace's properties to be derived from the packet
-        pkt_data.trace->setProperties(pkt_data.getProperties());
+        pkt_data.setTraceProperties();
         //LOGICPOET: Marking the send event just prior to writing
-        MarkEvent(pkt_data.trace, "Send Packet");
+        MarkEvent(pkt_data.trace, trace_events::send_packet);
         
         pkt_out.write(pkt_data);
 
@@ -43,6 +43,14 @@
 #include "switch.h"
 #define SIM_NUM 500
 
+//LOGICPOET:Puts a copy of the packet with its own child trace on an output fifo
+void mcast_pkt_switch :: unload(fifo &out, const pkt &val, int port)
+{
+    pkt copy = val.outputCopy();
+    out.pkt_in(copy);
+    MarkEvent(copy.trace, trace_events::register_ring_unload[port]);
+}
+
 void mcast_pkt_switch :: entry()
 {
     wait();
@@ -144,7 +152,7 @@ void mcast_pkt_switch :: entry()
                 //LOGICPOET:store the packet in temp location so can be marked as well as loaded
                 temp_pkt = in0.read();
                 q0_in.pkt_in(in0.read());
-                MarkEvent(temp_pkt.trace,"Switch Received Packet");
+                MarkEvent(temp_pkt.trace,trace_events::switch_received_packet);
             }
                 
         };  
@@ -157,7 +165,7 @@ void mcast_pkt_switch :: entry()
                 //LOGICPOET:store the packet in temp location so can be marked as well as loaded
                 temp_pkt = in1.read();
                 q1_in.pkt_in(in1.read());
-                MarkEvent(temp_pkt.trace,"Switch Received Packet");
+                MarkEvent(temp_pkt.trace,trace_events::switch_received_packet);
             }
         };
 
@@ -169,7 +177,7 @@ void mcast_pkt_switch :: entry()
                 //LOGICPOET:store the packet in temp location so can be marked as well as loaded
                 temp_pkt = in2.read();
                 q2_in.pkt_in(in2.read());
-                MarkEvent(temp_pkt.trace,"Switch Received Packet");
+                MarkEvent(temp_pkt.trace,trace_events::switch_received_packet);
             }
         };
         
@@ -181,7 +189,7 @@ void mcast_pkt_switch :: entry()
                 //LOGICPOET:store the packet in temp location so can be marked as well as loaded
                 temp_pkt = in3.read();
                 q3_in.pkt_in(in3.read());
-                MarkEvent(temp_pkt.trace,"Switch Received Packet");
+                MarkEvent(temp_pkt.trace,trace_events::switch_received_packet);
             }
         };
 
@@ -191,26 +199,26 @@ void mcast_pkt_switch :: entry()
         {
             R0.val  = q0_in.pkt_out();
             R0.free = false;
-            MarkEvent(R0.val.trace, "Register Ring Load");  //LOGICPOET
+            MarkEvent(R0.val.trace, trace_events::register_ring_load);  //LOGICPOET
         }
 
         if((!q1_in.empty) && R1.free) 
         {
             R1.val  = q1_in.pkt_out();
             R1.free = false;
-            MarkEvent(R1.val.trace, "Register Ring Load");  //LOGICPOET
+            MarkEvent(R1.val.trace, trace_events::register_ring_load);  //LOGICPOET
         }
         if((!q2_in.empty) && R2.free) 
         {
             R2.val  = q2_in.pkt_out();
             R2.free = false;
-            MarkEvent(R2.val.trace, "Register Ring Load");  //LOGICPOET
+            MarkEvent(R2.val.trace, trace_events::register_ring_load);  //LOGICPOET
         }
         if((!q3_in.empty) && R3.free) 
         {
             R3.val  = q3_in.pkt_out();
             R3.free = false;
-            MarkEvent(R3.val.trace, "Register Ring Load");  //LOGICPOET
+            MarkEvent(R3.val.trace, trace_events::register_ring_load);  //LOGICPOET
         }
 
         if((bool)switch_cntrl && switch_cntrl.event())
@@ -225,31 +233,27 @@ void mcast_pkt_switch :: entry()
             /////write the register values to output fifos////////////
             if ((!R0.free) && (R0.val.dest0) && (!q0_out.full))
             {
-                q0_out.pkt_in(R0.val); 
+                unload(q0_out, R0.val, 0);  //LOGICPOET
                 R0.val.dest0 = false;
-                MarkEvent(R0.val.trace, "Register Ring Unload 0");  //LOGICPOET
                 if (!(R0.val.dest0|R0.val.dest1|R0.val.dest2|R0.val.dest3)) R0.free = true;
             }
 
             if ((!R1.free) && (R1.val.dest1) && (!q1_out.full))
             {
-                q1_out.pkt_in(R1.val);
+                unload(q1_out, R1.val, 1);  //LOGICPOET
                 R1.val.dest1 = false;
-                MarkEvent(R1.val.trace, "Register Ring Unload 1");  //LOGICPOET
                 if (!(R1.val.dest1|R1.val.dest1|R1.val.dest2|R1.val.dest3)) R1.free = true;
             }
             if ((!R2.free) && (R2.val.dest2) && (!q2_out.full))
             {
-                q2_out.pkt_in(R2.val);
+                unload(q2_out, R2.val, 2);  //LOGICPOET
                 R2.val.dest2 = false;
-                MarkEvent(R2.val.trace, "Register Ring Unload 2");  //LOGICPOET
                 if (!(R2.val.dest2|R2.val.dest1|R2.val.dest2|R2.val.dest3)) R2.free = true;
             }
             if ((!R3.free) && (R3.val.dest3) && (!q3_out.full))
             {
-                q3_out.pkt_in(R3.val);
+                unload(q3_out, R3.val, 3);  //LOGICPOET
                 R3.val.dest3 = false;
-                MarkEvent(R3.val.trace, "Register Ring Unload 3");  //LOGICPOET
                 if (!(R3.val.dest3|R3.val.dest1|R3.val.dest2|R3.val.dest3)) R3.free = true;
             }
 
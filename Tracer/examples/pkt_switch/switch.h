@@ -58,5 +58,7 @@ struct mcast_pkt_switch : sc_module {
     }  
 
   void entry();  
+  //LOGICPOET:Added
+  void unload(fifo &out, const pkt &val, int port);
  
 };
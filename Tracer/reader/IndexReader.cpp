@@ -0,0 +1,163 @@
+/*
+ *  IndexReader.cpp
+ *  LPTracer
+ *
+ *  http://www.logicpoet.com
+ *
+ *  Copyright 2008 Logic Poet. All rights reserved.
+ *
+ *  The MIT License
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without
+ *  restriction, including without limitation the rights to use,
+ *  copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following
+ *  conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *  OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "IndexReader.h"
+#include <fstream>
+#include <iterator>
+#include <cstring>
+
+using namespace lpt;
+
+IndexReader::IndexReader(){
+    compressed = false;
+    eventCount = 0;
+}
+
+namespace lpt{
+
+    //Varint reader over the loaded file
+    class IndexCursor{
+    public:
+        IndexCursor(const string &bytes){ pos = bytes.data(); end = pos + bytes.size(); ok = true; }
+        unsigned long long varint(){
+            unsigned long long value = 0;
+            for (int shift = 0; shift < 64; shift += 7){
+                if (pos >= end){ ok = false; return 0; }
+                unsigned char byte = (unsigned char)*pos++;
+                value |= (unsigned long long)(byte & 0x7F) << shift;
+                if (byte < 0x80) return value;
+            }
+            ok = false;
+            return 0;
+        }
+        const char *pos;
+        const char *end;
+        bool ok;
+    };
+
+} //namespace lpt
+
+
+bool IndexReader::open(const string &filename){
+    std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+    if (!in){
+        error = "Cannot open " + filename;
+        return false;
+    }
+    string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (bytes.size() < 6 || memcmp(bytes.data(), INDEX_MAGIC, 4) != 0){
+        error = filename + " is not a trace index";
+        return false;
+    }
+    //Older layouts differ in what the tables hold, so they are rebuilt rather than read
+    if ((unsigned char)bytes[4] != INDEX_VERSION){
+        error = filename + " was written by another version of the Tracer, write the trace again to index it";
+        return false;
+    }
+    compressed = (bytes[5] & INDEX_FLAG_COMPRESSED) != 0;
+    IndexCursor cursor(bytes);
+    cursor.pos += 6;
+    eventCount = cursor.varint();
+    unsigned long long count = cursor.varint();
+    entries.clear();
+    for (unsigned long long i = 0; i < count && cursor.ok; i++){
+        Entry entry;
+        entry.time = cursor.varint();
+        entry.eventNumber = cursor.varint();
+        entry.position.fileOffset = cursor.varint();
+        entry.position.blockOffset = (unsigned int)cursor.varint();
+        entries.push_back(entry);
+    }
+    readStarts(cursor, traceStarts);
+    keys.clear();
+    count = cursor.varint();
+    for (unsigned long long i = 0; i < count && cursor.ok; i++){
+        unsigned long long id = cursor.varint();
+        unsigned long long length = cursor.varint();
+        if (length > (unsigned long long)(cursor.end - cursor.pos)){
+            cursor.ok = false;
+            break;
+        }
+        if (keys.size() <= id) keys.resize(id + 1);
+        keys[id].assign(cursor.pos, length);
+        cursor.pos += length;
+    }
+    readStarts(cursor, eventTypeStarts);
+    if (!cursor.ok){
+        error = filename + " is truncated";
+        return false;
+    }
+    return true;
+}
+
+size_t IndexReader::findTime(unsigned long long time){
+    size_t low = 0, high = entries.size();
+    while (low < high){
+        size_t mid = (low + high) / 2;
+        if (entries[mid].time < time) low = mid + 1;
+        else high = mid;
+    }
+    return (low > 0) ? low - 1 : 0;
+}
+
+bool IndexReader::readStarts(IndexCursor &cursor, vector<RecordStart> &starts){
+    unsigned long long count = cursor.varint();
+    starts.clear();
+    for (unsigned long long i = 0; i < count && cursor.ok; i++){
+        RecordStart start;
+        start.id = (int)cursor.varint();
+        start.position.fileOffset = cursor.varint();
+        start.position.blockOffset = (unsigned int)cursor.varint();
+        starts.push_back(start);
+    }
+    return cursor.ok;
+}
+
+bool IndexReader::findStart(const vector<RecordStart> &starts, int id, TracePosition &position){
+    size_t low = 0, high = starts.size();
+    while (low < high){
+        size_t mid = (low + high) / 2;
+        if (starts[mid].id < id) low = mid + 1;
+        else high = mid;
+    }
+    if (low == starts.size() || starts[low].id != id) return false;
+    position = starts[low].position;
+    return true;
+}
+
+bool IndexReader::getTraceStart(int traceId, TracePosition &position){
+    return findStart(traceStarts, traceId, position);
+}
+
+bool IndexReader::getEventTypeStart(int eventTypeId, TracePosition &position){
+    return findStart(eventTypeStarts, eventTypeId, position);
+}
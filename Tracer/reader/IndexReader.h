@@ -0,0 +1,91 @@
+/*
+ *  IndexReader.h
+ *  LPTracer
+ *
+ *  http://www.logicpoet.com
+ *
+ *  Copyright 2008 Logic Poet. All rights reserved.
+ *
+ *  The MIT License
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without
+ *  restriction, including without limitation the rights to use,
+ *  copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following
+ *  conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *  OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _LPT_INDEX_READER_H_
+#define _LPT_INDEX_READER_H_
+
+#include <string>
+#include <vector>
+#include "TraceFile.h"
+#include "TraceIndex.h"
+
+using std::string;
+using std::vector;
+
+namespace lpt{
+
+    class IndexCursor;
+
+    //Reads the sidecar index the Tracer writes with setIndexing()
+    class IndexReader{
+    public:
+        struct Entry{
+            unsigned long long time;            //Latest event time up to and including this event
+            unsigned long long eventNumber;     //Number of events before this one
+            TracePosition position;
+        };
+        IndexReader();
+        bool open(const string &filename);
+        const string& getError() { return error; }
+        bool isCompressed() { return compressed; }
+        unsigned long long getEventCount() { return eventCount; }
+        const vector<Entry>& getEntries() { return entries; }
+        //Index of the last entry whose time is before time, so reading from
+        //there finds every event at or after time.  Entry times are the latest
+        //time so far, so they are sorted even if events were marked with
+        //earlier times.
+        size_t findTime(unsigned long long time);
+        //Position of a trace's record, false if it is not in the index
+        bool getTraceStart(int traceId, TracePosition &position);
+        //Position of an event type's record, false if it is not in the index
+        bool getEventTypeStart(int eventTypeId, TracePosition &position);
+        //Binary property names by key id, empty for XML traces
+        const vector<string>& getKeys() { return keys; }
+    protected:
+        string error;
+        bool compressed;
+        unsigned long long eventCount;
+        vector<Entry> entries;
+        struct RecordStart{
+            int id;
+            TracePosition position;
+        };
+        vector<RecordStart> traceStarts;        //Sorted by id
+        vector<RecordStart> eventTypeStarts;
+        vector<string> keys;
+        bool readStarts(IndexCursor &cursor, vector<RecordStart> &starts);
+        static bool findStart(const vector<RecordStart> &starts, int id, TracePosition &position);
+    };
+
+} //namespace lpt
+
+#endif
@@ -0,0 +1,241 @@
+/*
+ *  LatencyAnalyzer.cpp
+ *  LPTracer
+ *
+ *  http://www.logicpoet.com
+ *
+ *  Copyright 2008 Logic Poet. All rights reserved.
+ *
+ *  The MIT License
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without
+ *  restriction, including without limitation the rights to use,
+ *  copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following
+ *  conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *  OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "LatencyAnalyzer.h"
+#include "TraceQuery.h"
+
+using namespace lpt;
+
+LatencyAnalyzer::LatencyAnalyzer(){
+    groupStart = groupEnd = groupVia = false;
+    maxLiveTraces = 1 << 20;
+    dropped = 0;
+}
+
+void LatencyAnalyzer::addSpan(const string &name, const string &start, const string &end, const string &via){
+    Span span;
+    span.name = name;
+    span.start = start;
+    span.end = end;
+    span.via = via;
+    spans.push_back(span);
+}
+
+void LatencyAnalyzer::setGroupModules(bool start, bool end, bool via){
+    groupStart = start;
+    groupEnd = end;
+    groupVia = via;
+}
+
+void LatencyAnalyzer::setGroupProperty(const string &name){
+    groupProperty = name;
+}
+
+void LatencyAnalyzer::setMaxLiveTraces(unsigned int count){
+    maxLiveTraces = (count > 0) ? count : 1;
+}
+
+bool LatencyAnalyzer::GroupKey::operator<(const GroupKey &other) const {
+    if (span != other.span) return span < other.span;
+    if (startModule != other.startModule) return startModule < other.startModule;
+    if (endModule != other.endModule) return endModule < other.endModule;
+    if (viaModule != other.viaModule) return viaModule < other.viaModule;
+    return value < other.value;
+}
+
+bool LatencyAnalyzer::analyze(TraceReader &reader){
+    TraceRecord record;
+    while (reader.next(record)) add(record, reader);
+    error = reader.getError();
+    return error.empty();
+}
+
+void LatencyAnalyzer::add(const TraceRecord &record, TraceReader &reader){
+    if (record.kind == RECORD_TRACE){
+        if (groupProperty.empty()) return;
+        LiveTrace *live = getLiveTrace(record.id);
+        if (live) live->value = getValue(record);
+        return;
+    }
+    if (record.kind != RECORD_EVENT) return;
+    const vector<EventRole> &eventRoles = getRoles(record.eventTypeId, reader);
+    if (eventRoles.empty()) return;
+    LiveTrace *live = getLiveTrace(record.traceId);
+    if (!live){
+        //Older than anything in the ring.  The end of a span that was already
+        //dropped doesn't count again.
+        if (eventRoles.back().role == ROLE_START) dropped++;
+        return;
+    }
+    OpenSpan *open = &openSpans[(live - &liveTraces[0]) * spans.size()];
+    for (size_t i = 0; i < eventRoles.size(); i++){
+        OpenSpan &span = open[eventRoles[i].span];
+        switch (eventRoles[i].role){
+            case ROLE_END:
+                if (span.startTime){
+                    recordSpan(eventRoles[i].span, span, record.moduleId, record.time);
+                    span.startTime = 0;
+                }
+                break;
+            case ROLE_VIA:
+                if (span.startTime) span.viaModule = record.moduleId;
+                break;
+            case ROLE_START:
+                if (span.startTime) break;
+                span.startTime = record.time + 1;
+                span.startModule = record.moduleId;
+                span.viaModule = 0;
+                span.value = -1;
+                if (!groupProperty.empty()){
+                    span.value = getValue(record);
+                    if (span.value < 0) span.value = live->value;
+                }
+                break;
+        }
+    }
+}
+
+const vector<LatencyAnalyzer::EventRole>& LatencyAnalyzer::getRoles(int eventTypeId, TraceReader &reader){
+    static const vector<EventRole> none;
+    if (eventTypeId <= 0) return none;
+    if (roles.size() <= (size_t)eventTypeId){
+        roles.resize(eventTypeId + 1);
+        rolesKnown.resize(eventTypeId + 1, false);
+    }
+    if (rolesKnown[eventTypeId]) return roles[eventTypeId];
+    const EventTypeInfo *type = reader.getEventType(eventTypeId);
+    if (!type) return none;
+    vector<EventRole> &found = roles[eventTypeId];
+    for (int role = ROLE_END; role <= ROLE_START; role++){
+        for (size_t i = 0; i < spans.size(); i++){
+            const string &pattern = (role == ROLE_START) ? spans[i].start : (role == ROLE_END) ? spans[i].end : spans[i].via;
+            if (pattern.empty() || !matchGlob(pattern.c_str(), type->name)) continue;
+            EventRole eventRole;
+            eventRole.span = (int)i;
+            eventRole.role = (Role)role;
+            found.push_back(eventRole);
+        }
+    }
+    rolesKnown[eventTypeId] = true;
+    return found;
+}
+
+//The ring slot for a trace, taking it over from an older trace if needed.
+//Returns 0 for a trace older than the one in its slot.
+LatencyAnalyzer::LiveTrace* LatencyAnalyzer::getLiveTrace(int traceId){
+    if (traceId <= 0) return 0;
+    if (liveTraces.empty()){
+        LiveTrace empty = {0, -1};
+        liveTraces.resize(maxLiveTraces, empty);
+        OpenSpan closed = {0, 0, 0, -1};
+        openSpans.resize((size_t)maxLiveTraces * spans.size(), closed);
+    }
+    size_t slot = (size_t)traceId % maxLiveTraces;
+    LiveTrace &live = liveTraces[slot];
+    if (live.traceId == traceId) return &live;
+    if (live.traceId > traceId) return 0;
+    for (size_t i = 0; i < spans.size(); i++){
+        OpenSpan &open = openSpans[slot * spans.size() + i];
+        if (open.startTime) dropped++;
+        open.startTime = 0;
+    }
+    live.traceId = traceId;
+    live.value = -1;
+    return &live;
+}
+
+int LatencyAnalyzer::getValue(const TraceRecord &record){
+    for (size_t i = 0; i < record.properties.size(); i++){
+        const PropertyRef &property = record.properties[i];
+        if (property.name.length != groupProperty.size() ||
+            memcmp(property.name.data, groupProperty.data(), property.name.length) != 0) continue;
+        string text = property.toString();
+        map<string, int>::iterator found = valueIds.find(text);
+        if (found != valueIds.end()) return found->second;
+        valueIds[text] = (int)values.size();
+        values.push_back(text);
+        return (int)values.size() - 1;
+    }
+    return -1;
+}
+
+void LatencyAnalyzer::recordSpan(int span, const OpenSpan &open, int endModule, unsigned long long time){
+    GroupKey key;
+    key.span = span;
+    key.startModule = groupStart ? open.startModule : 0;
+    key.endModule = groupEnd ? endModule : 0;
+    key.viaModule = groupVia ? open.viaModule : 0;
+    key.value = open.value;
+    map<GroupKey, int>::iterator found = groupIds.find(key);
+    int group;
+    if (found != groupIds.end()){
+        group = found->second;
+    }
+    else {
+        group = (int)groups.size();
+        groupIds[key] = group;
+        Group created;
+        created.span = span;
+        created.startModule = key.startModule;
+        created.endModule = key.endModule;
+        created.viaModule = key.viaModule;
+        created.value = key.value;
+        groups.push_back(created);
+    }
+    unsigned long long start = open.startTime - 1;
+    groups[group].histogram.record((time > start) ? time - start : 0);
+}
+
+unsigned long long LatencyAnalyzer::getUnfinished(){
+    unsigned long long count = 0;
+    for (size_t i = 0; i < openSpans.size(); i++){
+        if (openSpans[i].startTime) count++;
+    }
+    return count;
+}
+
+string LatencyAnalyzer::getGroupName(const Group &group, TraceReader &reader){
+    string name;
+    int modules[3] = {group.startModule, group.viaModule, group.endModule};
+    bool used[3] = {groupStart, groupVia, groupEnd};
+    for (int i = 0; i < 3; i++){
+        if (!used[i]) continue;
+        if (!name.empty()) name += " -> ";
+        string path = reader.getModulePath(modules[i]);
+        name += path.empty() ? "?" : path;
+    }
+    if (!groupProperty.empty()){
+        if (!name.empty()) name += "  ";
+        name += groupProperty + "=" + ((group.value >= 0) ? values[group.value] : "?");
+    }
+    return name.empty() ? "all" : name;
+}
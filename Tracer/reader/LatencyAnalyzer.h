@@ -0,0 +1,148 @@
+/*
+ *  LatencyAnalyzer.h
+ *  LPTracer
+ *
+ *  http://www.logicpoet.com
+ *
+ *  Copyright 2008 Logic Poet. All rights reserved.
+ *
+ *  The MIT License
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without
+ *  restriction, including without limitation the rights to use,
+ *  copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following
+ *  conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *  OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _LPT_LATENCY_ANALYZER_H_
+#define _LPT_LATENCY_ANALYZER_H_
+
+//Measures spans between pairs of events on the same trace, for example from
+//"Initiator FW: Send BEGIN_REQ" to "Initiator BW: Receive BEGIN_RESP", in
+//one pass over a trace file.  Each span is recorded into a LatencyHistogram
+//for its group: the modules of its start, end and (optionally) a via event,
+//and the value of a trace property.
+//
+//Memory does not grow with the length of the trace.  Open spans are kept in
+//a ring indexed by trace id, which works because the Tracer hands out trace
+//ids in order; a span still open when maxLiveTraces newer traces have come
+//along is dropped and counted.
+
+#include <string>
+#include <vector>
+#include <map>
+#include "TraceReader.h"
+#include "LatencyHistogram.h"
+
+using std::string;
+using std::vector;
+using std::map;
+
+namespace lpt{
+
+    class LatencyAnalyzer{
+    public:
+        LatencyAnalyzer();
+        //Patterns are event type names with * and ? wildcards.  The span opens
+        //at the first start event of a trace and closes at the next end event.
+        //If via is given, the module of the last via event in between is kept
+        //(the target of a request, say).
+        void addSpan(const string &name, const string &start, const string &end, const string &via = "");
+        //What a group is made of.  With nothing set every span has one group.
+        void setGroupModules(bool start, bool end, bool via);
+        //Groups by the value of a property, looked for on the start event and
+        //then on the trace
+        void setGroupProperty(const string &name);
+        void setMaxLiveTraces(unsigned int count);
+
+        //Feed every record of the file in order, or call analyze to read them all
+        void add(const TraceRecord &record, TraceReader &reader);
+        bool analyze(TraceReader &reader);
+        const string& getError() { return error; }
+
+        struct Group{
+            int span;
+            int startModule;
+            int endModule;
+            int viaModule;
+            int value;          //Into getValues(), -1 without a property
+            LatencyHistogram histogram;
+        };
+        const vector<Group>& getGroups() { return groups; }
+        const string& getSpanName(int span) { return spans[span].name; }
+        const vector<string>& getValues() { return values; }
+        //Group label like "top.initiator -> top.target  Command=Write"
+        string getGroupName(const Group &group, TraceReader &reader);
+        //Spans that started but never ended, and those dropped from the ring
+        unsigned long long getUnfinished();
+        unsigned long long getDropped() { return dropped; }
+
+    protected:
+        struct Span{
+            string name;
+            string start;
+            string end;
+            string via;
+        };
+        //Where an event type takes part in a span
+        enum Role { ROLE_END, ROLE_VIA, ROLE_START };   //The order they are handled in
+        struct EventRole{
+            int span;
+            Role role;
+        };
+        //A trace in the ring, with an OpenSpan per span after it
+        struct LiveTrace{
+            int traceId;
+            int value;
+        };
+        struct OpenSpan{
+            unsigned long long startTime;   //0 when not open, so times are kept plus one
+            int startModule;
+            int viaModule;
+            int value;
+        };
+        struct GroupKey{
+            int span, startModule, endModule, viaModule, value;
+            bool operator<(const GroupKey &other) const;
+        };
+        vector<Span> spans;
+        bool groupStart, groupEnd, groupVia;
+        string groupProperty;
+        unsigned int maxLiveTraces;
+        string error;
+        //Roles by event type id, filled in as event types are first seen
+        vector<vector<EventRole> > roles;
+        vector<bool> rolesKnown;
+        vector<LiveTrace> liveTraces;
+        vector<OpenSpan> openSpans;         //spans.size() per live trace
+        unsigned long long dropped;
+        map<string, int> valueIds;
+        vector<string> values;
+        map<GroupKey, int> groupIds;
+        vector<Group> groups;
+
+        const vector<EventRole>& getRoles(int eventTypeId, TraceReader &reader);
+        LiveTrace* getLiveTrace(int traceId);
+        int getValue(const TraceRecord &record);
+        void recordSpan(int span, const OpenSpan &open, int endModule, unsigned long long time);
+    };
+
+} //namespace lpt
+
+#endif
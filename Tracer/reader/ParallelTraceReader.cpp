@@ -0,0 +1,246 @@
+/*
+ *  ParallelTraceReader.cpp
+ *  LPTracer
+ *
+ *  http://www.logicpoet.com
+ *
+ *  Copyright 2008 Logic Poet. All rights reserved.
+ *
+ *  The MIT License
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without
+ *  restriction, including without limitation the rights to use,
+ *  copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following
+ *  conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *  OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "ParallelTraceReader.h"
+#include <algorithm>
+#include <queue>
+
+using namespace lpt;
+
+//Chunks per thread, so a thread that gets dense chunks doesn't hold up the rest
+static const unsigned int CHUNKS_PER_THREAD = 8;
+//Chunks smaller than this aren't worth a hand off
+static const unsigned long long MIN_CHUNK_SIZE = 1 << 20;
+
+ParallelTraceReader::ParallelTraceReader(){
+    hasIndex = false;
+    threads = 1;
+}
+
+bool ParallelTraceReader::open(const string &filename, unsigned int threads){
+    this->threads = (threads > 0) ? threads : 1;
+    if (!whole.open(filename, this->threads)){
+        error = whole.getError();
+        return false;
+    }
+    hasIndex = index.open(filename + ".idx");
+    if (hasIndex){
+        const vector<string> &keys = index.getKeys();
+        for (size_t i = 1; i < keys.size(); i++){
+            whole.setKey((int)i, StringRef(keys[i].data(), keys[i].size()));
+        }
+    }
+    readDefinitions();
+    planChunks();
+    return true;
+}
+
+//Modules, event types and signals at the head of the file are read here, so
+//every chunk finds them in whole.  Chunks start at the first other record.
+void ParallelTraceReader::readDefinitions(){
+    TraceRecord record;
+    const char *recordStart = whole.cursor;
+    while (whole.next(record)){
+        if (record.kind != RECORD_MODULE_BEGIN && record.kind != RECORD_MODULE_END
+            && record.kind != RECORD_EVENTTYPE && record.kind != RECORD_SIGNAL) break;
+        recordStart = whole.cursor;
+    }
+    whole.cursor = recordStart;
+}
+
+void ParallelTraceReader::planChunks(){
+    unsigned long long begin = whole.cursor - whole.start;
+    unsigned long long size = whole.limit - whole.start;
+    unsigned long long wanted = (unsigned long long)threads * CHUNKS_PER_THREAD;
+    unsigned long long chunkSize = (size - begin) / wanted;
+    if (chunkSize < MIN_CHUNK_SIZE) chunkSize = MIN_CHUNK_SIZE;
+    chunkStarts.clear();
+    chunkStarts.push_back(begin);
+    if (hasIndex){
+        //Index entries are record starts, take the first one past each cut
+        const vector<IndexReader::Entry> &entries = index.getEntries();
+        for (size_t i = 0; i < entries.size(); i++){
+            unsigned long long offset;
+            if (!whole.getOffset(entries[i].position, offset)) continue;
+            if (offset >= chunkStarts.back() + chunkSize) chunkStarts.push_back(offset);
+        }
+    }
+    else if (whole.getFormat() == XML_FORMAT){
+        unsigned long long cut = begin + chunkSize;
+        while (cut < size){
+            unsigned long long offset = whole.findXmlRecordStart(cut);
+            if (offset >= size) break;
+            chunkStarts.push_back(offset);
+            cut = offset + chunkSize;
+        }
+    }
+    whole.error = "";
+    chunkStarts.push_back(size);
+}
+
+bool ParallelTraceReader::read(const vector<ChunkVisitor *> &visitors){
+    return run(&visitors, 0, visitors.size());
+}
+
+static bool earlier(const EventSummary &a, const EventSummary &b){
+    return a.time < b.time;
+}
+
+//Orders the heads of the chunk lists for the merge, ties go to the earlier chunk
+struct MergeHead{
+    unsigned long long time;
+    size_t chunk;
+    size_t index;
+    bool operator<(const MergeHead &other) const {
+        if (time != other.time) return time > other.time;
+        return chunk > other.chunk;
+    }
+};
+
+bool ParallelTraceReader::readEvents(vector<EventSummary> &events){
+    vector< vector<EventSummary> > chunkEvents(getChunkCount());
+    if (!run(0, &chunkEvents, threads)) return false;
+    //Each chunk was sorted by its thread, merge them
+    size_t total = 0;
+    std::priority_queue<MergeHead> heads;
+    for (size_t i = 0; i < chunkEvents.size(); i++){
+        total += chunkEvents[i].size();
+        if (!chunkEvents[i].empty()){
+            MergeHead head = {chunkEvents[i][0].time, i, 0};
+            heads.push(head);
+        }
+    }
+    events.clear();
+    events.reserve(total);
+    while (!heads.empty()){
+        MergeHead head = heads.top();
+        heads.pop();
+        vector<EventSummary> &chunk = chunkEvents[head.chunk];
+        events.push_back(chunk[head.index]);
+        if (++head.index < chunk.size()){
+            head.time = chunk[head.index].time;
+            heads.push(head);
+        }
+        else {
+            vector<EventSummary>().swap(chunk);
+        }
+    }
+    return true;
+}
+
+bool ParallelTraceReader::run(const vector<ChunkVisitor *> *visitors, vector< vector<EventSummary> > *chunkEvents, unsigned int threadCount){
+    if (chunkStarts.size() < 2){
+        error = "Trace is not open";
+        return false;
+    }
+    Job job;
+    job.owner = this;
+    job.visitors = visitors;
+    job.chunkEvents = chunkEvents;
+    job.nextChunk = 0;
+    job.nextThread = 0;
+    pthread_mutex_init(&job.mutex, 0);
+    if (threadCount == 0) threadCount = 1;
+    for (unsigned int i = 0; i < threadCount; i++){
+        job.readers.push_back(new TraceReader());
+    }
+    job.traceBases.resize(getChunkCount());
+    job.traces.resize(getChunkCount());
+    vector<pthread_t> workers;
+    for (unsigned int i = 1; i < threadCount; i++){
+        pthread_t thread;
+        if (pthread_create(&thread, 0, threadEntry, &job) == 0) workers.push_back(thread);
+    }
+    work(&job);
+    for (size_t i = 0; i < workers.size(); i++){
+        pthread_join(workers[i], 0);
+    }
+    //The chunks looked ids up in whole, so it only changes once they are done
+    for (size_t i = 0; i < job.readers.size(); i++){
+        whole.mergeTables(*job.readers[i]);
+        delete job.readers[i];
+    }
+    for (size_t i = 0; i < job.traces.size(); i++){
+        whole.mergeTraces(job.traceBases[i], job.traces[i]);
+    }
+    pthread_mutex_destroy(&job.mutex);
+    error = job.error;
+    return error.empty();
+}
+
+void* ParallelTraceReader::threadEntry(void *arg){
+    Job *job = (Job *)arg;
+    job->owner->work(job);
+    return 0;
+}
+
+void ParallelTraceReader::work(Job *job){
+    pthread_mutex_lock(&job->mutex);
+    unsigned int thread = job->nextThread++;
+    pthread_mutex_unlock(&job->mutex);
+    ChunkVisitor *visitor = job->visitors ? (*job->visitors)[thread] : 0;
+    //Every chunk this thread reads adds its modules, event types and signals
+    //to the same tables, and ids from before the read are found in whole,
+    //which no thread changes
+    TraceReader &chunk = *job->readers[thread];
+    TraceRecord record;
+    while (true){
+        pthread_mutex_lock(&job->mutex);
+        size_t index = job->nextChunk++;
+        pthread_mutex_unlock(&job->mutex);
+        if (index + 1 >= chunkStarts.size()) break;
+        chunk.openChunk(whole, chunkStarts[index], chunkStarts[index+1]);
+        vector<EventSummary> *events = job->chunkEvents ? &(*job->chunkEvents)[index] : 0;
+        while (chunk.next(record)){
+            if (visitor) visitor->visit(record, chunk);
+            if (events && record.kind == RECORD_EVENT){
+                EventSummary event;
+                event.time = record.time;
+                event.eventTypeId = record.eventTypeId;
+                event.traceId = record.traceId;
+                event.moduleId = record.moduleId;
+                event.position = record.position;
+                events->push_back(event);
+            }
+        }
+        //Events are nearly in time order already, so this is cheap
+        if (events) std::stable_sort(events->begin(), events->end(), earlier);
+        job->traceBases[index] = chunk.traceBase;
+        job->traces[index].swap(chunk.traces);
+        chunk.traceBase = 0;
+        if (!chunk.getError().empty()){
+            pthread_mutex_lock(&job->mutex);
+            if (job->error.empty()) job->error = chunk.getError();
+            pthread_mutex_unlock(&job->mutex);
+        }
+    }
+}
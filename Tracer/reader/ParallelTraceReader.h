@@ -0,0 +1,118 @@
+/*
+ *  ParallelTraceReader.h
+ *  LPTracer
+ *
+ *  http://www.logicpoet.com
+ *
+ *  Copyright 2008 Logic Poet. All rights reserved.
+ *
+ *  The MIT License
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without
+ *  restriction, including without limitation the rights to use,
+ *  copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following
+ *  conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *  OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _LPT_PARALLEL_TRACE_READER_H_
+#define _LPT_PARALLEL_TRACE_READER_H_
+
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include "TraceReader.h"
+#include "IndexReader.h"
+
+using std::string;
+using std::vector;
+
+namespace lpt{
+
+    //Receives the records of the chunks one thread parses.  Every thread gets
+    //its own visitor so visitors need no locking; combine their results once
+    //read() returns.  Chunks are handed out in no particular order.  Lookups on
+    //chunk find the ids known before read(), modules, event types and signals
+    //from the chunks the same thread has read so far, and traces from the
+    //chunk itself; getReader() has them all once read() returns.
+    class ChunkVisitor{
+    public:
+        virtual ~ChunkVisitor(){}
+        virtual void visit(const TraceRecord &record, TraceReader &chunk) = 0;
+    };
+
+    //What readEvents() keeps of each event.  The properties can be read by
+    //seeking a TraceReader to the position.
+    struct EventSummary{
+        unsigned long long time;
+        int eventTypeId;
+        int traceId;
+        int moduleId;
+        TracePosition position;
+    };
+
+    //Parses one trace on several threads.  The file is cut into chunks at
+    //record boundaries: at index entries when there is an index file next to
+    //the trace, otherwise (XML only) at the first record tag after each cut.
+    //Binary traces need an index, without one they are read on one thread.
+    class ParallelTraceReader{
+    public:
+        ParallelTraceReader();
+        bool open(const string &filename, unsigned int threads);
+        const string& getError() { return error; }
+        unsigned int getChunkCount() { return chunkStarts.empty() ? 0 : chunkStarts.size() - 1; }
+        //Parses every chunk, with visitors[i] receiving the records of thread i.
+        //One thread is used per visitor.
+        bool read(const vector<ChunkVisitor *> &visitors);
+        //Collects every event in time order, events at the same time in file order
+        bool readEvents(vector<EventSummary> &events);
+        //After a read, the module, event type and trace tables from all chunks
+        TraceReader& getReader() { return whole; }
+
+    protected:
+        TraceReader whole;
+        IndexReader index;
+        bool hasIndex;
+        unsigned int threads;
+        string error;
+        vector<unsigned long long> chunkStarts;     //Offsets into the data, ending with its size
+        void readDefinitions();
+        void planChunks();
+        //Work shared by the threads of one read
+        struct Job{
+            ParallelTraceReader *owner;
+            const vector<ChunkVisitor *> *visitors;
+            vector<TraceReader *> readers;      //One per thread, merged into whole at the end
+            //The traces of each chunk.  A thread's chunks are spread over the
+            //file, so one table per thread would span nearly all of it.
+            vector<size_t> traceBases;
+            vector< vector<TraceInfo> > traces;
+            vector< vector<EventSummary> > *chunkEvents;
+            size_t nextChunk;
+            unsigned int nextThread;
+            string error;
+            pthread_mutex_t mutex;
+        };
+        bool run(const vector<ChunkVisitor *> *visitors, vector< vector<EventSummary> > *chunkEvents, unsigned int threadCount);
+        static void* threadEntry(void *arg);
+        void work(Job *job);
+    };
+
+} //namespace lpt
+
+#endif
@@ -0,0 +1,560 @@
+/*
+ *  TraceQuery.cpp
+ *  LPTracer
+ *
+ *  http://www.logicpoet.com
+ *
+ *  Copyright 2008 Logic Poet. All rights reserved.
+ *
+ *  The MIT License
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without
+ *  restriction, including without limitation the rights to use,
+ *  copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following
+ *  conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *  OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "TraceQuery.h"
+#include <cstdlib>
+#include <climits>
+#include <strings.h>
+
+using namespace lpt;
+
+bool lpt::parseTraceTime(const string &text, double resolution, unsigned long long &ticks){
+    const char *begin = text.c_str();
+    char *end;
+    double value = strtod(begin, &end);
+    if (end == begin || value < 0) return false;
+    while (*end == ' ') end++;
+    if (*end == '\0'){
+        //No unit, already in ticks
+        ticks = strtoull(begin, &end, 10);
+        if (*end != '\0') ticks = (unsigned long long)(value + 0.5);
+        return true;
+    }
+    static const char *units[] = {"s", "ms", "us", "ns", "ps", "fs", 0};
+    static const double scales[] = {1, 1e-3, 1e-6, 1e-9, 1e-12, 1e-15};
+    for (int i = 0; units[i]; i++){
+        if (strcmp(end, units[i]) == 0){
+            ticks = (unsigned long long)(value * scales[i] / resolution + 0.5);
+            return true;
+        }
+    }
+    return false;
+}
+
+#pragma mark -
+#pragma mark Setup
+
+TraceQuery::TraceQuery(){
+    reader = 0;
+    index = 0;
+    done = false;
+    from = 0;
+    to = ULLONG_MAX;
+    root = -1;
+}
+
+bool TraceQuery::fail(const string &message){
+    error = message;
+    return false;
+}
+
+void TraceQuery::addModule(const string &path){
+    modulePaths.push_back(path);
+}
+
+void TraceQuery::addEventType(const string &pattern){
+    eventTypePatterns.push_back(pattern);
+}
+
+void TraceQuery::addTrace(int traceId){
+    traceIds.push_back(traceId);
+}
+
+void TraceQuery::setTimeWindow(unsigned long long from, unsigned long long to){
+    this->from = from;
+    this->to = to;
+}
+
+bool TraceQuery::isBefore(const TracePosition &a, const TracePosition &b){
+    unsigned long long offsetA, offsetB;
+    if (!reader->getOffset(a, offsetA) || !reader->getOffset(b, offsetB)) return false;
+    return offsetA < offsetB;
+}
+
+bool TraceQuery::start(TraceReader &reader, IndexReader *index){
+    this->reader = &reader;
+    this->index = index;
+    done = false;
+    if (index){
+        const vector<string> &keys = index->getKeys();
+        for (size_t i = 1; i < keys.size(); i++){
+            reader.setKey((int)i, StringRef(keys[i].data(), keys[i].size()));
+        }
+    }
+    //Modules, and the event types declared up front, come before the first
+    //trace.  Read them so the names can be resolved.
+    bool found = false;
+    while (reader.next(lookup)){
+        if (lookup.kind == RECORD_TRACE || lookup.kind == RECORD_EVENT){
+            found = true;
+            break;
+        }
+    }
+    if (!reader.getError().empty()) return fail(reader.getError());
+    if (!found){
+        done = true;
+        return true;
+    }
+    TracePosition first = lookup.position;
+
+    moduleRoots.clear();
+    for (size_t i = 0; i < modulePaths.size(); i++){
+        bool known = false;
+        for (int id = 1; id <= reader.getModuleCount(); id++){
+            if (reader.getModule(id) && reader.getModulePath(id) == modulePaths[i]){
+                moduleRoots.push_back(id);
+                known = true;
+            }
+        }
+        if (!known) return fail("No module named " + modulePaths[i]);
+    }
+    traceWanted.clear();
+    for (size_t i = 0; i < traceIds.size(); i++){
+        if (traceIds[i] <= 0) continue;
+        if (traceWanted.size() <= (size_t)traceIds[i]) traceWanted.resize(traceIds[i] + 1, false);
+        traceWanted[traceIds[i]] = true;
+    }
+    if (!traceIds.empty() && traceWanted.empty()){
+        done = true;
+        return true;
+    }
+
+    //Skip to the latest position that can't miss a match
+    TracePosition target = first;
+    if (index){
+        const vector<IndexReader::Entry> &entries = index->getEntries();
+        if (from > 0 && !entries.empty()){
+            const TracePosition &position = entries[index->findTime(from)].position;
+            if (isBefore(target, position)) target = position;
+        }
+        if (!traceIds.empty()){
+            bool any = false;
+            TracePosition earliest;
+            for (size_t i = 0; i < traceIds.size(); i++){
+                TracePosition position;
+                if (!index->getTraceStart(traceIds[i], position)) continue;
+                if (!any || isBefore(position, earliest)) earliest = position;
+                any = true;
+            }
+            if (!any){
+                //None of the traces are in the file
+                done = true;
+                return true;
+            }
+            if (isBefore(target, earliest)) target = earliest;
+        }
+    }
+    if (!reader.seek(target)) return fail(reader.getError());
+    return true;
+}
+
+#pragma mark -
+#pragma mark Predicate Parsing
+
+static void skipSpace(const char *&pos){
+    while (*pos == ' ' || *pos == '\t') pos++;
+}
+
+//Reads a quoted string, or up to one of stop with the trailing spaces removed
+static bool readWord(const char *&pos, const char *stop, string &word, string &error){
+    word.clear();
+    if (*pos == '"'){
+        pos++;
+        while (*pos && *pos != '"'){
+            if (*pos == '\\' && pos[1]) pos++;
+            word += *pos++;
+        }
+        if (*pos != '"'){
+            error = "Missing closing quote in predicate";
+            return false;
+        }
+        pos++;
+        return true;
+    }
+    const char *begin = pos;
+    while (*pos && !strchr(stop, *pos)) pos++;
+    const char *end = pos;
+    while (end > begin && (end[-1] == ' ' || end[-1] == '\t')) end--;
+    word.assign(begin, end - begin);
+    return true;
+}
+
+bool TraceQuery::setPredicate(const string &expression){
+    names.clear();
+    nameTerms.clear();
+    terms.clear();
+    nodes.clear();
+    nameCache.clear();
+    root = -1;
+    const char *pos = expression.c_str();
+    skipSpace(pos);
+    if (*pos == '\0') return true;
+    int node = parseOr(pos);
+    if (node < 0) return false;
+    skipSpace(pos);
+    if (*pos != '\0') return fail(string("Unexpected \"") + pos + "\" in predicate");
+    root = node;
+    return true;
+}
+
+int TraceQuery::addNode(NodeKind kind, int left, int right){
+    Node node;
+    node.kind = kind;
+    node.left = left;
+    node.right = right;
+    nodes.push_back(node);
+    return (int)nodes.size() - 1;
+}
+
+int TraceQuery::parseOr(const char *&pos){
+    int left = parseAnd(pos);
+    while (left >= 0){
+        skipSpace(pos);
+        if (pos[0] != '|' || pos[1] != '|') break;
+        pos += 2;
+        int right = parseAnd(pos);
+        if (right < 0) return -1;
+        left = addNode(NODE_OR, left, right);
+    }
+    return left;
+}
+
+int TraceQuery::parseAnd(const char *&pos){
+    int left = parseUnary(pos);
+    while (left >= 0){
+        skipSpace(pos);
+        if (pos[0] != '&' || pos[1] != '&') break;
+        pos += 2;
+        int right = parseUnary(pos);
+        if (right < 0) return -1;
+        left = addNode(NODE_AND, left, right);
+    }
+    return left;
+}
+
+int TraceQuery::parseUnary(const char *&pos){
+    skipSpace(pos);
+    if (pos[0] == '!' && pos[1] != '='){
+        pos++;
+        int operand = parseUnary(pos);
+        return (operand < 0) ? -1 : addNode(NODE_NOT, operand, -1);
+    }
+    if (*pos == '('){
+        pos++;
+        int inner = parseOr(pos);
+        if (inner < 0) return -1;
+        skipSpace(pos);
+        if (*pos != ')'){
+            fail("Missing ) in predicate");
+            return -1;
+        }
+        pos++;
+        return inner;
+    }
+    return parseTerm(pos);
+}
+
+int TraceQuery::parseTerm(const char *&pos){
+    string name;
+    if (!readWord(pos, "=!<>&|()", name, error)) return -1;
+    if (name.empty()){
+        fail("Expected a property name in predicate");
+        return -1;
+    }
+    Term term;
+    term.op = OP_EXISTS;
+    term.isInt = term.isDouble = term.isBool = false;
+    term.intValue = 0;
+    term.doubleValue = 0;
+    term.boolValue = false;
+    skipSpace(pos);
+    if (pos[0] == '='){
+        term.op = OP_EQUAL;
+        pos += (pos[1] == '=') ? 2 : 1;
+    }
+    else if (pos[0] == '!' && pos[1] == '='){
+        term.op = OP_NOT_EQUAL;
+        pos += 2;
+    }
+    else if (pos[0] == '<'){
+        term.op = (pos[1] == '=') ? OP_LESS_EQUAL : OP_LESS;
+        pos += (pos[1] == '=') ? 2 : 1;
+    }
+    else if (pos[0] == '>'){
+        term.op = (pos[1] == '=') ? OP_GREATER_EQUAL : OP_GREATER;
+        pos += (pos[1] == '=') ? 2 : 1;
+    }
+    if (term.op != OP_EXISTS){
+        skipSpace(pos);
+        if (!readWord(pos, "&|)", term.text, error)) return -1;
+        if (term.text.empty()){
+            fail("Expected a value after " + name + " in predicate");
+            return -1;
+        }
+        //Work out once how the value can be compared
+        const char *text = term.text.c_str();
+        char *end;
+        term.intValue = (long long)strtoull(text, &end, 0);
+        if (text[0] == '-') term.intValue = strtoll(text, &end, 0);
+        term.isInt = (*end == '\0');
+        term.doubleValue = strtod(text, &end);
+        term.isDouble = (*end == '\0');
+        if (strcasecmp(text, "true") == 0 || strcasecmp(text, "false") == 0){
+            term.isBool = true;
+            term.boolValue = (strcasecmp(text, "true") == 0);
+        }
+    }
+    term.name = -1;
+    for (size_t i = 0; i < names.size(); i++){
+        if (names[i] == name) term.name = (int)i;
+    }
+    if (term.name < 0){
+        term.name = (int)names.size();
+        names.push_back(name);
+        nameTerms.push_back(vector<int>());
+    }
+    nameTerms[term.name].push_back((int)terms.size());
+    terms.push_back(term);
+    return addNode(NODE_TERM, (int)terms.size() - 1, -1);
+}
+
+#pragma mark -
+#pragma mark Matching
+
+bool TraceQuery::next(TraceRecord &record){
+    if (!reader) return fail("Query has not been started");
+    while (!done && reader->next(record)){
+        if (record.kind == RECORD_TRACE){
+            if (!terms.empty()) evaluate(record, getTraceTerms(record.id, false));
+            continue;
+        }
+        if (record.kind != RECORD_EVENT) continue;
+        if (record.span){
+            //Spans are written when they end, so they come after events that
+            //are later than their start.  They match if they overlap the window.
+            if (record.time > to || record.time + record.duration < from) continue;
+        }
+        else {
+            //Events are in time order, so nothing after this can match
+            if (record.time > to){
+                done = true;
+                break;
+            }
+            if (record.time < from) continue;
+        }
+        if (!traceWanted.empty() && ((size_t)record.traceId >= traceWanted.size() || !traceWanted[record.traceId])) continue;
+        if (!matchesEventType(record.eventTypeId)) continue;
+        if (!matchesModule(record.moduleId)) continue;
+        if (root >= 0 && !matchesPredicate(record)) continue;
+        return true;
+    }
+    if (!reader->getError().empty()) error = reader->getError();
+    return false;
+}
+
+bool lpt::matchGlob(const char *pattern, const StringRef &name){
+    const char *text = name.data;
+    const char *textEnd = name.data + name.length;
+    const char *star = 0;
+    const char *starText = 0;
+    while (text < textEnd){
+        if (*pattern == '*'){
+            star = pattern++;
+            starText = text;
+        }
+        else if (*pattern && (*pattern == '?' || *pattern == *text)){
+            pattern++;
+            text++;
+        }
+        else if (star){
+            pattern = star + 1;
+            text = ++starText;
+        }
+        else {
+            return false;
+        }
+    }
+    while (*pattern == '*') pattern++;
+    return *pattern == '\0';
+}
+
+bool TraceQuery::matchesEventType(int eventTypeId){
+    if (eventTypePatterns.empty()) return true;
+    if (eventTypeId <= 0) return false;
+    if (eventTypeMatches.size() <= (size_t)eventTypeId) eventTypeMatches.resize(eventTypeId + 1, 0);
+    if (eventTypeMatches[eventTypeId]) return eventTypeMatches[eventTypeId] > 0;
+    const EventTypeInfo *type = reader->getEventType(eventTypeId);
+    TracePosition position;
+    if (!type && index && index->getEventTypeStart(eventTypeId, position) && reader->readAt(position, lookup)){
+        //Declared before where the reader started
+        type = reader->getEventType(eventTypeId);
+    }
+    if (!type) return false;
+    bool match = false;
+    for (size_t i = 0; i < eventTypePatterns.size() && !match; i++){
+        match = matchGlob(eventTypePatterns[i].c_str(), type->name);
+    }
+    eventTypeMatches[eventTypeId] = match ? 1 : -1;
+    return match;
+}
+
+bool TraceQuery::matchesModule(int moduleId){
+    if (moduleRoots.empty()) return true;
+    if (moduleId <= 0) return false;
+    if (moduleMatches.size() <= (size_t)moduleId) moduleMatches.resize(moduleId + 1, 0);
+    if (moduleMatches[moduleId]) return moduleMatches[moduleId] > 0;
+    if (!reader->getModule(moduleId)) return false;
+    bool match = false;
+    for (size_t i = 0; i < moduleRoots.size() && !match; i++){
+        match = reader->isInSubtree(moduleId, moduleRoots[i]);
+    }
+    moduleMatches[moduleId] = match ? 1 : -1;
+    return match;
+}
+
+//The term states of a trace, from its trace record.  If the reader started
+//after the record it is looked up through the index when resolve is set.
+unsigned char* TraceQuery::getTraceTerms(int traceId, bool resolve){
+    if (traceId <= 0){
+        eventTerms.assign(terms.size(), TERM_ABSENT);
+        return &eventTerms[0];
+    }
+    size_t slot = (size_t)traceId * terms.size();
+    if (traceTerms.size() < slot + terms.size()){
+        size_t size = traceTerms.empty() ? 1024 * terms.size() : traceTerms.size();
+        while (size < slot + terms.size()) size *= 2;
+        traceTerms.resize(size, TERM_UNKNOWN);
+    }
+    unsigned char *states = &traceTerms[slot];
+    if (!resolve){
+        //At the trace record itself
+        for (size_t i = 0; i < terms.size(); i++) states[i] = TERM_ABSENT;
+        return states;
+    }
+    if (states[0] == TERM_UNKNOWN){
+        for (size_t i = 0; i < terms.size(); i++) states[i] = TERM_ABSENT;
+        TracePosition position;
+        if (index && index->getTraceStart(traceId, position) && reader->readAt(position, lookup) &&
+            lookup.kind == RECORD_TRACE && lookup.id == traceId){
+            evaluate(lookup, states);
+        }
+    }
+    return states;
+}
+
+bool TraceQuery::matchesPredicate(const TraceRecord &event){
+    unsigned char *traceStates = getTraceTerms(event.traceId, true);
+    if (traceStates != &eventTerms[0]) eventTerms.assign(traceStates, traceStates + terms.size());
+    //Event properties win over trace properties of the same name
+    evaluate(event, &eventTerms[0]);
+    return evaluateNode(root, &eventTerms[0]);
+}
+
+int TraceQuery::findName(const StringRef &name){
+    //Binary property names all point into the key records, so the address
+    //identifies the name
+    bool cache = (reader->getFormat() == BINARY_FORMAT);
+    if (cache){
+        for (size_t i = 0; i < nameCache.size(); i++){
+            if (nameCache[i].first == name.data) return nameCache[i].second;
+        }
+    }
+    int found = -1;
+    for (size_t i = 0; i < names.size(); i++){
+        if (names[i].size() == name.length && memcmp(names[i].data(), name.data, name.length) == 0){
+            found = (int)i;
+            break;
+        }
+    }
+    if (cache) nameCache.push_back(std::make_pair(name.data, found));
+    return found;
+}
+
+void TraceQuery::evaluate(const TraceRecord &record, unsigned char *states){
+    for (size_t i = 0; i < record.properties.size(); i++){
+        int name = findName(record.properties[i].name);
+        if (name < 0) continue;
+        const vector<int> &termList = nameTerms[name];
+        for (size_t j = 0; j < termList.size(); j++){
+            states[termList[j]] = compare(record.properties[i], terms[termList[j]]) ? TERM_TRUE : TERM_FALSE;
+        }
+    }
+}
+
+bool TraceQuery::compare(const PropertyRef &property, const Term &term){
+    if (term.op == OP_EXISTS) return true;
+    int order;
+    long long intValue;
+    double doubleValue;
+    bool boolValue;
+    if (term.isInt && property.type != PROPERTY_DOUBLE && property.getInt(intValue)){
+        order = (intValue < term.intValue) ? -1 : (intValue > term.intValue);
+    }
+    else if (term.isDouble && property.getDouble(doubleValue)){
+        order = (doubleValue < term.doubleValue) ? -1 : (doubleValue > term.doubleValue);
+    }
+    else if (term.isBool && property.getBool(boolValue)){
+        order = (int)boolValue - (int)term.boolValue;
+    }
+    else if (term.isInt || term.isDouble){
+        //A number can only be unequal to text
+        return term.op == OP_NOT_EQUAL;
+    }
+    else if (property.type == PROPERTY_STRING){
+        size_t length = (property.text.length < term.text.size()) ? property.text.length : term.text.size();
+        order = memcmp(property.text.data, term.text.data(), length);
+        if (order == 0) order = (property.text.length < term.text.size()) ? -1 : (property.text.length > term.text.size());
+    }
+    else {
+        order = property.toString().compare(term.text);
+    }
+    switch (term.op){
+        case OP_EQUAL: return order == 0;
+        case OP_NOT_EQUAL: return order != 0;
+        case OP_LESS: return order < 0;
+        case OP_LESS_EQUAL: return order <= 0;
+        case OP_GREATER: return order > 0;
+        case OP_GREATER_EQUAL: return order >= 0;
+        default: return true;
+    }
+}
+
+bool TraceQuery::evaluateNode(int node, const unsigned char *states){
+    const Node &current = nodes[node];
+    switch (current.kind){
+        case NODE_TERM: return states[current.left] == TERM_TRUE;
+        case NODE_AND: return evaluateNode(current.left, states) && evaluateNode(current.right, states);
+        case NODE_OR: return evaluateNode(current.left, states) || evaluateNode(current.right, states);
+        case NODE_NOT: return !evaluateNode(current.left, states);
+    }
+    return false;
+}
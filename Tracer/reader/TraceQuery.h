@@ -0,0 +1,152 @@
+/*
+ *  TraceQuery.h
+ *  LPTracer
+ *
+ *  http://www.logicpoet.com
+ *
+ *  Copyright 2008 Logic Poet. All rights reserved.
+ *
+ *  The MIT License
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without
+ *  restriction, including without limitation the rights to use,
+ *  copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following
+ *  conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *  OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _LPT_TRACE_QUERY_H_
+#define _LPT_TRACE_QUERY_H_
+
+//Filters the events of a trace by module subtree, event type name, trace,
+//time window and property predicates.  Names in the filter are resolved to
+//ids once and the answer cached per id, so the per event cost is a few table
+//lookups; property predicates on trace properties are evaluated once per
+//trace.  With an index the reader starts at the first indexed position that
+//can hold a match and stops after the end of the time window.
+
+#include <string>
+#include <vector>
+#include "TraceReader.h"
+#include "IndexReader.h"
+
+using std::string;
+using std::vector;
+
+namespace lpt{
+
+    //Reads "1500" as ticks, or a number with a unit (s, ms, us, ns, ps, fs)
+    //converted to ticks of resolution seconds
+    bool parseTraceTime(const string &text, double resolution, unsigned long long &ticks);
+    //Matches names against patterns with * and ? wildcards
+    bool matchGlob(const char *pattern, const StringRef &text);
+
+    class TraceQuery{
+    public:
+        TraceQuery();
+        //The filters all have to match.  Adding more modules, event types or
+        //traces widens that filter.
+        void addModule(const string &path);         //Dot separated, includes the children
+        void addEventType(const string &pattern);   //* and ? wildcards
+        void addTrace(int traceId);
+        void setTimeWindow(unsigned long long from, unsigned long long to);
+        //Comparisons of property names with values, joined with &&, || and !
+        //and grouped with parentheses:
+        //  Command==Write && (Adress>=0x100 || "Data Length">4)
+        //Event properties are checked first, then the properties of the event's
+        //trace.  A name on its own tests that the property is there.
+        bool setPredicate(const string &expression);
+        const string& getError() { return error; }
+
+        //Positions the reader for the filter; index may be 0.  The reader must
+        //be freshly opened.
+        bool start(TraceReader &reader, IndexReader *index);
+        //Reads up to the next matching event, false when there are no more
+        bool next(TraceRecord &record);
+
+    protected:
+        enum CompareOp { OP_EXISTS, OP_EQUAL, OP_NOT_EQUAL, OP_LESS, OP_LESS_EQUAL, OP_GREATER, OP_GREATER_EQUAL };
+        struct Term{
+            int name;               //Into names
+            CompareOp op;
+            string text;
+            bool isInt;
+            long long intValue;
+            bool isDouble;
+            double doubleValue;
+            bool isBool;
+            bool boolValue;
+        };
+        enum NodeKind { NODE_TERM, NODE_AND, NODE_OR, NODE_NOT };
+        struct Node{
+            NodeKind kind;
+            int left;               //Term index for NODE_TERM
+            int right;
+        };
+        //What a trace or event says about each term
+        enum TermState { TERM_UNKNOWN, TERM_ABSENT, TERM_FALSE, TERM_TRUE };
+
+        TraceReader *reader;
+        IndexReader *index;
+        string error;
+        bool done;
+        vector<string> modulePaths;
+        vector<string> eventTypePatterns;
+        vector<int> traceIds;
+        unsigned long long from;
+        unsigned long long to;
+        //Predicate
+        vector<string> names;
+        vector<vector<int> > nameTerms;     //Terms using each name
+        vector<Term> terms;
+        vector<Node> nodes;
+        int root;
+        //Answers cached by id
+        vector<int> moduleRoots;
+        vector<signed char> moduleMatches;      //0 not yet known, 1 match, -1 no match
+        vector<signed char> eventTypeMatches;
+        vector<bool> traceWanted;
+        vector<unsigned char> traceTerms;       //TermStates, terms.size() per trace id
+        vector<unsigned char> eventTerms;
+        //Binary property names point into the key table, so lookups are cached
+        //by address
+        vector<std::pair<const char *, int> > nameCache;
+        TraceRecord lookup;
+
+        bool fail(const string &message);
+        //Predicate parsing
+        int parseOr(const char *&pos);
+        int parseAnd(const char *&pos);
+        int parseUnary(const char *&pos);
+        int parseTerm(const char *&pos);
+        int addNode(NodeKind kind, int left, int right);
+        //Matching
+        bool matchesModule(int moduleId);
+        bool matchesEventType(int eventTypeId);
+        bool matchesPredicate(const TraceRecord &event);
+        int findName(const StringRef &name);
+        void evaluate(const TraceRecord &record, unsigned char *states);
+        bool compare(const PropertyRef &property, const Term &term);
+        bool evaluateNode(int node, const unsigned char *states);
+        unsigned char* getTraceTerms(int traceId, bool resolve);
+        bool isBefore(const TracePosition &a, const TracePosition &b);
+    };
+
+} //namespace lpt
+
+#endif
@@ -0,0 +1,962 @@
+/*
+ *  TraceReader.cpp
+ *  LPTracer
+ *
+ *  http://www.logicpoet.com
+ *
+ *  Copyright 2008 Logic Poet. All rights reserved.
+ *
+ *  The MIT License
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without
+ *  restriction, including without limitation the rights to use,
+ *  copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following
+ *  conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *  OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "TraceReader.h"
+#include <cstdlib>
+#include <cstdio>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#ifdef LPTRACE_ZLIB
+#include <zlib.h>
+#endif
+
+using namespace lpt;
+
+#pragma mark -
+#pragma mark PropertyRef
+
+//Copies text into a null terminated buffer for the C conversion functions
+static bool terminate(const StringRef &text, char *buffer, size_t size){
+    if (text.length == 0 || text.length >= size) return false;
+    memcpy(buffer, text.data, text.length);
+    buffer[text.length] = '\0';
+    return true;
+}
+
+bool PropertyRef::getInt(long long &value) const {
+    switch (type){
+        case PROPERTY_INT: value = intValue; return true;
+        case PROPERTY_BOOL: value = boolValue ? 1 : 0; return true;
+        case PROPERTY_DOUBLE: value = (long long)doubleValue; return true;
+        case PROPERTY_STRING: {
+            char buffer[64];
+            if (!terminate(text, buffer, sizeof(buffer))) return false;
+            char *end;
+            //Base 0 takes both decimal and 0x hex, like the addresses the Tracer writes
+            value = (long long)strtoull(buffer, &end, 0);
+            if (buffer[0] == '-') value = strtoll(buffer, &end, 0);
+            return *end == '\0';
+        }
+        default: return false;
+    }
+}
+
+bool PropertyRef::getDouble(double &value) const {
+    switch (type){
+        case PROPERTY_INT: value = (double)intValue; return true;
+        case PROPERTY_BOOL: value = boolValue ? 1 : 0; return true;
+        case PROPERTY_DOUBLE: value = doubleValue; return true;
+        case PROPERTY_STRING: {
+            long long intText;
+            if (getInt(intText)){
+                value = (double)intText;
+                return true;
+            }
+            char buffer[64];
+            if (!terminate(text, buffer, sizeof(buffer))) return false;
+            char *end;
+            value = strtod(buffer, &end);
+            return *end == '\0';
+        }
+        default: return false;
+    }
+}
+
+bool PropertyRef::getBool(bool &value) const {
+    switch (type){
+        case PROPERTY_BOOL: value = boolValue; return true;
+        case PROPERTY_INT: value = intValue != 0; return true;
+        case PROPERTY_STRING:
+            if (text == "True"){ value = true; return true; }
+            if (text == "False"){ value = false; return true; }
+            return false;
+        default: return false;
+    }
+}
+
+string PropertyRef::toString() const {
+    PropertyValue value;
+    switch (type){
+        case PROPERTY_INT: value = PropertyValue(intValue); break;
+        case PROPERTY_DOUBLE: value = PropertyValue(doubleValue); break;
+        case PROPERTY_BOOL: value = PropertyValue(boolValue); break;
+        case PROPERTY_BLOB: value = PropertyValue::blob((const unsigned char *)text.data, text.length); break;
+        case PROPERTY_STRING: return text.str();
+        default: break;
+    }
+    return value.toString();
+}
+
+const PropertyRef* TraceRecord::findProperty(const char *name) const {
+    for (size_t i = 0; i < properties.size(); i++){
+        if (properties[i].name == name) return &properties[i];
+    }
+    return 0;
+}
+
+#pragma mark -
+#pragma mark Opening & Closing
+
+TraceReader::TraceReader(){
+    start = cursor = limit = chunkEnd = 0;
+    mapping = 0;
+    mappingLength = 0;
+    format = XML_FORMAT;
+    resolution = 1e-12;
+    legacyTimes = false;
+    traceBase = 0;
+    base = 0;
+}
+
+TraceReader::~TraceReader(){
+    close();
+}
+
+bool TraceReader::open(const string &filename, unsigned int threads){
+    close();
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return fail("Cannot open " + filename);
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0){
+        ::close(fd);
+        return fail("Cannot read " + filename);
+    }
+    mappingLength = (size_t)info.st_size;
+    mapping = mmap(0, mappingLength, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED){
+        mapping = 0;
+        return fail("Cannot map " + filename);
+    }
+    //We read front to back, so let the kernel read ahead aggressively
+    madvise(mapping, mappingLength, MADV_SEQUENTIAL);
+    return openBytes((const char *)mapping, mappingLength, threads);
+}
+
+bool TraceReader::open(const char *bytes, size_t length, unsigned int threads){
+    close();
+    return openBytes(bytes, length, threads);
+}
+
+void TraceReader::close(){
+    if (mapping) munmap(mapping, mappingLength);
+    mapping = 0;
+    mappingLength = 0;
+    start = cursor = limit = chunkEnd = 0;
+    inflated.clear();
+    blocks.clear();
+    modules.clear();
+    eventTypes.clear();
+    signals.clear();
+    traces.clear();
+    traceBase = 0;
+    moduleStack.clear();
+    keys.clear();
+    base = 0;
+    legacyTimes = false;
+    error = "";
+}
+
+bool TraceReader::openBytes(const char *bytes, size_t length, unsigned int threads){
+    //Id 0 is never used so the tables can be indexed by id directly
+    modules.resize(1);
+    eventTypes.resize(1);
+    signals.resize(1);
+    traces.resize(1);
+    modules[0].id = 0;
+    modules[0].parentId = 0;
+    modules[0].depth = -1;
+    if (length >= 4 && memcmp(bytes, COMPRESSED_MAGIC, 4) == 0){
+        if (!inflate(bytes, length, threads)) return false;
+        bytes = inflated.empty() ? "" : &inflated[0];
+        length = inflated.size();
+    }
+    start = cursor = bytes;
+    limit = chunkEnd = bytes + length;
+    if (length >= 4 && memcmp(bytes, BINARY_MAGIC, 4) == 0){
+        format = BINARY_FORMAT;
+        return readBinaryHeader();
+    }
+    format = XML_FORMAT;
+    return readXmlHeader();
+}
+
+#ifdef LPTRACE_ZLIB
+static unsigned long getLittleEndian32(const char *bytes){
+    const unsigned char *b = (const unsigned char *)bytes;
+    return (unsigned long)b[0] | ((unsigned long)b[1] << 8) | ((unsigned long)b[2] << 16) | ((unsigned long)b[3] << 24);
+}
+
+#endif
+
+//Compressed traces can't be used in place, so the blocks are inflated into
+//one buffer.  Positions are translated through the block table.  The frames
+//are walked first so the blocks can then be inflated on several threads.
+#ifdef LPTRACE_ZLIB
+struct InflateJob{
+    const char *bytes;
+    const vector<unsigned long long> *frames;
+    char *inflated;
+    const vector<unsigned long long> *offsets;
+    size_t next;
+    bool ok;
+    pthread_mutex_t mutex;
+};
+
+static void *inflateBlocks(void *arg){
+    InflateJob *job = (InflateJob *)arg;
+    while (true){
+        pthread_mutex_lock(&job->mutex);
+        size_t block = job->next++;
+        pthread_mutex_unlock(&job->mutex);
+        if (block + 1 >= job->offsets->size()) break;
+        const char *frame = job->bytes + (*job->frames)[block];
+        uLongf inflatedLength = getLittleEndian32(frame + 4);
+        unsigned long long expected = (*job->offsets)[block+1] - (*job->offsets)[block];
+        if (uncompress((Bytef *)(job->inflated + (*job->offsets)[block]), &inflatedLength,
+                       (const Bytef *)(frame + COMPRESSED_FRAME_SIZE), getLittleEndian32(frame)) != Z_OK ||
+            inflatedLength != expected){
+            pthread_mutex_lock(&job->mutex);
+            job->ok = false;
+            pthread_mutex_unlock(&job->mutex);
+        }
+    }
+    return 0;
+}
+#endif
+
+bool TraceReader::inflate(const char *bytes, size_t length, unsigned int threads){
+#ifdef LPTRACE_ZLIB
+    vector<unsigned long long> frames, offsets;
+    unsigned long long total = 0;
+    size_t pos = COMPRESSED_HEADER_SIZE;
+    while (true){
+        if (pos + COMPRESSED_FRAME_SIZE > length) return fail("Compressed trace is truncated");
+        unsigned long compressedLength = getLittleEndian32(bytes + pos);
+        if (compressedLength == 0) break;
+        if (pos + COMPRESSED_FRAME_SIZE + compressedLength > length) return fail("Compressed trace is truncated");
+        Block block;
+        block.frameOffset = pos;
+        block.inflatedOffset = total;
+        blocks.push_back(block);
+        frames.push_back(pos);
+        offsets.push_back(total);
+        total += getLittleEndian32(bytes + pos + 4);
+        pos += COMPRESSED_FRAME_SIZE + compressedLength;
+    }
+    offsets.push_back(total);
+    inflated.resize(total);
+    if (total == 0) return true;
+    InflateJob job;
+    job.bytes = bytes;
+    job.frames = &frames;
+    job.inflated = &inflated[0];
+    job.offsets = &offsets;
+    job.next = 0;
+    job.ok = true;
+    pthread_mutex_init(&job.mutex, 0);
+    if (threads > frames.size()) threads = frames.size();
+    vector<pthread_t> workers;
+    for (unsigned int i = 1; i < threads; i++){
+        pthread_t thread;
+        if (pthread_create(&thread, 0, inflateBlocks, &job) == 0) workers.push_back(thread);
+    }
+    inflateBlocks(&job);
+    for (size_t i = 0; i < workers.size(); i++){
+        pthread_join(workers[i], 0);
+    }
+    pthread_mutex_destroy(&job.mutex);
+    if (!job.ok) return fail("Corrupt block in compressed trace");
+    return true;
+#else
+    (void)bytes;
+    (void)length;
+    (void)threads;
+    return fail("Compressed traces need the reader built with LPTRACE_ZLIB");
+#endif
+}
+
+bool TraceReader::fail(const string &message){
+    error = message;
+    return false;
+}
+
+#pragma mark -
+#pragma mark Positions
+
+TracePosition TraceReader::tell(){
+    TracePosition position;
+    unsigned long long offset = cursor - start;
+    if (blocks.empty()){
+        position.fileOffset = offset;
+        position.blockOffset = 0;
+        return position;
+    }
+    //Last block starting at or before the offset
+    size_t low = 0, high = blocks.size();
+    while (high - low > 1){
+        size_t mid = (low + high) / 2;
+        if (blocks[mid].inflatedOffset <= offset) low = mid;
+        else high = mid;
+    }
+    position.fileOffset = blocks[low].frameOffset;
+    position.blockOffset = (unsigned int)(offset - blocks[low].inflatedOffset);
+    return position;
+}
+
+bool TraceReader::getOffset(const TracePosition &position, unsigned long long &offset){
+    offset = position.fileOffset;
+    if (!blocks.empty()){
+        size_t low = 0, high = blocks.size();
+        while (low < high){
+            size_t mid = (low + high) / 2;
+            if (blocks[mid].frameOffset < position.fileOffset) low = mid + 1;
+            else high = mid;
+        }
+        if (low == blocks.size() || blocks[low].frameOffset != position.fileOffset){
+            return fail("Position is not the start of a block");
+        }
+        offset = blocks[low].inflatedOffset + position.blockOffset;
+    }
+    if (offset > (unsigned long long)(limit - start)) return fail("Position is past the end of the trace");
+    return true;
+}
+
+bool TraceReader::seek(const TracePosition &position){
+    unsigned long long offset;
+    if (!getOffset(position, offset)) return false;
+    cursor = start + offset;
+    moduleStack.clear();
+    return true;
+}
+
+bool TraceReader::readAt(const TracePosition &position, TraceRecord &record){
+    const char *savedCursor = cursor;
+    const char *savedChunkEnd = chunkEnd;
+    vector<int> savedStack;
+    savedStack.swap(moduleStack);
+    bool found = false;
+    unsigned long long offset;
+    if (getOffset(position, offset)){
+        cursor = start + offset;
+        chunkEnd = limit;
+        found = next(record);
+    }
+    cursor = savedCursor;
+    chunkEnd = savedChunkEnd;
+    moduleStack.swap(savedStack);
+    return found;
+}
+
+#pragma mark -
+#pragma mark Chunks
+
+//The tables start out empty and grow from chunk to chunk, so one reader can
+//collect what all the chunks it reads define.  Lookups fall back on whole,
+//which must not change while its chunks are read.
+bool TraceReader::openChunk(TraceReader &whole, unsigned long long begin, unsigned long long end){
+    if (base != &whole){
+        close();
+        base = &whole;
+        start = whole.start;
+        limit = whole.limit;
+        blocks = whole.blocks;
+        format = whole.format;
+        resolution = whole.resolution;
+        legacyTimes = whole.legacyTimes;
+    }
+    cursor = start + begin;
+    chunkEnd = start + end;
+    moduleStack.clear();
+    error = "";
+    return true;
+}
+
+//XML tags all start on their own line, so a chunk can start at the first
+//record tag after any offset.  Property tags never start a record.
+unsigned long long TraceReader::findXmlRecordStart(unsigned long long offset){
+    static const char *tags[] = {"<event ", "<eventtype ", "<trace ", "<module ", "<signal ", "<change ", 0};
+    const char *pos = start + offset;
+    while (pos < limit){
+        pos = (const char *)memchr(pos, '<', limit - pos);
+        if (!pos) break;
+        if (pos == start || pos[-1] == '\n'){
+            for (int i = 0; tags[i]; i++){
+                size_t length = strlen(tags[i]);
+                if ((size_t)(limit - pos) >= length && memcmp(pos, tags[i], length) == 0) return pos - start;
+            }
+        }
+        pos++;
+    }
+    return limit - start;
+}
+
+//Adds ids another reader has seen to this one's tables
+void TraceReader::mergeTables(const TraceReader &other){
+    if (modules.size() < other.modules.size()) modules.resize(other.modules.size());
+    for (size_t i = 1; i < other.modules.size(); i++){
+        if (other.modules[i].id) modules[i] = other.modules[i];
+    }
+    if (eventTypes.size() < other.eventTypes.size()) eventTypes.resize(other.eventTypes.size());
+    for (size_t i = 1; i < other.eventTypes.size(); i++){
+        if (other.eventTypes[i].id) eventTypes[i] = other.eventTypes[i];
+    }
+    if (signals.size() < other.signals.size()) signals.resize(other.signals.size());
+    for (size_t i = 1; i < other.signals.size(); i++){
+        if (other.signals[i].id) signals[i] = other.signals[i];
+    }
+    mergeTraces(other.traceBase, other.traces);
+}
+
+//otherTraces[0] is trace otherBase
+void TraceReader::mergeTraces(size_t otherBase, const vector<TraceInfo> &otherTraces){
+    size_t traceCount = otherBase + otherTraces.size() - traceBase;
+    if (!otherTraces.empty() && traces.size() < traceCount) traces.resize(traceCount);
+    for (size_t i = 0; i < otherTraces.size(); i++){
+        if (otherTraces[i].id) traces[otherBase + i - traceBase] = otherTraces[i];
+    }
+}
+
+StringRef TraceReader::getKey(unsigned long long keyId){
+    if (keyId < keys.size() && !keys[keyId].empty()) return keys[keyId];
+    return base ? base->getKey(keyId) : StringRef();
+}
+
+void TraceReader::setKey(int keyId, const StringRef &name){
+    if (keyId <= 0) return;
+    if (keys.size() <= (size_t)keyId) keys.resize(keyId + 1);
+    keys[keyId] = name;
+}
+
+#pragma mark -
+#pragma mark Lookups
+
+const ModuleInfo* TraceReader::getModule(int id){
+    if (id <= 0 || (size_t)id >= modules.size() || modules[id].id != id) return base ? base->getModule(id) : 0;
+    return &modules[id];
+}
+
+const EventTypeInfo* TraceReader::getEventType(int id){
+    if (id <= 0 || (size_t)id >= eventTypes.size() || eventTypes[id].id != id) return base ? base->getEventType(id) : 0;
+    return &eventTypes[id];
+}
+
+const SignalInfo* TraceReader::getSignal(int id){
+    if (id <= 0 || (size_t)id >= signals.size() || signals[id].id != id) return base ? base->getSignal(id) : 0;
+    return &signals[id];
+}
+
+const TraceInfo* TraceReader::getTrace(int id){
+    if (id > 0 && (size_t)id >= traceBase && (size_t)id - traceBase < traces.size() && traces[id - traceBase].id == id){
+        return &traces[id - traceBase];
+    }
+    return base ? base->getTrace(id) : 0;
+}
+
+string TraceReader::getModulePath(int id){
+    const ModuleInfo *module = getModule(id);
+    if (!module) return "";
+    string parent = getModulePath(module->parentId);
+    return parent.empty() ? module->name.str() : parent + "." + module->name.str();
+}
+
+bool TraceReader::isInSubtree(int id, int ancestor){
+    const ModuleInfo *module = getModule(id);
+    while (module){
+        if (module->id == ancestor) return true;
+        module = getModule(module->parentId);
+    }
+    return false;
+}
+
+//Keeps the id tables up to date as records go by
+void TraceReader::remember(const TraceRecord &record){
+    if (record.id <= 0) return;
+    size_t id = record.id;
+    switch (record.kind){
+        case RECORD_MODULE_BEGIN: {
+            if (modules.size() <= id) modules.resize(id + 1);
+            ModuleInfo &module = modules[id];
+            module.id = record.id;
+            module.parentId = record.parentId;
+            const ModuleInfo *parent = getModule(record.parentId);
+            module.depth = parent ? parent->depth + 1 : 0;
+            module.name = record.name;
+            break;
+        }
+        case RECORD_EVENTTYPE: {
+            if (eventTypes.size() <= id) eventTypes.resize(id + 1);
+            eventTypes[id].id = record.id;
+            eventTypes[id].name = record.name;
+            break;
+        }
+        case RECORD_SIGNAL: {
+            if (signals.size() <= id) signals.resize(id + 1);
+            signals[id].id = record.id;
+            signals[id].name = record.name;
+            signals[id].width = record.width;
+            break;
+        }
+        case RECORD_TRACE: {
+            //Traces arrive in id order, so this grows one at a time
+            if (traces.empty()) traceBase = id;
+            if (id < traceBase) break;
+            size_t slot = id - traceBase;
+            if (traces.size() <= slot) traces.resize(slot + 1);
+            traces[slot].id = record.id;
+            traces[slot].name = record.name;
+            traces[slot].position = record.position;
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+bool TraceReader::next(TraceRecord &record){
+    if (!start) return false;
+    bool found = (format == BINARY_FORMAT) ? nextBinary(record) : nextXml(record);
+    if (found) remember(record);
+    return found;
+}
+
+#pragma mark -
+#pragma mark XML
+
+//Name of the property holding the value of a change record
+static const char CHANGE_VALUE_NAME[] = "Value";
+
+static bool isSpace(char c){
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+//Reads the prolog up to and including the <document> tag
+bool TraceReader::readXmlHeader(){
+    StringRef tag;
+    bool closing, empty;
+    const char *attributes, *attributesEnd;
+    while (readXmlTag(tag, closing, empty, attributes, attributesEnd)){
+        if (tag == "document" && !closing){
+            StringRef value = getXmlAttribute(attributes, attributesEnd, "resolution");
+            char buffer[64];
+            if (terminate(value, buffer, sizeof(buffer))){
+                resolution = strtod(buffer, 0);
+            }
+            else {
+                //Older files have times in seconds, which we keep as femtoseconds
+                legacyTimes = true;
+                resolution = 1e-15;
+            }
+            return true;
+        }
+    }
+    if (error.empty()) fail("No <document> element in the trace");
+    return false;
+}
+
+//Reads the next tag, skipping text, comments, declarations and the DOCTYPE.
+//For <name attr="..."/> tag is name, empty is true and the attribute text
+//runs from attributes to attributesEnd.
+bool TraceReader::readXmlTag(StringRef &tag, bool &closing, bool &empty, const char *&attributes, const char *&attributesEnd){
+    while (true){
+        const char *open = (const char *)memchr(cursor, '<', limit - cursor);
+        if (!open){
+            cursor = limit;
+            return false;
+        }
+        const char *close = (const char *)memchr(open, '>', limit - open);
+        if (!close){
+            cursor = limit;
+            return fail("Trace ends inside a tag");
+        }
+        cursor = close + 1;
+        const char *name = open + 1;
+        if (name < close && (*name == '?' || *name == '!')) continue;
+        closing = (*name == '/');
+        if (closing) name++;
+        const char *nameEnd = name;
+        while (nameEnd < close && !isSpace(*nameEnd) && *nameEnd != '/') nameEnd++;
+        tag = StringRef(name, nameEnd - name);
+        empty = (close[-1] == '/');
+        attributes = nameEnd;
+        attributesEnd = empty ? close - 1 : close;
+        return true;
+    }
+}
+
+//Attribute values are written without escaping, so the value runs to the next quote
+StringRef TraceReader::getXmlAttribute(const char *attributes, const char *attributesEnd, const char *name){
+    size_t nameLength = strlen(name);
+    const char *pos = attributes;
+    while (pos < attributesEnd){
+        while (pos < attributesEnd && isSpace(*pos)) pos++;
+        const char *attrName = pos;
+        while (pos < attributesEnd && *pos != '=') pos++;
+        if (pos + 1 >= attributesEnd || pos[1] != '"') break;
+        const char *value = pos + 2;
+        const char *valueEnd = (const char *)memchr(value, '"', attributesEnd - value);
+        if (!valueEnd) break;
+        if ((size_t)(pos - attrName) == nameLength && memcmp(attrName, name, nameLength) == 0){
+            return StringRef(value, valueEnd - value);
+        }
+        pos = valueEnd + 1;
+    }
+    return StringRef();
+}
+
+//Ids are written with a one letter prefix (M1, E1, T1)
+int TraceReader::parseId(const StringRef &text){
+    int id = 0;
+    for (size_t i = 0; i < text.length; i++){
+        char c = text.data[i];
+        if (c >= '0' && c <= '9') id = id*10 + (c - '0');
+    }
+    return id;
+}
+
+static unsigned long long parseUnsigned(const StringRef &text, bool &ok){
+    unsigned long long value = 0;
+    ok = text.length > 0;
+    for (size_t i = 0; i < text.length; i++){
+        char c = text.data[i];
+        if (c < '0' || c > '9'){
+            ok = false;
+            break;
+        }
+        value = value*10 + (c - '0');
+    }
+    return value;
+}
+
+bool TraceReader::nextXml(TraceRecord &record){
+    StringRef tag;
+    bool closing, empty;
+    const char *attributes, *attributesEnd;
+    while (true){
+        const char *recordStart = (const char *)memchr(cursor, '<', limit - cursor);
+        if (recordStart) cursor = recordStart;
+        if (!recordStart || cursor >= chunkEnd) return false;
+        record.position = tell();
+        if (!readXmlTag(tag, closing, empty, attributes, attributesEnd)) return false;
+        record.properties.clear();
+        if (closing){
+            if (tag == "module"){
+                record.kind = RECORD_MODULE_END;
+                record.id = moduleStack.empty() ? 0 : moduleStack.back();
+                if (!moduleStack.empty()) moduleStack.pop_back();
+                return true;
+            }
+            if (tag == "document"){
+                cursor = limit;
+                return false;
+            }
+            continue;
+        }
+        record.name = getXmlAttribute(attributes, attributesEnd, "name");
+        record.id = parseId(getXmlAttribute(attributes, attributesEnd, "id"));
+        if (tag == "event"){
+            record.kind = RECORD_EVENT;
+            record.id = 0;
+            record.eventTypeId = parseId(getXmlAttribute(attributes, attributesEnd, "type"));
+            record.traceId = parseId(getXmlAttribute(attributes, attributesEnd, "trace"));
+            record.moduleId = parseId(getXmlAttribute(attributes, attributesEnd, "module"));
+            StringRef time = getXmlAttribute(attributes, attributesEnd, "time");
+            bool ok;
+            record.time = parseUnsigned(time, ok);
+            if (!ok){
+                char buffer[64];
+                if (!terminate(time, buffer, sizeof(buffer))) return fail("Event without a time");
+                double seconds = strtod(buffer, 0);
+                record.time = (unsigned long long)(seconds / resolution + 0.5);
+            }
+            StringRef duration = getXmlAttribute(attributes, attributesEnd, "duration");
+            record.span = duration.length > 0;
+            record.duration = record.span ? parseUnsigned(duration, ok) : 0;
+            return empty || readXmlProperties(record, "event");
+        }
+        if (tag == "module"){
+            record.kind = RECORD_MODULE_BEGIN;
+            record.parentId = moduleStack.empty() ? 0 : moduleStack.back();
+            moduleStack.push_back(record.id);
+            return true;
+        }
+        if (tag == "eventtype"){
+            record.kind = RECORD_EVENTTYPE;
+            return empty || readXmlProperties(record, "eventtype");
+        }
+        if (tag == "trace"){
+            record.kind = RECORD_TRACE;
+            return empty || readXmlProperties(record, "trace");
+        }
+        if (tag == "signal"){
+            bool ok;
+            record.kind = RECORD_SIGNAL;
+            record.width = (int)parseUnsigned(getXmlAttribute(attributes, attributesEnd, "width"), ok);
+            return true;
+        }
+        if (tag == "change"){
+            bool ok;
+            record.kind = RECORD_CHANGE;
+            record.id = parseId(getXmlAttribute(attributes, attributesEnd, "signal"));
+            record.time = parseUnsigned(getXmlAttribute(attributes, attributesEnd, "time"), ok);
+            record.properties.resize(1);
+            record.properties[0].name = StringRef(CHANGE_VALUE_NAME, strlen(CHANGE_VALUE_NAME));
+            record.properties[0].text = getXmlAttribute(attributes, attributesEnd, "value");
+            record.properties[0].type = PROPERTY_STRING;
+            return true;
+        }
+        if (tag == "link"){
+            bool ok;
+            record.kind = RECORD_LINK;
+            record.id = getXmlAttribute(attributes, attributesEnd, "type") == "merge" ? LINK_MERGE : LINK_CHILD;
+            record.parentId = parseId(getXmlAttribute(attributes, attributesEnd, "from"));
+            record.traceId = parseId(getXmlAttribute(attributes, attributesEnd, "to"));
+            record.time = parseUnsigned(getXmlAttribute(attributes, attributesEnd, "time"), ok);
+            return true;
+        }
+        //Anything else is skipped
+    }
+}
+
+//Reads <property/> elements up to the closing tag of the record
+bool TraceReader::readXmlProperties(TraceRecord &record, const char *closeTag){
+    StringRef tag;
+    bool closing, empty;
+    const char *attributes, *attributesEnd;
+    while (readXmlTag(tag, closing, empty, attributes, attributesEnd)){
+        if (closing && tag == closeTag) return true;
+        if (!closing && tag == "property"){
+            record.properties.resize(record.properties.size() + 1);
+            PropertyRef &property = record.properties.back();
+            property.name = getXmlAttribute(attributes, attributesEnd, "name");
+            property.text = getXmlAttribute(attributes, attributesEnd, "value");
+            property.type = PROPERTY_STRING;
+        }
+    }
+    if (error.empty()) fail(string("Trace ends inside <") + closeTag + ">");
+    return false;
+}
+
+#pragma mark -
+#pragma mark Binary
+
+bool TraceReader::readBinaryHeader(){
+    cursor = start + 4;
+    if (cursor >= limit || (unsigned char)*cursor != BINARY_VERSION) return fail("Unsupported binary trace version");
+    cursor++;
+    unsigned long long femtoseconds;
+    if (!readVarint(femtoseconds)) return false;
+    resolution = femtoseconds * 1e-15;
+    keys.resize(1);
+    return true;
+}
+
+bool TraceReader::readVarint(unsigned long long &value){
+    value = 0;
+    int shift = 0;
+    while (cursor < limit && shift < 64){
+        unsigned char byte = (unsigned char)*cursor++;
+        value |= (unsigned long long)(byte & 0x7F) << shift;
+        if (byte < 0x80) return true;
+        shift += 7;
+    }
+    return fail("Bad varint in binary trace");
+}
+
+bool TraceReader::readBinaryString(StringRef &str){
+    unsigned long long length;
+    if (!readVarint(length)) return false;
+    if (length > (unsigned long long)(limit - cursor)) return fail("String runs past the end of the trace");
+    str = StringRef(cursor, (size_t)length);
+    cursor += length;
+    return true;
+}
+
+bool TraceReader::nextBinary(TraceRecord &record){
+    unsigned long long values[5];
+    while (cursor < chunkEnd){
+        record.position = tell();
+        unsigned char tag = (unsigned char)*cursor++;
+        record.properties.clear();
+        switch (tag){
+            case BIN_KEY: {
+                //Not a record of its own, just remember the name
+                StringRef name;
+                if (!readVarint(values[0]) || !readBinaryString(name)) return false;
+                if (keys.size() <= values[0]) keys.resize(values[0] + 1);
+                keys[values[0]] = name;
+                break;
+            }
+            case BIN_MODULE_BEGIN:
+                if (!readVarint(values[0]) || !readBinaryString(record.name)) return false;
+                record.kind = RECORD_MODULE_BEGIN;
+                record.id = (int)values[0];
+                record.parentId = moduleStack.empty() ? 0 : moduleStack.back();
+                moduleStack.push_back(record.id);
+                return true;
+            case BIN_MODULE_END:
+                record.kind = RECORD_MODULE_END;
+                record.id = moduleStack.empty() ? 0 : moduleStack.back();
+                if (!moduleStack.empty()) moduleStack.pop_back();
+                return true;
+            case BIN_EVENTTYPE:
+            case BIN_TRACE:
+                if (!readVarint(values[0]) || !readBinaryString(record.name)) return false;
+                record.kind = (tag == BIN_TRACE) ? RECORD_TRACE : RECORD_EVENTTYPE;
+                record.id = (int)values[0];
+                return readBinaryProperties(record);
+            case BIN_EVENT:
+            case BIN_EVENT_SHORT:
+            case BIN_SPAN:
+            case BIN_SPAN_SHORT: {
+                record.span = (tag == BIN_SPAN || tag == BIN_SPAN_SHORT);
+                int count = record.span ? 5 : 4;
+                for (int i = 0; i < count; i++){
+                    if (!readVarint(values[i])) return false;
+                }
+                record.kind = RECORD_EVENT;
+                record.id = 0;
+                record.eventTypeId = (int)values[0];
+                record.traceId = (int)values[1];
+                record.moduleId = (int)values[2];
+                record.time = values[3];
+                record.duration = record.span ? values[4] : 0;
+                return (tag == BIN_EVENT_SHORT || tag == BIN_SPAN_SHORT) || readBinaryProperties(record);
+            }
+            case BIN_SIGNAL:
+                if (!readVarint(values[0]) || !readBinaryString(record.name) || !readVarint(values[1])) return false;
+                record.kind = RECORD_SIGNAL;
+                record.id = (int)values[0];
+                record.width = (int)values[1];
+                return true;
+            case BIN_CHANGE:
+                if (!readVarint(values[0]) || !readVarint(values[1])) return false;
+                record.kind = RECORD_CHANGE;
+                record.id = (int)values[0];
+                record.time = values[1];
+                record.properties.resize(1);
+                record.properties[0].name = StringRef(CHANGE_VALUE_NAME, strlen(CHANGE_VALUE_NAME));
+                record.properties[0].text = StringRef();
+                return readBinaryValue(record.properties[0]);
+            case BIN_LINK:
+                if (!readVarint(values[0]) || !readVarint(values[1]) || !readVarint(values[2]) || !readVarint(values[3])) return false;
+                record.kind = RECORD_LINK;
+                record.id = (int)values[0];
+                record.parentId = (int)values[1];
+                record.traceId = (int)values[2];
+                record.time = values[3];
+                return true;
+            case BIN_EOF:
+                cursor = limit;
+                return false;
+            default: {
+                char message[64];
+                sprintf(message, "Unknown record tag 0x%02X in binary trace", tag);
+                return fail(message);
+            }
+        }
+    }
+    return false;
+}
+
+//Reads properties, and any key records between them, up to BIN_END
+bool TraceReader::readBinaryProperties(TraceRecord &record){
+    unsigned long long keyId;
+    while (cursor < limit){
+        unsigned char tag = (unsigned char)*cursor++;
+        if (tag == BIN_END) return true;
+        if (tag == BIN_KEY){
+            StringRef name;
+            if (!readVarint(keyId) || !readBinaryString(name)) return false;
+            if (keys.size() <= keyId) keys.resize(keyId + 1);
+            keys[keyId] = name;
+            continue;
+        }
+        if (tag != BIN_PROPERTY && tag != BIN_PROPERTY_TYPED) return fail("Unexpected record inside a binary record");
+        if (!readVarint(keyId)) return false;
+        record.properties.resize(record.properties.size() + 1);
+        PropertyRef &property = record.properties.back();
+        property.name = getKey(keyId);
+        property.text = StringRef();
+        if (tag == BIN_PROPERTY){
+            property.type = PROPERTY_STRING;
+            if (!readBinaryString(property.text)) return false;
+            continue;
+        }
+        if (!readBinaryValue(property)) return false;
+    }
+    return fail("Trace ends inside a record");
+}
+
+//Reads the type byte and value of a typed property or change
+bool TraceReader::readBinaryValue(PropertyRef &property){
+    unsigned long long value;
+    if (cursor >= limit) return fail("Trace ends inside a property");
+    unsigned char valueType = (unsigned char)*cursor++;
+    switch (valueType){
+        case BIN_VALUE_INT:
+            if (!readVarint(value)) return false;
+            property.type = PROPERTY_INT;
+            property.intValue = (long long)(value >> 1) ^ -(long long)(value & 1);
+            break;
+        case BIN_VALUE_DOUBLE: {
+            if (limit - cursor < 8) return fail("Trace ends inside a property");
+            unsigned long long bits = 0;
+            for (int i = 7; i >= 0; i--){
+                bits = (bits << 8) | (unsigned char)cursor[i];
+            }
+            cursor += 8;
+            property.type = PROPERTY_DOUBLE;
+            memcpy(&property.doubleValue, &bits, sizeof(double));
+            break;
+        }
+        case BIN_VALUE_BOOL:
+            if (cursor >= limit) return fail("Trace ends inside a property");
+            property.type = PROPERTY_BOOL;
+            property.boolValue = (*cursor++ != 0);
+            break;
+        case BIN_VALUE_BLOB:
+            property.type = PROPERTY_BLOB;
+            if (!readBinaryString(property.text)) return false;
+            break;
+        case BIN_VALUE_STRING:
+            property.type = PROPERTY_STRING;
+            if (!readBinaryString(property.text)) return false;
+            break;
+        default:
+            return fail("Unknown property type in binary trace");
+    }
+    return true;
+}
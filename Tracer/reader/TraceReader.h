@@ -0,0 +1,293 @@
+/*
+ *  TraceReader.h
+ *  LPTracer
+ *
+ *  http://www.logicpoet.com
+ *
+ *  Copyright 2008 Logic Poet. All rights reserved.
+ *
+ *  The MIT License
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without
+ *  restriction, including without limitation the rights to use,
+ *  copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following
+ *  conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *  OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _LPT_TRACE_READER_H_
+#define _LPT_TRACE_READER_H_
+
+//Reader for the trace files written by the Tracer, both XML and binary and
+//optionally compressed.  The file is memory mapped and everything the reader
+//hands out refers straight into the mapped bytes, so walking the events of a
+//trace does not allocate.  Views stay valid until the reader is closed.
+//
+//This does not need SystemC.  Build it into your tool with the Tracer source
+//directory on the include path:
+//  g++ -O2 -I../source -c TraceReader.cpp
+//To read compressed traces also define LPTRACE_ZLIB and link with -lz.
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include "TraceFormat.h"
+#include "TraceFile.h"
+#include "PropertyValue.h"
+
+using std::string;
+using std::vector;
+
+namespace lpt{
+
+#pragma mark -
+#pragma mark StringRef
+    //Non-owning view of bytes in the trace
+    class StringRef{
+    public:
+        StringRef(){ data = ""; length = 0; }
+        StringRef(const char *data, size_t length){ this->data = data; this->length = length; }
+        bool operator==(const StringRef &other) const {
+            return length == other.length && memcmp(data, other.data, length) == 0;
+        }
+        bool operator==(const char *str) const {
+            return strlen(str) == length && memcmp(data, str, length) == 0;
+        }
+        bool operator!=(const StringRef &other) const { return !(*this == other); }
+        bool operator!=(const char *str) const { return !(*this == str); }
+        bool empty() const { return length == 0; }
+        string str() const { return string(data, length); }
+        const char *data;
+        size_t length;
+    };
+
+#pragma mark -
+#pragma mark PropertyRef
+    //A property as it appears in the file.  Binary traces keep the type the
+    //property was recorded with; everything in an XML trace is PROPERTY_STRING.
+    //The get methods convert either way, parsing text when needed.
+    class PropertyRef{
+    public:
+        PropertyRef(){ type = PROPERTY_NONE; intValue = 0; }
+        StringRef name;
+        PropertyType type;
+        StringRef text;         //String value, blob bytes or the XML text
+        union {
+            long long intValue;
+            double doubleValue;
+            bool boolValue;
+        };
+        //Text is read as a decimal or 0x hex integer, a double, or True/False
+        bool getInt(long long &value) const;
+        bool getDouble(double &value) const;
+        bool getBool(bool &value) const;
+        //Formatted the way the XML writer shows it
+        string toString() const;
+    };
+
+#pragma mark -
+#pragma mark TraceRecord
+    enum RecordKind {
+        RECORD_MODULE_BEGIN,    //Modules nest, each begin has a matching end
+        RECORD_MODULE_END,
+        RECORD_EVENTTYPE,
+        RECORD_TRACE,
+        RECORD_EVENT,
+        RECORD_SIGNAL,          //A traced signal, declared before its first change
+        RECORD_CHANGE,          //New value of a signal, held in the one property
+        RECORD_LINK             //Child or merge link between two traces, see below
+    };
+
+    //One record of the file.  Reading into the same record again reuses its
+    //property storage, so a loop over next() stops allocating once warmed up.
+    class TraceRecord{
+    public:
+        TraceRecord(){ kind = RECORD_EVENT; id = parentId = eventTypeId = traceId = moduleId = width = 0; time = duration = 0; span = false; }
+        RecordKind kind;
+        int id;                 //Module, event type, trace or signal id, TraceLinkKind for links
+        int parentId;           //Module begin only, 0 for a top level module, linked from trace for links
+        StringRef name;         //Module, event type, trace or signal name
+        int eventTypeId;        //Events only
+        int traceId;            //Events, and the linked to trace for links
+        int moduleId;
+        int width;              //Signals only, in bits (0 for reals and enums)
+        unsigned long long time;    //Events, changes and links, in units of the file's time resolution
+        bool span;                  //Events only, true for an event recorded with a duration
+        unsigned long long duration;    //Spans only, in the same units as time
+        TracePosition position;     //Where the record starts, usable with seek()
+        vector<PropertyRef> properties;
+        const PropertyRef* findProperty(const char *name) const;
+    };
+
+    //What the reader has learned about ids from the records read so far
+    struct ModuleInfo{
+        int id;
+        int parentId;
+        int depth;
+        StringRef name;
+    };
+    struct EventTypeInfo{
+        int id;
+        StringRef name;
+    };
+    struct TraceInfo{
+        int id;
+        StringRef name;
+        TracePosition position;
+    };
+    struct SignalInfo{
+        int id;
+        StringRef name;
+        int width;
+    };
+
+#pragma mark -
+#pragma mark TraceReader
+    class TraceReader{
+    public:
+        TraceReader();
+        ~TraceReader();
+        //Compressed traces are inflated up front, using up to threads threads
+        bool open(const string &filename, unsigned int threads = 1);
+        //Reads a trace already in memory.  The bytes must outlive the reader.
+        bool open(const char *bytes, size_t length, unsigned int threads = 1);
+        void close();
+        const string& getError() { return error; }
+        OutputFormat getFormat() { return format; }
+        bool isCompressed() { return !blocks.empty(); }
+        //Bytes of trace data, after inflating a compressed trace
+        size_t getSize() { return limit - start; }
+        //Seconds per unit of TraceRecord::time
+        double getResolution() { return resolution; }
+
+        //Reads the next record, returning false at the end of the file or on an
+        //error (getError() is empty at a clean end)
+        bool next(TraceRecord &record);
+        //Positions come from TraceRecord::position or an index file.  After a
+        //seek the module nesting of later records is unknown, so module records
+        //should be read from the start.
+        bool seek(const TracePosition &position);
+        TracePosition tell();
+        //Reads the one record at position and comes back to where it was, for
+        //looking up a trace or event type declared before a seek
+        bool readAt(const TracePosition &position, TraceRecord &record);
+
+        //Lookups for ids seen so far, 0 if the id has not been read yet
+        const ModuleInfo* getModule(int id);
+        const EventTypeInfo* getEventType(int id);
+        const TraceInfo* getTrace(int id);
+        const SignalInfo* getSignal(int id);
+        int getModuleCount() { return (int)modules.size() - 1; }
+        int getEventTypeCount() { return (int)eventTypes.size() - 1; }
+        int getTraceCount() { return (int)(traceBase + traces.size()) - 1; }
+        //Sets the name of a binary property key, for reading from the middle of
+        //a file (see IndexReader::getKeys).  The name must outlive the reader.
+        void setKey(int keyId, const StringRef &name);
+        //Dot separated names from the top module down
+        string getModulePath(int id);
+        //True if module id is ancestor or one of its children
+        bool isInSubtree(int id, int ancestor);
+
+        //Input iterator over the records, for use with standard algorithms
+        class iterator{
+        public:
+            iterator(){ reader = 0; }
+            iterator(TraceReader *reader){ this->reader = reader; ++(*this); }
+            const TraceRecord& operator*() const { return record; }
+            const TraceRecord* operator->() const { return &record; }
+            iterator& operator++(){
+                if (reader && !reader->next(record)) reader = 0;
+                return *this;
+            }
+            bool operator==(const iterator &other) const { return reader == other.reader; }
+            bool operator!=(const iterator &other) const { return reader != other.reader; }
+        protected:
+            TraceReader *reader;
+            TraceRecord record;
+        };
+        iterator begin() { return iterator(this); }
+        iterator end() { return iterator(); }
+
+    protected:
+        friend class ParallelTraceReader;
+        friend class TraceQuery;
+        //The bytes being parsed, either the mapping or the inflated file
+        const char *start;
+        const char *cursor;
+        const char *limit;
+        //No record starting at or after this is returned.  It is the limit except
+        //when reading one chunk of a file.
+        const char *chunkEnd;
+        //Memory mapping of the file, if we made one
+        void *mapping;
+        size_t mappingLength;
+        //Compressed files are inflated into one buffer.  blocks holds the frame
+        //offset and inflated offset of each block for converting positions.
+        vector<char> inflated;
+        struct Block{
+            unsigned long long frameOffset;
+            unsigned long long inflatedOffset;
+        };
+        vector<Block> blocks;
+        OutputFormat format;
+        double resolution;
+        bool legacyTimes;           //XML written with times in seconds
+        string error;
+        vector<ModuleInfo> modules;
+        vector<EventTypeInfo> eventTypes;
+        vector<SignalInfo> signals;
+        vector<TraceInfo> traces;
+        //Id of traces[0].  A chunk starts its table at the first trace it reads
+        //rather than holding every id before it.
+        size_t traceBase;
+        vector<int> moduleStack;
+        vector<StringRef> keys;     //Binary property names by key id
+        //For a chunk, the reader of the whole file.  Ids the chunk hasn't read
+        //itself are looked up there.
+        TraceReader *base;
+        StringRef getKey(unsigned long long keyId);
+
+        bool openBytes(const char *bytes, size_t length, unsigned int threads);
+        bool inflate(const char *bytes, size_t length, unsigned int threads);
+        //Chunks of a file another reader has opened, by offset into its bytes
+        bool openChunk(TraceReader &whole, unsigned long long begin, unsigned long long end);
+        bool getOffset(const TracePosition &position, unsigned long long &offset);
+        unsigned long long findXmlRecordStart(unsigned long long offset);
+        void mergeTables(const TraceReader &other);
+        void mergeTraces(size_t otherBase, const vector<TraceInfo> &otherTraces);
+        bool fail(const string &message);
+        void remember(const TraceRecord &record);
+        //XML
+        bool readXmlHeader();
+        bool nextXml(TraceRecord &record);
+        bool readXmlTag(StringRef &tag, bool &closing, bool &empty, const char *&attributes, const char *&attributesEnd);
+        bool readXmlProperties(TraceRecord &record, const char *closeTag);
+        static StringRef getXmlAttribute(const char *attributes, const char *attributesEnd, const char *name);
+        static int parseId(const StringRef &text);
+        //Binary
+        bool readBinaryHeader();
+        bool nextBinary(TraceRecord &record);
+        bool readBinaryProperties(TraceRecord &record);
+        bool readBinaryValue(PropertyRef &property);
+        bool readVarint(unsigned long long &value);
+        bool readBinaryString(StringRef &str);
+    };
+
+} //namespace lpt
+
+#endif
@@ -36,21 +36,48 @@
 
 #include "systemc.h"
 #include "ModelBase.h"
+#include <vector>
+
+using std::vector;
 
 namespace lpt{
     
+    //Lightweight id for an event type declared up front with EventType::declare().
+    //Marking with a handle is an array index instead of a string lookup.
+    class EventTypeHandle{
+    public:
+        EventTypeHandle(){ id = 0; }
+        explicit EventTypeHandle(unsigned int id){ this->id = id; }
+        unsigned int id;
+    };
+
+    //How much of a tlm_generic_payload's data buffer is recorded on an event
+    enum DataCapture {
+        CAPTURE_DEFAULT,        //Use the Tracer's setting (full unless changed)
+        CAPTURE_FULL,           //Every byte as hex
+        CAPTURE_FIRST_BYTES,    //Only the first N bytes
+        CAPTURE_HASH,           //64 bit FNV-1a hash of the data instead of the data
+        CAPTURE_NONE            //No data at all
+    };
+
     class EventType : public ModelBase{
     protected:
         string          name;
         string          category;
+        DataCapture     dataCapture;
+        unsigned int    dataCaptureLimit;
     public:
         EventType(string name){
             this->name = name;
             this->category = "";
+            dataCapture = CAPTURE_DEFAULT;
+            dataCaptureLimit = 0;
         }
         EventType(string category, string name){
             this->name = name;
             this->category = category;
+            dataCapture = CAPTURE_DEFAULT;
+            dataCaptureLimit = 0;
         }
         string getName() { return name; }
         string getCategory() { return name; }
@@ -58,6 +85,50 @@ namespace lpt{
             if (category != "") return category+"."+name;
             else return name;
         }
+        //Payload data capture for events of this type.  The limit is the number
+        //of bytes kept by CAPTURE_FIRST_BYTES.
+        void setDataCapture(DataCapture capture, unsigned int limit = 0){
+            dataCapture = capture;
+            dataCaptureLimit = limit;
+        }
+        DataCapture getDataCapture() { return dataCapture; }
+        unsigned int getDataCaptureLimit() { return dataCaptureLimit; }
+        //Declares an event type once, usually into a static handle, so events can
+        //be marked without building or looking up strings.  Declaring the same
+        //full name again returns the same handle.  Handles are shared by all Tracers.
+        static EventTypeHandle declare(string name){
+            return declare(string(""), name);
+        }
+        static EventTypeHandle declare(string category, string name){
+            string fullName = (category != "") ? category+"."+name : name;
+            map<string, unsigned int>::iterator iter = declaredNames().find(fullName);
+            if (iter != declaredNames().end()) return EventTypeHandle(iter->second);
+            return declare(new EventType(category, name));
+        }
+        static EventTypeHandle declare(EventType *eType){
+            map<string, unsigned int>::iterator iter = declaredNames().find(eType->getFullName());
+            if (iter != declaredNames().end()) return EventTypeHandle(iter->second);
+            vector<EventType *> &types = declaredTypes();
+            if (types.empty()) types.push_back(0);   //Handle 0 is never valid
+            unsigned int id = types.size();
+            types.push_back(eType);
+            declaredNames()[eType->getFullName()] = id;
+            return EventTypeHandle(id);
+        }
+        static EventType* fromHandle(EventTypeHandle handle){
+            vector<EventType *> &types = declaredTypes();
+            return (handle.id < types.size()) ? types[handle.id] : 0;
+        }
+    protected:
+        //Function statics so declaring handles from static initializers is safe
+        static vector<EventType *>& declaredTypes(){
+            static vector<EventType *> types;
+            return types;
+        }
+        static map<string, unsigned int>& declaredNames(){
+            static map<string, unsigned int> names;
+            return names;
+        }
     };
 }
 
@@ -0,0 +1,185 @@
+/*
+ *  IdMap.h
+ *  LPTracer
+ *
+ *  http://www.logicpoet.com
+ *
+ *  Copyright 2008 Logic Poet. All rights reserved.
+ *
+ *  The MIT License
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without
+ *  restriction, including without limitation the rights to use,
+ *  copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following
+ *  conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *  OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _LPT_ID_MAP_H_
+#define _LPT_ID_MAP_H_
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+using std::string;
+using std::vector;
+
+namespace lpt{
+
+    //Hash functions for the key types the Tracer looks up on every event
+    template <class Key> struct IdMapHash;
+
+    template <class T> struct IdMapHash<T*>{
+        size_t operator()(T *ptr) const {
+            //Fibonacci hashing, the low bits of a heap pointer are mostly zero
+            unsigned long long key = (unsigned long long)(size_t)ptr;
+            key *= 0x9E3779B97F4A7C15ULL;
+            return (size_t)(key ^ (key >> 29));
+        }
+    };
+
+    template <> struct IdMapHash<string>{
+        size_t operator()(const string &str) const {
+            //FNV-1a
+            unsigned long long hash = 0xCBF29CE484222325ULL;
+            for (size_t i = 0; i < str.size(); i++){
+                hash ^= (unsigned char)str[i];
+                hash *= 0x100000001B3ULL;
+            }
+            return (size_t)hash;
+        }
+    };
+
+    //Open addressing hash map with linear probing.  All slots live in one
+    //contiguous array so a lookup is usually a single cache miss, which is much
+    //cheaper than walking a std::map once there are many live traces.
+    template <class Key, class Value, class Hash = IdMapHash<Key> >
+    class IdMap{
+    public:
+        IdMap(){
+            count = 0;
+            used = 0;
+            slots.resize(16);
+            mask = slots.size()-1;
+        }
+
+        //Returns a pointer to the value for key or 0 if it is not in the map
+        Value* find(const Key &key){
+            size_t index = hash(key) & mask;
+            while (true){
+                Slot &slot = slots[index];
+                if (slot.state == EMPTY) return 0;
+                if (slot.state == FULL && slot.key == key) return &slot.value;
+                index = (index+1) & mask;
+            }
+        }
+
+        //Inserts or overwrites the value for key
+        void insert(const Key &key, const Value &value){
+            Value *existing = find(key);
+            if (existing){
+                *existing = value;
+                return;
+            }
+            if ((used+1)*4 > slots.size()*3) rehash();
+            size_t index = hash(key) & mask;
+            while (slots[index].state == FULL){
+                index = (index+1) & mask;
+            }
+            Slot &slot = slots[index];
+            if (slot.state == EMPTY) used++;
+            slot.key = key;
+            slot.value = value;
+            slot.state = FULL;
+            count++;
+        }
+
+        //Removes key, leaving a tombstone so probe chains stay intact
+        bool erase(const Key &key){
+            size_t index = hash(key) & mask;
+            while (true){
+                Slot &slot = slots[index];
+                if (slot.state == EMPTY) return false;
+                if (slot.state == FULL && slot.key == key){
+                    slot.state = DELETED;
+                    slot.key = Key();
+                    slot.value = Value();
+                    count--;
+                    return true;
+                }
+                index = (index+1) & mask;
+            }
+        }
+
+        size_t size() const { return count; }
+
+        //Sizes the table so entries keys fit without growing it
+        void reserve(size_t entries){
+            size_t capacity = slots.size();
+            while (entries*2 >= capacity) capacity *= 2;
+            if (capacity > slots.size()) resize(capacity);
+        }
+
+    protected:
+        enum SlotState { EMPTY = 0, FULL, DELETED };
+        struct Slot{
+            Key key;
+            Value value;
+            unsigned char state;
+            Slot() : key(), value(), state(EMPTY) {}
+        };
+        vector<Slot> slots;
+        size_t mask;
+        size_t count;   //Full slots
+        size_t used;    //Full and deleted slots
+        Hash hash;
+
+        //Grows the table, or just clears out tombstones if that frees enough room
+        void rehash(){
+            size_t capacity = slots.size();
+            while (count*2 >= capacity) capacity *= 2;
+            resize(capacity);
+        }
+
+        //Moves every key into a table of capacity slots
+        void resize(size_t capacity){
+            vector<Slot> old;
+            old.swap(slots);
+            slots.resize(capacity);
+            mask = capacity-1;
+            count = 0;
+            used = 0;
+            for (size_t i = 0; i < old.size(); i++){
+                if (old[i].state != FULL) continue;
+                size_t index = hash(old[i].key) & mask;
+                while (slots[index].state == FULL){
+                    index = (index+1) & mask;
+                }
+                slots[index].key = old[i].key;
+                slots[index].value = old[i].value;
+                slots[index].state = FULL;
+                count++;
+                used++;
+            }
+        }
+    };
+
+} //namespace lpt
+
+#endif
@@ -0,0 +1,154 @@
+/*
+ *  LatencyHistogram.h
+ *  LPTracer
+ *
+ *  http://www.logicpoet.com
+ *
+ *  Copyright 2008 Logic Poet. All rights reserved.
+ *
+ *  The MIT License
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without
+ *  restriction, including without limitation the rights to use,
+ *  copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following
+ *  conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *  OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _LPT_LATENCY_HISTOGRAM_H_
+#define _LPT_LATENCY_HISTOGRAM_H_
+
+#include <vector>
+#include <cmath>
+
+using std::vector;
+
+namespace lpt{
+
+    //Histogram of latencies in ticks with log sized buckets, in the manner of
+    //HdrHistogram.  Values below 2^subBucketBits each get their own bucket;
+    //above that every power of two is split into 2^subBucketBits buckets, so a
+    //value is off by at most 1/2^subBucketBits of itself (1.6% with the default
+    //of 6 bits).  Recording is a shift and an array increment, and the buckets
+    //only go as high as the largest value recorded.  Used both by the Tracer
+    //while simulating and by the latency analysis of recorded traces.
+    class LatencyHistogram{
+    public:
+        LatencyHistogram(unsigned int subBucketBits = 6){
+            bits = subBucketBits;
+            clear();
+        }
+
+        void clear(){
+            counts.clear();
+            total = 0;
+            sum = 0;
+            minValue = ~0ULL;
+            maxValue = 0;
+        }
+
+        void record(unsigned long long value, unsigned long long count = 1){
+            size_t index = getBucketIndex(value);
+            if (index >= counts.size()) counts.resize(index + 1, 0);
+            counts[index] += count;
+            total += count;
+            sum += (double)value * count;
+            if (value < minValue) minValue = value;
+            if (value > maxValue) maxValue = value;
+        }
+
+        void merge(const LatencyHistogram &other){
+            if (other.bits != bits){
+                for (size_t i = 0; i < other.counts.size(); i++){
+                    if (other.counts[i]) record(other.getBucketLow(i), other.counts[i]);
+                }
+                return;
+            }
+            if (counts.size() < other.counts.size()) counts.resize(other.counts.size(), 0);
+            for (size_t i = 0; i < other.counts.size(); i++) counts[i] += other.counts[i];
+            total += other.total;
+            sum += other.sum;
+            if (other.total && other.minValue < minValue) minValue = other.minValue;
+            if (other.maxValue > maxValue) maxValue = other.maxValue;
+        }
+
+        unsigned long long getCount() const { return total; }
+        unsigned long long getMin() const { return total ? minValue : 0; }
+        unsigned long long getMax() const { return maxValue; }
+        double getMean() const { return total ? sum / total : 0; }
+
+        //The highest value that percent of the recorded values are at or below,
+        //to within the bucket precision
+        unsigned long long getPercentile(double percent) const {
+            if (!total) return 0;
+            unsigned long long target = (unsigned long long)ceil(percent / 100 * total);
+            if (target < 1) target = 1;
+            if (target > total) target = total;
+            unsigned long long seen = 0;
+            for (size_t i = 0; i < counts.size(); i++){
+                seen += counts[i];
+                if (seen >= target){
+                    unsigned long long high = getBucketLow(i) + getBucketWidth(i) - 1;
+                    if (high > maxValue) high = maxValue;
+                    if (high < minValue) high = minValue;
+                    return high;
+                }
+            }
+            return maxValue;
+        }
+
+        //Buckets, for printing the distribution
+        size_t getBucketCount() const { return counts.size(); }
+        unsigned long long getBucketValueCount(size_t index) const { return counts[index]; }
+        unsigned long long getBucketLow(size_t index) const {
+            if (index < ((size_t)2 << bits)) return index;
+            unsigned int shift = (unsigned int)(index >> bits) - 1;
+            return (unsigned long long)(index - ((size_t)shift << bits)) << shift;
+        }
+        unsigned long long getBucketWidth(size_t index) const {
+            if (index < ((size_t)2 << bits)) return 1;
+            return 1ULL << ((index >> bits) - 1);
+        }
+
+    protected:
+        unsigned int bits;
+        vector<unsigned long long> counts;
+        unsigned long long total;
+        double sum;
+        unsigned long long minValue;
+        unsigned long long maxValue;
+
+        static unsigned int highestBit(unsigned long long value){
+#ifdef __GNUC__
+            return 63 - __builtin_clzll(value);
+#else
+            unsigned int bit = 0;
+            while (value >>= 1) bit++;
+            return bit;
+#endif
+        }
+        size_t getBucketIndex(unsigned long long value) const {
+            if (value < (1ULL << bits)) return (size_t)value;
+            unsigned int shift = highestBit(value) - bits;
+            return (size_t)(((unsigned long long)shift << bits) + (value >> shift));
+        }
+    };
+
+} //namespace lpt
+
+#endif
@@ -36,45 +36,65 @@
 
 #include <string>
 #include <map>
+#include "PropertyValue.h"
 
 using std::string;
 using std::map;
 
 namespace lpt{
 
+//Properties keep their native type until the output backend writes them, so
+//adding a number is just a store and the binary format can keep it raw.
 class ModelBase{
 protected:
-    map<string,string> properties;
+    map<string,StoredProperty> properties;
+    //Text version of the properties, only built if getProperties() is called
+    map<string,string> formattedProperties;
 public:
-    map<string,string>* getProperties() { return &properties; }
-    void setProperties(map<string,string> propertyMap){
-        this->properties = propertyMap;
-    }
-    void addProperty(string name, string value){
-        properties[name] = value;
+    const map<string,StoredProperty>* getTypedProperties() const { return &properties; }
+    //Returns a value of type PROPERTY_NONE if there is no such property
+    PropertyValue getProperty(const string &name) const {
+        map<string,StoredProperty>::const_iterator iter = properties.find(name);
+        if (iter == properties.end()) return PropertyValue();
+        return iter->second.getValue();
     }
-    void addProperty(string name, int  value){
-        char buffer[128];
-        sprintf(buffer, "%d", value);
-        addProperty(name, buffer);
+    //Legacy text view of the properties.  Formats every value, so the tracer
+    //itself uses getTypedProperties().
+    map<string,string>* getProperties() {
+        formattedProperties.clear();
+        map<string,StoredProperty>::const_iterator iter;
+        for (iter = properties.begin(); iter != properties.end(); iter++){
+            formattedProperties[iter->first] = iter->second.getValue().toString();
+        }
+        return &formattedProperties;
     }
-    void addProperty(string name, float  value){
-        char buffer[128];
-        sprintf(buffer, "%g", value);
-        addProperty(name, buffer);
+    void setProperties(map<string,string> propertyMap){
+        properties.clear();
+        map<string,string>::const_iterator iter;
+        for (iter = propertyMap.begin(); iter != propertyMap.end(); iter++){
+            properties[iter->first] = StoredProperty(iter->second);
+        }
     }
-    void addProperty(string name, double  value){
-        char buffer[128];
-        sprintf(buffer, "%g", value);
-        addProperty(name, buffer);
+    void addProperty(string name, const PropertyValue &value){
+        properties[name] = StoredProperty(value);
     }
-    void addProperty(string name, bool  value){
-        string strValue = (value) ? "True" : "False";
-        addProperty(name, strValue);
+    //Explicit overloads so a string literal doesn't convert to bool
+    void addProperty(string name, string value){ addProperty(name, PropertyValue(value)); }
+    void addProperty(string name, const char *value){ addProperty(name, PropertyValue(value)); }
+    void addProperty(string name, int value){ addProperty(name, PropertyValue(value)); }
+    void addProperty(string name, unsigned int value){ addProperty(name, PropertyValue(value)); }
+    void addProperty(string name, long long value){ addProperty(name, PropertyValue(value)); }
+    void addProperty(string name, unsigned long long value){ addProperty(name, PropertyValue(value)); }
+    void addProperty(string name, float value){ addProperty(name, PropertyValue(value)); }
+    void addProperty(string name, double value){ addProperty(name, PropertyValue(value)); }
+    void addProperty(string name, bool value){ addProperty(name, PropertyValue(value)); }
+    //Raw bytes, written as hex by the text formats
+    void addBlobProperty(string name, const unsigned char *bytes, size_t length){
+        addProperty(name, PropertyValue::blob(bytes, length));
     }
 };
     
 }  //namespace lpt
 
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,79 @@
+/*
+ *  PropertyList.h
+ *  LPTracer
+ *
+ *  http://www.logicpoet.com
+ *
+ *  Copyright 2008 Logic Poet. All rights reserved.
+ *
+ *  The MIT License
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without
+ *  restriction, including without limitation the rights to use,
+ *  copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following
+ *  conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *  OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _LPT_PROPERTY_LIST_H_
+#define _LPT_PROPERTY_LIST_H_
+
+#include "PropertyValue.h"
+
+namespace lpt{
+
+    //Fixed capacity list of event properties that refers to the caller's strings
+    //rather than copying them, so building one never touches the heap.  Numbers
+    //are kept in their native type and only formatted by the output backend.
+    //Because nothing is copied the strings passed in must outlive the list, which
+    //is always the case for the usual pattern of building the list in the
+    //MarkEvent call itself:
+    //    MarkEvent(pkt, sendEvent, PropertyList().add("Sender", id).add("Port", portName));
+    //Properties past the capacity are dropped.
+    class PropertyList{
+    public:
+        enum { CAPACITY = 16 };
+
+        PropertyList(){
+            count = 0;
+        }
+        PropertyList& add(PropertyText name, const PropertyValue &value){
+            if (count < CAPACITY){
+                names[count] = name;
+                values[count] = value;
+                count++;
+            }
+            return *this;
+        }
+        PropertyList& addBlob(PropertyText name, const unsigned char *bytes, size_t length){
+            return add(name, PropertyValue::blob(bytes, length));
+        }
+
+        unsigned int size() const { return count; }
+        const PropertyText& getName(unsigned int index) const { return names[index]; }
+        const PropertyValue& getValue(unsigned int index) const { return values[index]; }
+
+    protected:
+        PropertyText names[CAPACITY];
+        PropertyValue values[CAPACITY];
+        unsigned int count;
+    };
+
+} //namespace lpt
+
+#endif
@@ -0,0 +1,245 @@
+/*
+ *  PropertyValue.h
+ *  LPTracer
+ *
+ *  http://www.logicpoet.com
+ *
+ *  Copyright 2008 Logic Poet. All rights reserved.
+ *
+ *  The MIT License
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without
+ *  restriction, including without limitation the rights to use,
+ *  copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following
+ *  conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *  OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _LPT_PROPERTY_VALUE_H_
+#define _LPT_PROPERTY_VALUE_H_
+
+#include <string>
+#include <cstring>
+#include <cstdio>
+
+using std::string;
+
+namespace lpt{
+
+    //Non-owning reference to a piece of text.  Converts implicitly from both C
+    //strings and std::string so it can be passed either without a copy.
+    class PropertyText{
+    public:
+        PropertyText(){ data = ""; length = 0; }
+        PropertyText(const char *str){ data = str; length = strlen(str); }
+        PropertyText(const string &str){ data = str.data(); length = str.size(); }
+        PropertyText(const char *str, size_t length){ data = str; this->length = length; }
+        string toString() const { return string(data, length); }
+        const char *data;
+        size_t length;
+    };
+
+    //Writes value in decimal to buffer, which must hold at least 20 characters.
+    //Returns the number of characters written (no terminating null).  Digits are
+    //produced two at a time from a table, which is much cheaper than sprintf.
+    inline size_t formatDecimal(unsigned long long value, char *buffer){
+        static const char pairs[] =
+            "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+            "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+            "8081828384858687888990919293949596979899";
+        char digits[20];
+        int pos = 20;
+        while (value >= 100){
+            unsigned int pair = (unsigned int)(value % 100) * 2;
+            value /= 100;
+            digits[--pos] = pairs[pair+1];
+            digits[--pos] = pairs[pair];
+        }
+        if (value >= 10){
+            digits[--pos] = pairs[value*2+1];
+            digits[--pos] = pairs[value*2];
+        }
+        else {
+            digits[--pos] = (char)('0' + value);
+        }
+        size_t length = 20 - pos;
+        memcpy(buffer, digits+pos, length);
+        return length;
+    }
+
+    //Signed version of formatDecimal, buffer must hold at least 21 characters
+    inline size_t formatDecimal(long long value, char *buffer){
+        if (value >= 0) return formatDecimal((unsigned long long)value, buffer);
+        buffer[0] = '-';
+        //Negate as unsigned so the most negative value doesn't overflow
+        return 1 + formatDecimal(0ULL - (unsigned long long)value, buffer+1);
+    }
+
+    //Writes length bytes to buffer as upper case hex, two characters a byte with
+    //no prefix, and returns the number of characters written.  With reverse set
+    //the last byte comes first so a little endian word reads as a number.
+    inline size_t formatHex(const unsigned char *bytes, size_t length, char *buffer, bool reverse){
+        //Both digits of every byte value, so each byte is a single 2 byte copy
+        static const char pairs[] =
+            "000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F"
+            "202122232425262728292A2B2C2D2E2F303132333435363738393A3B3C3D3E3F"
+            "404142434445464748494A4B4C4D4E4F505152535455565758595A5B5C5D5E5F"
+            "606162636465666768696A6B6C6D6E6F707172737475767778797A7B7C7D7E7F"
+            "808182838485868788898A8B8C8D8E8F909192939495969798999A9B9C9D9E9F"
+            "A0A1A2A3A4A5A6A7A8A9AAABACADAEAFB0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+            "C0C1C2C3C4C5C6C7C8C9CACBCCCDCECFD0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+            "E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEFF0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF";
+        if (reverse){
+            for (size_t i = 0; i < length; i++){
+                memcpy(buffer + 2*i, pairs + 2*bytes[length-1-i], 2);
+            }
+        }
+        else {
+            for (size_t i = 0; i < length; i++){
+                memcpy(buffer + 2*i, pairs + 2*bytes[i], 2);
+            }
+        }
+        return length*2;
+    }
+
+    //Types a property value can have.  Values keep their native type all the way
+    //to the output backend, which decides how to serialize them.
+    enum PropertyType {
+        PROPERTY_NONE,
+        PROPERTY_INT,
+        PROPERTY_DOUBLE,
+        PROPERTY_BOOL,
+        PROPERTY_STRING,
+        PROPERTY_BLOB
+    };
+
+    //Non-owning typed property value.  Strings and blobs refer to the caller's bytes.
+    class PropertyValue{
+    public:
+        PropertyValue(){ type = PROPERTY_NONE; intValue = 0; data = ""; length = 0; }
+        PropertyValue(const PropertyText &text){ setBytes(PROPERTY_STRING, text.data, text.length); }
+        PropertyValue(const char *str){ setBytes(PROPERTY_STRING, str, strlen(str)); }
+        PropertyValue(const string &str){ setBytes(PROPERTY_STRING, str.data(), str.size()); }
+        PropertyValue(int value){ setInt(value); }
+        PropertyValue(unsigned int value){ setInt(value); }
+        PropertyValue(long value){ setInt(value); }
+        PropertyValue(unsigned long value){ setInt((long long)value); }
+        PropertyValue(long long value){ setInt(value); }
+        PropertyValue(unsigned long long value){ setInt((long long)value); }
+        PropertyValue(float value){ setDouble(value); }
+        PropertyValue(double value){ setDouble(value); }
+        PropertyValue(bool value){ type = PROPERTY_BOOL; boolValue = value; data = ""; length = 0; }
+        static PropertyValue blob(const unsigned char *bytes, size_t length){
+            PropertyValue value;
+            value.setBytes(PROPERTY_BLOB, (const char *)bytes, length);
+            return value;
+        }
+
+        PropertyType type;
+        union {
+            long long intValue;
+            double doubleValue;
+            bool boolValue;
+        };
+        const char *data;       //String and blob bytes
+        size_t length;
+
+        //Formats the value as text the way the XML output shows it.  Returns the
+        //text, which is either in buffer or points at the string value itself.
+        //Blobs are written as one 0x hex number, last byte first as the XML output
+        //has always shown payload data; a buffer too small keeps the first bytes.
+        PropertyText format(char *buffer, size_t size) const {
+            switch (type){
+                case PROPERTY_INT:
+                    if (size < 21) return PropertyText();
+                    return PropertyText(buffer, formatDecimal(intValue, buffer));
+                case PROPERTY_DOUBLE:
+                    return PropertyText(buffer, clampLength(snprintf(buffer, size, "%g", doubleValue), size));
+                case PROPERTY_BOOL:
+                    return PropertyText(boolValue ? "True" : "False");
+                case PROPERTY_STRING:
+                    return PropertyText(data, length);
+                case PROPERTY_BLOB: {
+                    if (size < 3) return PropertyText();
+                    size_t count = (length < (size-3)/2) ? length : (size-3)/2;
+                    buffer[0] = '0';
+                    buffer[1] = 'x';
+                    return PropertyText(buffer, 2 + formatHex((const unsigned char *)data, count, buffer+2, true));
+                }
+                default:
+                    return PropertyText();
+            }
+        }
+        string toString() const {
+            //Blobs need two characters a byte plus the prefix
+            string buffer(length*2 + 64, '\0');
+            PropertyText text = format(&buffer[0], buffer.size());
+            return string(text.data, text.length);
+        }
+
+    protected:
+        void setInt(long long value){ type = PROPERTY_INT; intValue = value; data = ""; length = 0; }
+        void setDouble(double value){ type = PROPERTY_DOUBLE; doubleValue = value; data = ""; length = 0; }
+        void setBytes(PropertyType type, const char *data, size_t length){
+            this->type = type;
+            intValue = 0;
+            this->data = data;
+            this->length = length;
+        }
+        static size_t clampLength(int length, size_t size){
+            if (length < 0) return 0;
+            return ((size_t)length < size) ? (size_t)length : size-1;
+        }
+    };
+
+    //Owning version of PropertyValue used for properties stored on traces and
+    //event types, which live longer than the caller's strings.
+    class StoredProperty{
+    public:
+        StoredProperty(){ type = PROPERTY_NONE; intValue = 0; }
+        StoredProperty(const PropertyValue &value){
+            type = value.type;
+            intValue = value.intValue;  //Copies whichever union member is set
+            if (type == PROPERTY_DOUBLE) doubleValue = value.doubleValue;
+            if (type == PROPERTY_BOOL) boolValue = value.boolValue;
+            bytes.assign(value.data, value.length);
+        }
+        PropertyValue getValue() const {
+            PropertyValue value;
+            switch (type){
+                case PROPERTY_INT: value = PropertyValue(intValue); break;
+                case PROPERTY_DOUBLE: value = PropertyValue(doubleValue); break;
+                case PROPERTY_BOOL: value = PropertyValue(boolValue); break;
+                case PROPERTY_STRING: value = PropertyValue(bytes); break;
+                case PROPERTY_BLOB: value = PropertyValue::blob((const unsigned char *)bytes.data(), bytes.size()); break;
+                default: break;
+            }
+            return value;
+        }
+        PropertyType type;
+        union {
+            long long intValue;
+            double doubleValue;
+            bool boolValue;
+        };
+        string bytes;
+    };
+
+} //namespace lpt
+
+#endif
@@ -0,0 +1,329 @@
+/*
+ *  SignalTable.h
+ *  LPTracer
+ *
+ *  http://www.logicpoet.com
+ *
+ *  Copyright 2008 Logic Poet. All rights reserved.
+ *
+ *  The MIT License
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without
+ *  restriction, including without limitation the rights to use,
+ *  copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following
+ *  conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *  OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _LPT_SIGNAL_TABLE_H_
+#define _LPT_SIGNAL_TABLE_H_
+
+#include "systemc.h"
+#include <vector>
+#include "TraceWriter.h"
+
+using std::vector;
+
+namespace lpt{
+
+#pragma mark -
+#pragma mark Reading Traced Values
+    //Converts a traced object to the value kept in the shadow copy.  Built in
+    //types are kept as they are; SystemC types as the cheapest native value
+    //that still compares exactly.
+    template <class T> inline T readSignal(const T &value){ return value; }
+    inline bool readSignal(const sc_dt::sc_bit &value){ return value.to_bool(); }
+    inline sc_dt::sc_logic_value_t readSignal(const sc_dt::sc_logic &value){ return value.value(); }
+    inline sc_dt::int64 readSignal(const sc_dt::sc_int_base &value){ return value.to_int64(); }
+    inline sc_dt::uint64 readSignal(const sc_dt::sc_uint_base &value){ return value.to_uint64(); }
+    inline sc_dt::int64 readSignal(const sc_dt::sc_signed &value){ return value.to_int64(); }
+    inline sc_dt::uint64 readSignal(const sc_dt::sc_unsigned &value){ return value.to_uint64(); }
+    inline double readSignal(const sc_dt::sc_fxval &value){ return value.to_double(); }
+    inline double readSignal(const sc_dt::sc_fxval_fast &value){ return value.to_double(); }
+    inline double readSignal(const sc_dt::sc_fxnum &value){ return value.to_double(); }
+    inline double readSignal(const sc_dt::sc_fxnum_fast &value){ return value.to_double(); }
+
+    //The value written for a shadow entry.  Strings point into the entry or at
+    //a literal so nothing is copied.
+    template <class T> inline PropertyValue signalValue(const T &value){ return PropertyValue(value); }
+    inline PropertyValue signalValue(const sc_dt::sc_logic_value_t &value){ return PropertyValue(PropertyText("01ZX" + value, 1)); }
+    inline PropertyValue signalValue(const char &value){ return PropertyValue((int)value); }
+
+    //Vectors of any length are read as 32 bit words, bit 0 first.  Four state
+    //vectors give their value words and then their control words.
+    inline int signalWords(const sc_dt::sc_bv_base &value){ return (value.length() + 31) / 32; }
+    inline int signalWords(const sc_dt::sc_lv_base &value){ return 2 * ((value.length() + 31) / 32); }
+    inline int signalWords(const sc_dt::sc_signed &value){ return (value.length() + 31) / 32; }
+    inline int signalWords(const sc_dt::sc_unsigned &value){ return (value.length() + 31) / 32; }
+    inline void readSignalWords(const sc_dt::sc_bv_base &value, unsigned int *words){
+        int count = signalWords(value);
+        for (int i = 0; i < count; i++) words[i] = value.get_word(i);
+    }
+    inline void readSignalWords(const sc_dt::sc_lv_base &value, unsigned int *words){
+        int count = signalWords(value) / 2;
+        for (int i = 0; i < count; i++){
+            words[i] = value.get_word(i);
+            words[count+i] = value.get_cword(i);
+        }
+    }
+    //sc_signed and sc_unsigned don't expose their digits, so wide ones go bit by bit
+    template <class T> inline void readSignalBits(const T &value, unsigned int *words){
+        int count = signalWords(value);
+        for (int i = 0; i < count; i++) words[i] = 0;
+        for (int bit = 0; bit < value.length(); bit++){
+            if (value.test(bit)) words[bit/32] |= 1u << (bit%32);
+        }
+    }
+    inline void readSignalWords(const sc_dt::sc_signed &value, unsigned int *words){ readSignalBits(value, words); }
+    inline void readSignalWords(const sc_dt::sc_unsigned &value, unsigned int *words){ readSignalBits(value, words); }
+
+#pragma mark -
+#pragma mark ScalarSignalTable
+    //Values of one type that fit in a machine word.  The pointers to the traced
+    //objects and the shadow copy of their last written values are parallel
+    //arrays, so finding the changes is one load and compare per value with no
+    //virtual calls.
+    template <class Source, class Stored>
+    class ScalarSignalTable{
+    public:
+        ScalarSignalTable(){ written = 0; }
+        void add(const Source &value, int id){
+            values.push_back(&value);
+            ids.push_back(id);
+            shadow.push_back(Stored());
+        }
+        //Writes the values that changed since the last call.  Values added
+        //since then are always written.
+        void writeChanges(TraceWriter *writer, unsigned long long time){
+            size_t count = values.size();
+            for (size_t i = 0; i < count; i++){
+                Stored value = readSignal(*values[i]);
+                if (value == shadow[i] && i < written) continue;
+                shadow[i] = value;
+                writer->writeChange(ids[i], time, signalValue(shadow[i]));
+            }
+            written = count;
+        }
+    protected:
+        vector<const Source *> values;
+        vector<int> ids;
+        vector<Stored> shadow;
+        size_t written;
+    };
+
+#pragma mark -
+#pragma mark VectorSignalTable
+    //Bit and logic vectors of any length, written as strings of 0, 1, Z and X
+    //with the most significant bit first.  Each cycle every vector is read
+    //into one contiguous word buffer, which is then compared word by word with
+    //the shadow buffer of the same layout.
+    template <class Source>
+    class VectorSignalTable{
+    public:
+        VectorSignalTable(bool fourState = false){
+            this->fourState = fourState;
+            written = 0;
+        }
+        void add(const Source &value, int id){
+            Entry entry = {&value, id, current.size(), signalWords(value), value.length()};
+            entries.push_back(entry);
+            current.resize(current.size() + entry.words, 0);
+            shadow.resize(current.size(), 0);
+        }
+        void writeChanges(TraceWriter *writer, unsigned long long time){
+            for (size_t i = 0; i < entries.size(); i++){
+                readSignalWords(*entries[i].value, &current[entries[i].offset]);
+            }
+            for (size_t i = 0; i < entries.size(); i++){
+                const Entry &entry = entries[i];
+                const unsigned int *now = &current[entry.offset];
+                unsigned int *last = &shadow[entry.offset];
+                int word = 0;
+                while (word < entry.words && now[word] == last[word]) word++;
+                if (word == entry.words && i < written) continue;
+                for (word = 0; word < entry.words; word++) last[word] = now[word];
+                writer->writeChange(entry.id, time, PropertyValue(format(entry, last)));
+            }
+            written = entries.size();
+        }
+    protected:
+        struct Entry{
+            const Source *value;
+            int id;
+            size_t offset;      //Into current and shadow
+            int words;
+            int length;         //Bits
+        };
+        vector<Entry> entries;
+        vector<unsigned int> current;
+        vector<unsigned int> shadow;
+        size_t written;
+        bool fourState;
+        string text;
+        PropertyText format(const Entry &entry, const unsigned int *words){
+            //Value and control bit of a four state vector pick the character
+            static const char digits[] = "01ZX";
+            int controlOffset = entry.words / 2;
+            text.resize(entry.length);
+            for (int bit = 0; bit < entry.length; bit++){
+                int digit = (words[bit/32] >> (bit%32)) & 1;
+                if (fourState) digit |= ((words[controlOffset + bit/32] >> (bit%32)) & 1) << 1;
+                text[entry.length - 1 - bit] = digits[digit];
+            }
+            return PropertyText(text);
+        }
+    };
+
+#pragma mark -
+#pragma mark EnumSignalTable
+    //Unsigned values traced with a table of names, written as the name
+    class EnumSignalTable{
+    public:
+        EnumSignalTable(){ written = 0; }
+        void add(const unsigned int &value, int id, const char **names){
+            Entry entry = {&value, id, names, 0};
+            //Count the names so out of range values can be caught
+            while (names && names[entry.nameCount]) entry.nameCount++;
+            entries.push_back(entry);
+            shadow.push_back(0);
+        }
+        void writeChanges(TraceWriter *writer, unsigned long long time){
+            for (size_t i = 0; i < entries.size(); i++){
+                unsigned int value = *entries[i].value;
+                if (value == shadow[i] && i < written) continue;
+                shadow[i] = value;
+                if (value < entries[i].nameCount) writer->writeChange(entries[i].id, time, PropertyValue(entries[i].names[value]));
+                else writer->writeChange(entries[i].id, time, PropertyValue(value));
+            }
+            written = entries.size();
+        }
+    protected:
+        struct Entry{
+            const unsigned int *value;
+            int id;
+            const char **names;
+            unsigned int nameCount;
+        };
+        vector<Entry> entries;
+        vector<unsigned int> shadow;
+        size_t written;
+    };
+
+#pragma mark -
+#pragma mark SignalTables
+    //All of the values traced into one Tracer, one table per type
+    class SignalTables{
+    public:
+        SignalTables() : logicVectors(true) {}
+        void add(const bool &value, int id){ bools.add(value, id); }
+        void add(const sc_dt::sc_bit &value, int id){ bits.add(value, id); }
+        void add(const sc_dt::sc_logic &value, int id){ logics.add(value, id); }
+        void add(const unsigned char &value, int id){ unsignedChars.add(value, id); }
+        void add(const unsigned short &value, int id){ unsignedShorts.add(value, id); }
+        void add(const unsigned int &value, int id){ unsignedInts.add(value, id); }
+        void add(const unsigned long &value, int id){ unsignedLongs.add(value, id); }
+        void add(const char &value, int id){ chars.add(value, id); }
+        void add(const short &value, int id){ shorts.add(value, id); }
+        void add(const int &value, int id){ ints.add(value, id); }
+        void add(const long &value, int id){ longs.add(value, id); }
+        void add(const sc_dt::int64 &value, int id){ int64s.add(value, id); }
+        void add(const sc_dt::uint64 &value, int id){ uint64s.add(value, id); }
+        void add(const float &value, int id){ floats.add(value, id); }
+        void add(const double &value, int id){ doubles.add(value, id); }
+        void add(const sc_dt::sc_int_base &value, int id){ scInts.add(value, id); }
+        void add(const sc_dt::sc_uint_base &value, int id){ scUints.add(value, id); }
+        //sc_signed and sc_unsigned that fit in 64 bits are read as integers
+        void add(const sc_dt::sc_signed &value, int id){
+            if (value.length() <= 64) scSigneds.add(value, id);
+            else wideSigneds.add(value, id);
+        }
+        void add(const sc_dt::sc_unsigned &value, int id){
+            if (value.length() <= 64) scUnsigneds.add(value, id);
+            else wideUnsigneds.add(value, id);
+        }
+        void add(const sc_dt::sc_fxval &value, int id){ fxvals.add(value, id); }
+        void add(const sc_dt::sc_fxval_fast &value, int id){ fastFxvals.add(value, id); }
+        void add(const sc_dt::sc_fxnum &value, int id){ fxnums.add(value, id); }
+        void add(const sc_dt::sc_fxnum_fast &value, int id){ fastFxnums.add(value, id); }
+        void add(const sc_dt::sc_bv_base &value, int id){ bitVectors.add(value, id); }
+        void add(const sc_dt::sc_lv_base &value, int id){ logicVectors.add(value, id); }
+        void add(const unsigned int &value, int id, const char **names){ enums.add(value, id, names); }
+        void writeChanges(TraceWriter *writer, unsigned long long time){
+            bools.writeChanges(writer, time);
+            bits.writeChanges(writer, time);
+            logics.writeChanges(writer, time);
+            unsignedChars.writeChanges(writer, time);
+            unsignedShorts.writeChanges(writer, time);
+            unsignedInts.writeChanges(writer, time);
+            unsignedLongs.writeChanges(writer, time);
+            chars.writeChanges(writer, time);
+            shorts.writeChanges(writer, time);
+            ints.writeChanges(writer, time);
+            longs.writeChanges(writer, time);
+            int64s.writeChanges(writer, time);
+            uint64s.writeChanges(writer, time);
+            floats.writeChanges(writer, time);
+            doubles.writeChanges(writer, time);
+            scInts.writeChanges(writer, time);
+            scUints.writeChanges(writer, time);
+            scSigneds.writeChanges(writer, time);
+            scUnsigneds.writeChanges(writer, time);
+            fxvals.writeChanges(writer, time);
+            fastFxvals.writeChanges(writer, time);
+            fxnums.writeChanges(writer, time);
+            fastFxnums.writeChanges(writer, time);
+            bitVectors.writeChanges(writer, time);
+            logicVectors.writeChanges(writer, time);
+            wideSigneds.writeChanges(writer, time);
+            wideUnsigneds.writeChanges(writer, time);
+            enums.writeChanges(writer, time);
+        }
+    protected:
+        ScalarSignalTable<bool, bool> bools;
+        ScalarSignalTable<sc_dt::sc_bit, bool> bits;
+        ScalarSignalTable<sc_dt::sc_logic, sc_dt::sc_logic_value_t> logics;
+        ScalarSignalTable<unsigned char, unsigned char> unsignedChars;
+        ScalarSignalTable<unsigned short, unsigned short> unsignedShorts;
+        ScalarSignalTable<unsigned int, unsigned int> unsignedInts;
+        ScalarSignalTable<unsigned long, unsigned long> unsignedLongs;
+        ScalarSignalTable<char, char> chars;
+        ScalarSignalTable<short, short> shorts;
+        ScalarSignalTable<int, int> ints;
+        ScalarSignalTable<long, long> longs;
+        ScalarSignalTable<sc_dt::int64, sc_dt::int64> int64s;
+        ScalarSignalTable<sc_dt::uint64, sc_dt::uint64> uint64s;
+        ScalarSignalTable<float, float> floats;
+        ScalarSignalTable<double, double> doubles;
+        ScalarSignalTable<sc_dt::sc_int_base, sc_dt::int64> scInts;
+        ScalarSignalTable<sc_dt::sc_uint_base, sc_dt::uint64> scUints;
+        ScalarSignalTable<sc_dt::sc_signed, sc_dt::int64> scSigneds;
+        ScalarSignalTable<sc_dt::sc_unsigned, sc_dt::uint64> scUnsigneds;
+        ScalarSignalTable<sc_dt::sc_fxval, double> fxvals;
+        ScalarSignalTable<sc_dt::sc_fxval_fast, double> fastFxvals;
+        ScalarSignalTable<sc_dt::sc_fxnum, double> fxnums;
+        ScalarSignalTable<sc_dt::sc_fxnum_fast, double> fastFxnums;
+        VectorSignalTable<sc_dt::sc_bv_base> bitVectors;
+        VectorSignalTable<sc_dt::sc_lv_base> logicVectors;
+        VectorSignalTable<sc_dt::sc_signed> wideSigneds;
+        VectorSignalTable<sc_dt::sc_unsigned> wideUnsigneds;
+        EnumSignalTable enums;
+    };
+
+} //namespace lpt
+
+#endif
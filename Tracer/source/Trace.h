@@ -39,13 +39,18 @@
 
 namespace lpt{
     
+    class Tracer;
+
     class Trace : public ModelBase{
     protected:
         string name;
     public:
-        Trace(){ this->name = ""; }
-        Trace(string name){ this->name = name; }
+        Trace(){ this->name = ""; sampledOutBy = 0; }
+        Trace(string name){ this->name = name; sampledOutBy = 0; }
         string getName() { return name; }
+        //Set by a Tracer that sampled this trace out, so its later events are
+        //dropped with one pointer compare instead of a map lookup
+        const Tracer *sampledOutBy;
     };
 
 }
@@ -0,0 +1,186 @@
+/*
+ *  TraceFile.cpp
+ *  LPTracer
+ *
+ *  http://www.logicpoet.com
+ *
+ *  Copyright 2008 Logic Poet. All rights reserved.
+ * 
+ *  The MIT License
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without
+ *  restriction, including without limitation the rights to use,
+ *  copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following
+ *  conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *  OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "TraceFile.h"
+#ifdef LPTRACE_ZLIB
+#include <zlib.h>
+#endif
+
+using namespace lpt;
+
+#pragma mark -
+#pragma mark BlockBuf
+
+BlockBuf::BlockBuf(std::streambuf *sink, unsigned long long sinkOffset, unsigned int blockSize){
+    this->sink = sink;
+    blockFileOffset = sinkOffset;
+    block.resize(blockSize);
+    setp(&block[0], &block[0] + block.size());
+}
+
+bool BlockBuf::flushBlock(){
+    unsigned int length = (unsigned int)(pptr() - pbase());
+    if (length == 0) return true;
+    long written = writeBlock(pbase(), length);
+    if (written < 0) return false;
+    blockFileOffset += written;
+    setp(&block[0], &block[0] + block.size());
+    return true;
+}
+
+bool BlockBuf::finish(){
+    return flushBlock();
+}
+
+TracePosition BlockBuf::getPosition(){
+    TracePosition pos;
+    pos.fileOffset = blockFileOffset + (pptr() - pbase());
+    pos.blockOffset = 0;
+    return pos;
+}
+
+long BlockBuf::writeBlock(const char *data, unsigned int length){
+    if (sink->sputn(data, length) != (std::streamsize)length) return -1;
+    return length;
+}
+
+BlockBuf::int_type BlockBuf::overflow(int_type c){
+    if (!flushBlock()) return traits_type::eof();
+    if (!traits_type::eq_int_type(c, traits_type::eof())){
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+//Flushing the stream only pushes out full blocks so flushes don't produce
+//lots of small blocks.  finish() writes the last partial one.
+int BlockBuf::sync(){
+    return sink->pubsync();
+}
+
+#ifdef LPTRACE_ZLIB
+#pragma mark -
+#pragma mark BlockCompressBuf
+
+static void putLittleEndian32(unsigned char *buffer, unsigned long value){
+    for (int i = 0; i < 4; i++){
+        buffer[i] = (unsigned char)(value >> (8*i));
+    }
+}
+
+BlockCompressBuf::BlockCompressBuf(std::streambuf *sink, unsigned long long sinkOffset, unsigned int blockSize, int level)
+    : BlockBuf(sink, sinkOffset, blockSize){
+    this->level = level;
+    compressed.resize(COMPRESSED_FRAME_SIZE + compressBound(blockSize));
+}
+
+long BlockCompressBuf::writeBlock(const char *data, unsigned int length){
+    uLongf compressedLength = compressed.size() - COMPRESSED_FRAME_SIZE;
+    if (compress2(&compressed[COMPRESSED_FRAME_SIZE], &compressedLength, (const Bytef *)data, length, level) != Z_OK){
+        return -1;
+    }
+    putLittleEndian32(&compressed[0], compressedLength);
+    putLittleEndian32(&compressed[4], length);
+    std::streamsize total = COMPRESSED_FRAME_SIZE + compressedLength;
+    if (sink->sputn((const char *)&compressed[0], total) != total) return -1;
+    return (long)total;
+}
+
+bool BlockCompressBuf::finish(){
+    if (!flushBlock()) return false;
+    unsigned char end[COMPRESSED_FRAME_SIZE] = {0, 0, 0, 0, 0, 0, 0, 0};
+    return sink->sputn((const char *)end, COMPRESSED_FRAME_SIZE) == (std::streamsize)COMPRESSED_FRAME_SIZE;
+}
+
+TracePosition BlockCompressBuf::getPosition(){
+    TracePosition pos;
+    pos.fileOffset = blockFileOffset;
+    pos.blockOffset = (unsigned int)(pptr() - pbase());
+    return pos;
+}
+#endif
+
+#pragma mark -
+#pragma mark TraceFile
+
+TraceFile::TraceFile() : std::ostream(0){
+    buffer = 0;
+}
+
+TraceFile::~TraceFile(){
+    close();
+}
+
+bool TraceFile::open(const string &filename, bool compressed){
+    if (!file.open(filename.c_str(), std::ios::out | std::ios::trunc | std::ios::binary)){
+        setstate(std::ios::failbit);
+        return false;
+    }
+#ifdef LPTRACE_ZLIB
+    if (compressed){
+        file.sputn(COMPRESSED_MAGIC, 4);
+        file.sputc((char)COMPRESSED_VERSION);
+        buffer = new BlockCompressBuf(&file, COMPRESSED_HEADER_SIZE);
+    }
+#else
+    (void)compressed;
+#endif
+    if (!buffer) buffer = new BlockBuf(&file, 0);
+    rdbuf(buffer);
+    return true;
+}
+
+void TraceFile::close(){
+    if (!file.is_open()) return;
+    if (!buffer->finish()) setstate(std::ios::badbit);
+    rdbuf(0);
+    delete buffer;
+    buffer = 0;
+    file.close();
+}
+
+bool TraceFile::is_open(){
+    return file.is_open();
+}
+
+TracePosition TraceFile::getPosition(){
+    return buffer->getPosition();
+}
+
+bool TraceFile::compressionAvailable(){
+#ifdef LPTRACE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
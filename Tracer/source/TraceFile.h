@@ -0,0 +1,129 @@
+/*
+ *  TraceFile.h
+ *  LPTracer
+ *
+ *  http://www.logicpoet.com
+ *
+ *  Copyright 2008 Logic Poet. All rights reserved.
+ *
+ *  The MIT License
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without
+ *  restriction, including without limitation the rights to use,
+ *  copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following
+ *  conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *  OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _LPT_TRACE_FILE_H_
+#define _LPT_TRACE_FILE_H_
+
+#include <fstream>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+namespace lpt{
+
+    //Compressed files start with these magic bytes and version, followed by a
+    //sequence of blocks.  Each block is framed as
+    //    compressed length (4 bytes), uncompressed length (4 bytes), zlib data
+    //with both lengths little endian.  A block with compressed length 0 ends
+    //the file.  Every block is compressed on its own so a reader can skip
+    //through the frame headers to any block and start decompressing there.
+    static const char COMPRESSED_MAGIC[4] = {'L', 'P', 'T', 'Z'};
+    static const unsigned char COMPRESSED_VERSION = 1;
+    static const unsigned int COMPRESSED_HEADER_SIZE = 5;
+    static const unsigned int COMPRESSED_FRAME_SIZE = 8;
+
+    //Position in a trace file.  For an uncompressed file fileOffset is the byte
+    //offset and blockOffset is 0.  For a compressed file fileOffset is the offset
+    //of the block's frame and blockOffset the offset in the decompressed block.
+    struct TracePosition{
+        unsigned long long fileOffset;
+        unsigned int blockOffset;
+    };
+
+#pragma mark -
+#pragma mark BlockBuf
+    //streambuf that gathers output into blocks and hands each full block to
+    //writeBlock().  The plain version writes blocks straight to the sink; its
+    //main job is knowing the current position without asking the file.
+    class BlockBuf : public std::streambuf{
+    public:
+        BlockBuf(std::streambuf *sink, unsigned long long sinkOffset, unsigned int blockSize = 256*1024);
+        virtual ~BlockBuf(){}
+        //Writes whatever is buffered as a block
+        bool flushBlock();
+        //Writes the last block and any end marker.  Nothing may be written afterwards.
+        virtual bool finish();
+        virtual TracePosition getPosition();
+    protected:
+        //Returns the number of bytes the block took in the sink, or -1 on error
+        virtual long writeBlock(const char *data, unsigned int length);
+        int_type overflow(int_type c);
+        int sync();
+        std::streambuf *sink;
+        unsigned long long blockFileOffset;     //Where the current block will go
+        vector<char> block;
+    };
+
+#ifdef LPTRACE_ZLIB
+#pragma mark -
+#pragma mark BlockCompressBuf
+    //Writes each block zlib compressed and framed as described above
+    class BlockCompressBuf : public BlockBuf{
+    public:
+        BlockCompressBuf(std::streambuf *sink, unsigned long long sinkOffset, unsigned int blockSize = 256*1024, int level = 6);
+        bool finish();
+        TracePosition getPosition();
+    protected:
+        long writeBlock(const char *data, unsigned int length);
+        int level;
+        vector<unsigned char> compressed;
+    };
+#endif
+
+#pragma mark -
+#pragma mark TraceFile
+    //Output file for the trace writers.  Writes go through a BlockBuf, or when
+    //opened compressed a BlockCompressBuf so the bytes that reach the disk are
+    //already compressed.
+    class TraceFile : public std::ostream{
+    public:
+        TraceFile();
+        ~TraceFile();
+        bool open(const string &filename, bool compressed);
+        void close();
+        bool is_open();
+        //Position the next byte written will have
+        TracePosition getPosition();
+        //False when the library was built without LPTRACE_ZLIB
+        static bool compressionAvailable();
+    protected:
+        std::filebuf file;
+        BlockBuf *buffer;
+    };
+
+} //namespace lpt
+
+#endif
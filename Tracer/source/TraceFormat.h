@@ -0,0 +1,91 @@
+/*
+ *  TraceFormat.h
+ *  LPTracer
+ *
+ *  http://www.logicpoet.com
+ *
+ *  Copyright 2008 Logic Poet. All rights reserved.
+ *
+ *  The MIT License
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without
+ *  restriction, including without limitation the rights to use,
+ *  copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following
+ *  conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *  OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _LPT_TRACE_FORMAT_H_
+#define _LPT_TRACE_FORMAT_H_
+
+//Constants of the trace file formats, shared by the writer and the reader.
+//This header must not depend on SystemC.
+
+namespace lpt{
+
+    //Output formats the Tracer knows how to write
+    enum OutputFormat {
+        XML_FORMAT,         //Scansion XML (.scnx)
+        BINARY_FORMAT,      //Compact binary records (.scnb)
+        CHROME_FORMAT       //Chrome Trace Event JSON (.json), write only
+    };
+
+    //Binary record tags.  Every record starts with one of these bytes.  See the
+    //README for the layout of each record.
+    enum BinaryRecordTag {
+        BIN_MODULE_BEGIN    = 0x01,
+        BIN_MODULE_END      = 0x02,
+        BIN_EVENTTYPE       = 0x03,
+        BIN_TRACE           = 0x04,
+        BIN_EVENT           = 0x05,     //Event followed by properties and BIN_END
+        BIN_EVENT_SHORT     = 0x06,     //Event with no properties, no BIN_END
+        BIN_KEY             = 0x07,     //Interns a property name
+        BIN_PROPERTY        = 0x08,
+        BIN_END             = 0x09,
+        BIN_EOF             = 0x0A,
+        BIN_PROPERTY_TYPED  = 0x0B,     //Non-string property, see BinaryValueType
+        BIN_SIGNAL          = 0x0C,     //Declares a traced signal
+        BIN_CHANGE          = 0x0D,     //New value of a signal
+        BIN_SPAN            = 0x0E,     //Event with a duration, properties and BIN_END
+        BIN_SPAN_SHORT      = 0x0F,     //Span with no properties, no BIN_END
+        BIN_LINK            = 0x10      //Causal link between two traces
+    };
+
+    //What a link between two traces means.  Links point the way causality
+    //goes, from the parent or the merged source to the child or merge target.
+    enum TraceLinkKind {
+        LINK_CHILD          = 0,        //The second trace was split off the first
+        LINK_MERGE          = 1         //The first trace was merged into the second
+    };
+
+    //Value type byte of a BIN_PROPERTY_TYPED record
+    enum BinaryValueType {
+        BIN_VALUE_INT       = 0x00,     //Zigzag encoded varint
+        BIN_VALUE_DOUBLE    = 0x01,     //8 bytes, IEEE 754 little endian
+        BIN_VALUE_BOOL      = 0x02,     //1 byte
+        BIN_VALUE_BLOB      = 0x03,     //Varint length then the bytes
+        BIN_VALUE_STRING    = 0x04      //As a blob, only used by BIN_CHANGE
+    };
+
+    //Magic bytes and version at the start of every binary trace file
+    static const char BINARY_MAGIC[4] = {'L', 'P', 'T', 'B'};
+    static const unsigned char BINARY_VERSION = 1;
+
+} //namespace lpt
+
+#endif
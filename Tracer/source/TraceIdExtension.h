@@ -0,0 +1,67 @@
+/*
+ *  TraceIdExtension.h
+ *  LPTracer
+ *
+ *  http://www.logicpoet.com
+ *
+ *  Copyright 2008 Logic Poet. All rights reserved.
+ *
+ *  The MIT License
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without
+ *  restriction, including without limitation the rights to use,
+ *  copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following
+ *  conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *  OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _LPT_TRACE_ID_EXTENSION_H_
+#define _LPT_TRACE_ID_EXTENSION_H_
+
+#include "tlm.h"
+
+namespace lpt{
+
+    class Tracer;
+
+    //Caches the Tracer's trace id directly on a tlm_generic_payload so looking
+    //up the trace of a payload is a pointer dereference rather than a map lookup.
+    //On payloads with a memory manager it is added as an auto extension, so it is
+    //freed (and the trace forgotten) when the payload is reset or released back
+    //to its memory manager.
+    class TraceIdExtension : public tlm::tlm_extension<TraceIdExtension>{
+    public:
+        TraceIdExtension(){
+            owner = 0;
+            id = 0;
+        }
+        //A copied payload is a new transaction so it does not inherit the trace
+        tlm::tlm_extension_base* clone() const {
+            return new TraceIdExtension();
+        }
+        void copy_from(tlm::tlm_extension_base const & /*ext*/){
+            owner = 0;
+            id = 0;
+        }
+        const Tracer *owner;    //Tracer that assigned the id, 0 if unassigned
+        int id;
+    };
+
+} //namespace lpt
+
+#endif
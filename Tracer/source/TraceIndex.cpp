@@ -0,0 +1,123 @@
+/*
+ *  TraceIndex.cpp
+ *  LPTracer
+ *
+ *  http://www.logicpoet.com
+ *
+ *  Copyright 2008 Logic Poet. All rights reserved.
+ * 
+ *  The MIT License
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without
+ *  restriction, including without limitation the rights to use,
+ *  copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following
+ *  conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *  OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "TraceIndex.h"
+#include <fstream>
+
+using namespace lpt;
+
+TraceIndex::TraceIndex(){
+    enabled = false;
+    eventInterval = 1024;
+    byteInterval = 1 << 20;
+    eventCount = 0;
+    lastEntryEvent = 0;
+    maxTime = 0;
+    traceSeenCount = 0;
+}
+
+void TraceIndex::enable(unsigned int eventInterval, unsigned int byteInterval){
+    enabled = true;
+    this->eventInterval = (eventInterval > 0) ? eventInterval : 1;
+    this->byteInterval = (byteInterval > 0) ? byteInterval : 1;
+}
+
+void TraceIndex::addTrace(int traceId, const TracePosition &pos){
+    if (traceId < 0) return;
+    if ((size_t)traceId >= traceStarts.size()){
+        //Trace ids are handed out in order so this grows by doubling
+        size_t size = traceStarts.size() ? traceStarts.size() : 1024;
+        while (size <= (size_t)traceId) size *= 2;
+        traceStarts.resize(size);
+        traceSeen.resize(size, false);
+    }
+    traceStarts[traceId] = pos;
+    if (!traceSeen[traceId]) traceSeenCount++;
+    traceSeen[traceId] = true;
+}
+
+void TraceIndex::addEntry(unsigned long long time, const TracePosition &pos){
+    Entry entry;
+    entry.time = time;
+    entry.eventNumber = eventCount;
+    entry.pos = pos;
+    entries.push_back(entry);
+    lastEntryEvent = eventCount;
+}
+
+static void writeVarint(std::ofstream &out, unsigned long long value){
+    char buffer[10];
+    int len = 0;
+    while (value >= 0x80){
+        buffer[len++] = (char)((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    buffer[len++] = (char)value;
+    out.write(buffer, len);
+}
+
+bool TraceIndex::write(const string &filename, bool compressed){
+    std::ofstream out(filename.c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!out) return false;
+    out.write(INDEX_MAGIC, 4);
+    out.put((char)INDEX_VERSION);
+    out.put((char)(compressed ? INDEX_FLAG_COMPRESSED : 0));
+    writeVarint(out, eventCount);
+    writeVarint(out, entries.size());
+    for (size_t i = 0; i < entries.size(); i++){
+        writeVarint(out, entries[i].time);
+        writeVarint(out, entries[i].eventNumber);
+        writeVarint(out, entries[i].pos.fileOffset);
+        writeVarint(out, entries[i].pos.blockOffset);
+    }
+    writeVarint(out, traceSeenCount);
+    for (size_t id = 0; id < traceStarts.size(); id++){
+        if (!traceSeen[id]) continue;
+        writeVarint(out, id);
+        writeVarint(out, traceStarts[id].fileOffset);
+        writeVarint(out, traceStarts[id].blockOffset);
+    }
+    writeVarint(out, keys.empty() ? 0 : keys.size() - 1);
+    for (size_t id = 1; id < keys.size(); id++){
+        writeVarint(out, id);
+        writeVarint(out, keys[id].size());
+        out.write(keys[id].data(), keys[id].size());
+    }
+    writeVarint(out, eventTypeStarts.empty() ? 0 : eventTypeStarts.size() - 1);
+    for (size_t id = 1; id < eventTypeStarts.size(); id++){
+        writeVarint(out, id);
+        writeVarint(out, eventTypeStarts[id].fileOffset);
+        writeVarint(out, eventTypeStarts[id].blockOffset);
+    }
+    out.close();
+    return !out.fail();
+}
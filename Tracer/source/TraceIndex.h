@@ -0,0 +1,115 @@
+/*
+ *  TraceIndex.h
+ *  LPTracer
+ *
+ *  http://www.logicpoet.com
+ *
+ *  Copyright 2008 Logic Poet. All rights reserved.
+ *
+ *  The MIT License
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without
+ *  restriction, including without limitation the rights to use,
+ *  copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following
+ *  conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *  OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _LPT_TRACE_INDEX_H_
+#define _LPT_TRACE_INDEX_H_
+
+#include <string>
+#include <vector>
+#include "TraceFile.h"
+
+using std::string;
+using std::vector;
+
+namespace lpt{
+
+    //Sidecar index files start with these magic bytes and version.  See the
+    //README for the layout.
+    static const char INDEX_MAGIC[4] = {'L', 'P', 'T', 'I'};
+    static const unsigned char INDEX_VERSION = 4;
+    static const unsigned char INDEX_FLAG_COMPRESSED = 0x01;
+
+    //Builds the sidecar index for a trace file while it is written.  The writer
+    //reports the position of every event; every eventInterval events, or once
+    //the file has moved on byteInterval bytes, the event's position is kept
+    //with the latest time of any event so far.  Those times never go
+    //backwards, even when events are marked with earlier times, so a reader
+    //can binary search for a time and seek straight to it.  The position of every trace record is kept as well, so a reader can
+    //seek to a trace and find its properties followed by its events, and of
+    //every event type record, since event types are declared as they are
+    //first used and a reader starting mid-file may not have seen them.
+    class TraceIndex{
+    public:
+        TraceIndex();
+        void enable(unsigned int eventInterval, unsigned int byteInterval);
+        bool isEnabled() { return enabled; }
+        void addEvent(unsigned long long time, const TracePosition &pos){
+            if (time > maxTime) maxTime = time;
+            if (eventCount - lastEntryEvent >= eventInterval || entries.empty() || 
+                isFar(entries.back().pos, pos)){
+                addEntry(maxTime, pos);
+            }
+            eventCount++;
+        }
+        void addTrace(int traceId, const TracePosition &pos);
+        void addEventType(int eventTypeId, const TracePosition &pos){
+            if (eventTypeId <= 0) return;
+            if (eventTypeStarts.size() <= (size_t)eventTypeId) eventTypeStarts.resize(eventTypeId + 1);
+            eventTypeStarts[eventTypeId] = pos;
+        }
+        //Binary traces intern property names, so the index repeats the key table
+        //for readers that start in the middle of the file
+        void addKey(int keyId, const string &name){
+            if (!enabled) return;
+            if (keys.size() <= (size_t)keyId) keys.resize(keyId + 1);
+            keys[keyId] = name;
+        }
+        bool write(const string &filename, bool compressed);
+    protected:
+        struct Entry{
+            unsigned long long time;            //Latest event time up to and including this event
+            unsigned long long eventNumber;     //Number of events before this one
+            TracePosition pos;
+        };
+        bool enabled;
+        unsigned int eventInterval;
+        unsigned int byteInterval;
+        unsigned long long eventCount;
+        unsigned long long lastEntryEvent;
+        unsigned long long maxTime;
+        vector<Entry> entries;
+        //Indexed by trace id
+        vector<TracePosition> traceStarts;
+        vector<bool> traceSeen;
+        unsigned int traceSeenCount;
+        vector<string> keys;        //Indexed by key id, 0 unused
+        vector<TracePosition> eventTypeStarts;      //Indexed by event type id, 0 unused
+        bool isFar(const TracePosition &from, const TracePosition &to){
+            if (to.fileOffset != from.fileOffset) return to.fileOffset - from.fileOffset >= byteInterval;
+            return to.blockOffset - from.blockOffset >= byteInterval;
+        }
+        void addEntry(unsigned long long time, const TracePosition &pos);
+    };
+
+} //namespace lpt
+
+#endif
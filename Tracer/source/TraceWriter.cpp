@@ -0,0 +1,1390 @@
+/*
+ *  TraceWriter.cpp
+ *  LPTracer
+ *
+ *  http://www.logicpoet.com
+ *
+ *  Copyright 2008 Logic Poet. All rights reserved.
+ * 
+ *  The MIT License
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without
+ *  restriction, including without limitation the rights to use,
+ *  copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following
+ *  conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *  OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "TraceWriter.h"
+#include <set>
+
+using namespace lpt;
+
+//Binary format encoding, shared by the binary writer and the flight recorder
+static size_t encodeVarint(unsigned long long value, char *buffer){
+    size_t length = 0;
+    while (value >= 0x80){
+        buffer[length++] = (char)((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    buffer[length++] = (char)value;
+    return length;
+}
+
+static void appendVarint(string &out, unsigned long long value){
+    char buffer[10];
+    out.append(buffer, encodeVarint(value, buffer));
+}
+
+static void appendBinaryString(string &out, const PropertyText &str){
+    appendVarint(out, str.length);
+    out.append(str.data, str.length);
+}
+
+//Type byte and value of a typed property or change
+static void appendBinaryValue(string &out, const PropertyValue &value){
+    switch (value.type){
+        case PROPERTY_INT:
+            out += (char)BIN_VALUE_INT;
+            //Zigzag so small negative numbers stay short
+            appendVarint(out, ((unsigned long long)value.intValue << 1) ^ (unsigned long long)(value.intValue >> 63));
+            break;
+        case PROPERTY_DOUBLE: {
+            out += (char)BIN_VALUE_DOUBLE;
+            unsigned long long bits;
+            memcpy(&bits, &value.doubleValue, sizeof(bits));
+            for (int i = 0; i < 8; i++){
+                out += (char)(bits & 0xFF);
+                bits >>= 8;
+            }
+            break;
+        }
+        case PROPERTY_BOOL:
+            out += (char)BIN_VALUE_BOOL;
+            out += (char)(value.boolValue ? 1 : 0);
+            break;
+        case PROPERTY_BLOB:
+            out += (char)BIN_VALUE_BLOB;
+            appendBinaryString(out, PropertyText(value.data, value.length));
+            break;
+        default:
+            out += (char)BIN_VALUE_STRING;
+            appendBinaryString(out, PropertyText(value.data, value.length));
+            break;
+    }
+}
+
+//Writes the sidecar index, if one is being kept, once the trace file is closed
+static void writeIndex(TraceIndex &index, const string &filename, bool compressed){
+    if (index.isEnabled() && !index.write(filename + ".idx", compressed)){
+        cout << "***Tracer Warning*** Cannot write index file : " << filename << ".idx" << endl;
+    }
+}
+
+#pragma mark -
+#pragma mark XmlTraceWriter
+
+//Copies a literal into buffer without the terminating null, returning its length
+static size_t appendText(char *buffer, const char *text){
+    size_t length = strlen(text);
+    memcpy(buffer, text, length);
+    return length;
+}
+
+XmlTraceWriter::XmlTraceWriter(bool compressed){
+    this->compressed = compressed;
+    eventTagOpen = false;
+}
+
+bool XmlTraceWriter::open(const string &filename){
+    this->filename = filename;
+    if (!outfile.open(filename, compressed)) return false;
+    outfile << "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n";
+    //0.8: integer times with a resolution, signals, changes, links and spans
+    outfile << "<!DOCTYPE document PUBLIC \"-//LOGICPOET//DTD Scansion Tracefile version 0.8//EN\"\n";
+    outfile << "\"http://www.logicpoet.com/DTD/scansion.dtd\" >\n";
+    //Event times are integers in units of the kernel time resolution, given here in seconds
+    char buffer[64];
+    sprintf(buffer, "%g", sc_core::sc_get_time_resolution().to_seconds());
+    outfile << "<document resolution=\"" << buffer << "\">\n";
+    return true;
+}
+
+void XmlTraceWriter::close(){
+    if (outfile.is_open()){
+        outfile << "</document>\n";
+        outfile.flush();
+        outfile.close();
+        writeIndex(index, filename, compressed);
+    }
+}
+
+void XmlTraceWriter::setIndexing(unsigned int eventInterval, unsigned int byteInterval){
+    index.enable(eventInterval, byteInterval);
+}
+
+void XmlTraceWriter::beginModule(int id, const string &name){
+    outfile << "<module id=\"M" << id << "\" name=\"" << name << "\">\n";
+}
+
+void XmlTraceWriter::endModule(){
+    outfile << "</module>\n";
+}
+
+void XmlTraceWriter::beginEventType(int id, const string &name){
+    if (index.isEnabled()) index.addEventType(id, outfile.getPosition());
+    outfile << "<eventtype id=\"E" << id << "\" name=\"" << name << "\">\n";
+}
+
+void XmlTraceWriter::endEventType(){
+    outfile << "</eventtype>\n";
+}
+
+void XmlTraceWriter::beginTrace(int id, const string &name){
+    if (index.isEnabled()) index.addTrace(id, outfile.getPosition());
+    outfile << "<trace id=\"T" << id << "\" name=\"" << name << "\">\n";
+}
+
+void XmlTraceWriter::endTrace(){
+    outfile << "</trace>\n";
+}
+
+void XmlTraceWriter::beginEvent(int eventTypeId, int traceId, int moduleId, unsigned long long time){
+    if (index.isEnabled()) index.addEvent(time, outfile.getPosition());
+    //Events are the bulk of the file so the tag is built in one buffer and written at once
+    char buffer[160];
+    size_t pos = 0;
+    pos += appendText(buffer+pos, "<event type=\"E");
+    pos += formatDecimal((long long)eventTypeId, buffer+pos);
+    pos += appendText(buffer+pos, "\" trace=\"T");
+    pos += formatDecimal((long long)traceId, buffer+pos);
+    pos += appendText(buffer+pos, "\" module=\"M");
+    pos += formatDecimal((long long)moduleId, buffer+pos);
+    pos += appendText(buffer+pos, "\" time=\"");
+    pos += formatDecimal(time, buffer+pos);
+    buffer[pos++] = '"';
+    outfile.write(buffer, pos);
+    eventTagOpen = true;
+}
+
+//A span is an event with a duration attribute, so readers that don't know
+//about durations still see it as an event at its start
+void XmlTraceWriter::beginSpan(int eventTypeId, int traceId, int moduleId, unsigned long long time, unsigned long long duration){
+    if (index.isEnabled()) index.addEvent(time + duration, outfile.getPosition());
+    char buffer[192];
+    size_t pos = 0;
+    pos += appendText(buffer+pos, "<event type=\"E");
+    pos += formatDecimal((long long)eventTypeId, buffer+pos);
+    pos += appendText(buffer+pos, "\" trace=\"T");
+    pos += formatDecimal((long long)traceId, buffer+pos);
+    pos += appendText(buffer+pos, "\" module=\"M");
+    pos += formatDecimal((long long)moduleId, buffer+pos);
+    pos += appendText(buffer+pos, "\" time=\"");
+    pos += formatDecimal(time, buffer+pos);
+    pos += appendText(buffer+pos, "\" duration=\"");
+    pos += formatDecimal(duration, buffer+pos);
+    buffer[pos++] = '"';
+    outfile.write(buffer, pos);
+    eventTagOpen = true;
+}
+
+void XmlTraceWriter::endEvent(){
+    if (eventTagOpen){
+        outfile << "/>\n";
+        eventTagOpen = false;
+    }
+    else {
+        outfile << "</event>\n";
+    }
+}
+
+void XmlTraceWriter::writeProperty(const PropertyText &name, const PropertyValue &value){
+    if (eventTagOpen){
+        outfile << ">\n";
+        eventTagOpen = false;
+    }
+    //Blobs need two characters a byte plus the 0x prefix
+    size_t needed = value.length*2 + 64;
+    if (formatBuffer.size() < needed) formatBuffer.resize(needed);
+    PropertyText text = value.format(&formatBuffer[0], formatBuffer.size());
+    outfile << "<property name=\"";
+    outfile.write(name.data, name.length);
+    outfile << "\" value=\"";
+    outfile.write(text.data, text.length);
+    outfile << "\"/>\n";
+}
+
+void XmlTraceWriter::declareSignal(int id, const string &name, int width){
+    outfile << "<signal id=\"S" << id << "\" name=\"" << name << "\" width=\"" << width << "\"/>\n";
+}
+
+//Changes can be as numerous as events, so they are built in one buffer like events
+void XmlTraceWriter::writeChange(int signalId, unsigned long long time, const PropertyValue &value){
+    size_t needed = value.length*2 + 160;
+    if (formatBuffer.size() < needed) formatBuffer.resize(needed);
+    char *buffer = &formatBuffer[0];
+    size_t pos = 0;
+    pos += appendText(buffer+pos, "<change signal=\"S");
+    pos += formatDecimal((long long)signalId, buffer+pos);
+    pos += appendText(buffer+pos, "\" time=\"");
+    pos += formatDecimal(time, buffer+pos);
+    pos += appendText(buffer+pos, "\" value=\"");
+    PropertyText text = value.format(buffer+pos, formatBuffer.size()-pos-4);
+    if (text.data != buffer+pos) memcpy(buffer+pos, text.data, text.length);
+    pos += text.length;
+    pos += appendText(buffer+pos, "\"/>\n");
+    outfile.write(buffer, pos);
+}
+
+void XmlTraceWriter::writeLink(int kind, int fromTraceId, int toTraceId, unsigned long long time){
+    outfile << "<link type=\"" << (kind == LINK_MERGE ? "merge" : "child") << "\" from=\"T" << fromTraceId
+            << "\" to=\"T" << toTraceId << "\" time=\"" << time << "\"/>\n";
+}
+
+#pragma mark -
+#pragma mark BinaryTraceWriter
+
+BinaryTraceWriter::BinaryTraceWriter(bool compressed){
+    this->compressed = compressed;
+    keyCount = 0;
+    eventPending = false;
+    spanPending = false;
+}
+
+bool BinaryTraceWriter::open(const string &filename){
+    this->filename = filename;
+    if (!outfile.open(filename, compressed)) return false;
+    outfile.write(BINARY_MAGIC, 4);
+    writeTag(BINARY_VERSION);
+    //Time resolution in femtoseconds so readers can scale the integer timestamps
+    double resolution = sc_core::sc_get_time_resolution().to_seconds();
+    writeVarint((unsigned long long)(resolution * 1e15 + 0.5));
+    return true;
+}
+
+void BinaryTraceWriter::close(){
+    if (outfile.is_open()){
+        writeTag(BIN_EOF);
+        outfile.flush();
+        outfile.close();
+        writeIndex(index, filename, compressed);
+    }
+}
+
+void BinaryTraceWriter::setIndexing(unsigned int eventInterval, unsigned int byteInterval){
+    index.enable(eventInterval, byteInterval);
+}
+
+void BinaryTraceWriter::beginModule(int id, const string &name){
+    writeTag(BIN_MODULE_BEGIN);
+    writeVarint(id);
+    writeString(name);
+}
+
+void BinaryTraceWriter::endModule(){
+    writeTag(BIN_MODULE_END);
+}
+
+void BinaryTraceWriter::beginEventType(int id, const string &name){
+    if (index.isEnabled()) index.addEventType(id, outfile.getPosition());
+    writeTag(BIN_EVENTTYPE);
+    writeVarint(id);
+    writeString(name);
+}
+
+void BinaryTraceWriter::endEventType(){
+    writeTag(BIN_END);
+}
+
+void BinaryTraceWriter::beginTrace(int id, const string &name){
+    if (index.isEnabled()) index.addTrace(id, outfile.getPosition());
+    writeTag(BIN_TRACE);
+    writeVarint(id);
+    writeString(name);
+}
+
+void BinaryTraceWriter::endTrace(){
+    writeTag(BIN_END);
+}
+
+void BinaryTraceWriter::beginEvent(int eventTypeId, int traceId, int moduleId, unsigned long long time){
+    //Key records written before the event is flushed come after this position,
+    //which is fine since readers can start at any record
+    if (index.isEnabled()) index.addEvent(time, outfile.getPosition());
+    pendingEvent[0] = eventTypeId;
+    pendingEvent[1] = traceId;
+    pendingEvent[2] = moduleId;
+    pendingEvent[3] = time;
+    eventPending = true;
+    spanPending = false;
+}
+
+//Indexed at its end, when it is written, so index entries stay in time order
+void BinaryTraceWriter::beginSpan(int eventTypeId, int traceId, int moduleId, unsigned long long time, unsigned long long duration){
+    if (index.isEnabled()) index.addEvent(time + duration, outfile.getPosition());
+    pendingEvent[0] = eventTypeId;
+    pendingEvent[1] = traceId;
+    pendingEvent[2] = moduleId;
+    pendingEvent[3] = time;
+    pendingEvent[4] = duration;
+    eventPending = true;
+    spanPending = true;
+}
+
+void BinaryTraceWriter::endEvent(){
+    if (eventPending) flushPendingEvent(false);
+    else writeTag(BIN_END);
+}
+
+void BinaryTraceWriter::writeProperty(const PropertyText &name, const PropertyValue &value){
+    int keyId = getKeyId(name);
+    if (eventPending) flushPendingEvent(true);
+    if (value.type == PROPERTY_STRING || value.type == PROPERTY_NONE){
+        writeTag(BIN_PROPERTY);
+        writeVarint(keyId);
+        writeString(PropertyText(value.data, value.length));
+        return;
+    }
+    writeTag(BIN_PROPERTY_TYPED);
+    writeVarint(keyId);
+    writeValue(value);
+}
+
+void BinaryTraceWriter::declareSignal(int id, const string &name, int width){
+    writeTag(BIN_SIGNAL);
+    writeVarint(id);
+    writeString(name);
+    writeVarint(width);
+}
+
+void BinaryTraceWriter::writeChange(int signalId, unsigned long long time, const PropertyValue &value){
+    writeTag(BIN_CHANGE);
+    writeVarint(signalId);
+    writeVarint(time);
+    writeValue(value);
+}
+
+void BinaryTraceWriter::writeLink(int kind, int fromTraceId, int toTraceId, unsigned long long time){
+    writeTag(BIN_LINK);
+    writeVarint(kind);
+    writeVarint(fromTraceId);
+    writeVarint(toTraceId);
+    writeVarint(time);
+}
+
+void BinaryTraceWriter::writeValue(const PropertyValue &value){
+    valueBuffer.clear();
+    appendBinaryValue(valueBuffer, value);
+    outfile.write(valueBuffer.data(), valueBuffer.size());
+}
+
+int BinaryTraceWriter::getKeyId(const PropertyText &name){
+    //Property names are short so this key normally fits in the string's inline buffer
+    string key(name.data, name.length);
+    int *id = keyIdMap.find(key);
+    if (id) return *id;
+    int keyId = ++keyCount;
+    keyIdMap.insert(key, keyId);
+    index.addKey(keyId, key);
+    //Key records may appear anywhere, including ahead of the event that first uses them
+    writeTag(BIN_KEY);
+    writeVarint(keyId);
+    writeString(name);
+    return keyId;
+}
+
+void BinaryTraceWriter::flushPendingEvent(bool withProperties){
+    if (spanPending) writeTag(withProperties ? BIN_SPAN : BIN_SPAN_SHORT);
+    else writeTag(withProperties ? BIN_EVENT : BIN_EVENT_SHORT);
+    int count = spanPending ? 5 : 4;
+    for (int i = 0; i < count; i++) writeVarint(pendingEvent[i]);
+    eventPending = false;
+}
+
+void BinaryTraceWriter::writeTag(unsigned char tag){
+    outfile.put((char)tag);
+}
+
+void BinaryTraceWriter::writeVarint(unsigned long long value){
+    char buffer[10];
+    outfile.write(buffer, encodeVarint(value, buffer));
+}
+
+void BinaryTraceWriter::writeString(const PropertyText &str){
+    writeVarint(str.length);
+    outfile.write(str.data, str.length);
+}
+
+#pragma mark -
+#pragma mark FlightRecorderWriter
+
+FlightRecorderWriter::FlightRecorderWriter(size_t ringBytes, bool compressed){
+    this->compressed = compressed;
+    closed = false;
+    keyCount = 0;
+    //Allocated and touched now so recording never allocates or faults in pages
+    size_t traceBytes = ringBytes / 8;
+    ring.bytes.resize(ringBytes - traceBytes, 0);
+    ring.head = 0;
+    ring.used = 0;
+    traces.bytes.resize(traceBytes, 0);
+    traces.head = 0;
+    traces.used = 0;
+    header.reserve(FLIGHT_HEADER_BYTES);
+    keys.reserve(FLIGHT_KEY_BYTES);
+    keyIdMap.reserve(FLIGHT_KEYS);
+    keyBuffer.reserve(FLIGHT_KEY_LENGTH);
+    record.reserve(FLIGHT_RECORD_BYTES);
+    evicted.resize(FLIGHT_RECORD_BYTES);
+    dropped = 0;
+    skipped = 0;
+    skippedModules = 0;
+    skippedEventType = false;
+    current = &record;
+    shortEvent = false;
+}
+
+bool FlightRecorderWriter::open(const string &filename){
+    this->filename = filename;
+    return true;
+}
+
+void FlightRecorderWriter::close(){
+    if (closed) return;
+    closed = true;
+    if (!dump(filename)){
+        cout << "***Tracer Error*** Cannot Open Trace File : " << filename << endl;
+    }
+}
+
+void FlightRecorderWriter::setIndexing(unsigned int /*eventInterval*/, unsigned int /*byteInterval*/){
+    //Dumps are not indexed
+}
+
+static unsigned long long readVarint(const char *&pos){
+    unsigned long long value = 0;
+    for (int shift = 0; ; shift += 7){
+        unsigned char byte = (unsigned char)*pos++;
+        value |= (unsigned long long)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+}
+
+//Writes a complete binary trace: the header, the keys, the modules, event
+//types and signals, the traces whose records the ring has dropped, and then
+//the ring from its oldest record on
+bool FlightRecorderWriter::dump(const string &filename){
+    TraceFile outfile;
+    if (!outfile.open(filename, compressed)) return false;
+    string start(BINARY_MAGIC, 4);
+    start += (char)BINARY_VERSION;
+    appendVarint(start, (unsigned long long)(sc_core::sc_get_time_resolution().to_seconds() * 1e15 + 0.5));
+    outfile.write(start.data(), start.size());
+    outfile.write(keys.data(), keys.size());
+    outfile.write(header.data(), header.size());
+
+    //Traces the ring's records use but no longer define
+    std::set<int> defined, missing;
+    vector<char> bytes;
+    size_t pos = ring.head;
+    for (size_t remaining = ring.used; remaining; ){
+        size_t size = ring.read(pos, bytes);
+        remaining -= 4 + size;
+        const char *field = &bytes[1];
+        switch ((unsigned char)bytes[0]){
+            case BIN_TRACE:
+                defined.insert((int)readVarint(field));
+                break;
+            case BIN_EVENT: case BIN_EVENT_SHORT: case BIN_SPAN: case BIN_SPAN_SHORT: {
+                readVarint(field);
+                int traceId = (int)readVarint(field);
+                if (!defined.count(traceId)) missing.insert(traceId);
+                break;
+            }
+            case BIN_LINK: {
+                readVarint(field);
+                int fromTraceId = (int)readVarint(field);
+                int toTraceId = (int)readVarint(field);
+                if (!defined.count(fromTraceId)) missing.insert(fromTraceId);
+                if (!defined.count(toTraceId)) missing.insert(toTraceId);
+                break;
+            }
+        }
+    }
+    pos = traces.head;
+    for (size_t remaining = traces.used; remaining && !missing.empty(); ){
+        size_t size = traces.read(pos, bytes);
+        remaining -= 4 + size;
+        const char *field = &bytes[1];
+        if (missing.erase((int)readVarint(field))) outfile.write(&bytes[0], size);
+    }
+    //Traces that have left both rings are written without a name
+    for (std::set<int>::iterator id = missing.begin(); id != missing.end(); id++){
+        string trace(1, (char)BIN_TRACE);
+        appendVarint(trace, *id);
+        appendBinaryString(trace, "");
+        trace += (char)BIN_END;
+        outfile.write(trace.data(), trace.size());
+    }
+
+    pos = ring.head;
+    for (size_t remaining = ring.used; remaining; ){
+        size_t size = ring.read(pos, bytes);
+        remaining -= 4 + size;
+        outfile.write(&bytes[0], size);
+    }
+    outfile.put((char)BIN_EOF);
+    outfile.flush();
+    outfile.close();
+    return true;
+}
+
+void FlightRecorderWriter::skip(){
+    if (!skipped){
+        cout << "***Tracer Warning*** Flight recorder tables are full, leaving out what does not fit" << endl;
+    }
+    skipped++;
+}
+
+bool FlightRecorderWriter::fits(const string &buffer, size_t limit, size_t bytes){
+    if (buffer.size() + bytes <= limit) return true;
+    skip();
+    return false;
+}
+
+//Names are cut short so a record always fits
+static PropertyText recordName(const string &name){
+    return PropertyText(name.data(), (name.size() < FLIGHT_KEY_LENGTH) ? name.size() : FLIGHT_KEY_LENGTH);
+}
+
+//A module that does not fit is left out along with the modules inside it
+void FlightRecorderWriter::beginModule(int id, const string &name){
+    if (skippedModules || !fits(header, FLIGHT_HEADER_BYTES, name.size() + 16)){
+        skippedModules++;
+        return;
+    }
+    header += (char)BIN_MODULE_BEGIN;
+    appendVarint(header, id);
+    appendBinaryString(header, name);
+}
+
+void FlightRecorderWriter::endModule(){
+    if (skippedModules){
+        skippedModules--;
+        return;
+    }
+    header += (char)BIN_MODULE_END;
+}
+
+//Room is kept for the modules' ends and the event type's BIN_END
+void FlightRecorderWriter::beginEventType(int id, const string &name){
+    skippedEventType = !fits(header, FLIGHT_HEADER_BYTES - 64, name.size() + 16);
+    current = skippedEventType ? 0 : &header;
+    if (skippedEventType) return;
+    header += (char)BIN_EVENTTYPE;
+    appendVarint(header, id);
+    appendBinaryString(header, name);
+}
+
+void FlightRecorderWriter::endEventType(){
+    if (!skippedEventType) header += (char)BIN_END;
+    skippedEventType = false;
+    current = &record;
+}
+
+void FlightRecorderWriter::beginTrace(int id, const string &name){
+    record.clear();
+    record += (char)BIN_TRACE;
+    appendVarint(record, id);
+    appendBinaryString(record, recordName(name));
+}
+
+void FlightRecorderWriter::endTrace(){
+    record += (char)BIN_END;
+    commit();
+}
+
+//Events start out short and become long ones if a property follows
+void FlightRecorderWriter::beginEvent(int eventTypeId, int traceId, int moduleId, unsigned long long time){
+    record.clear();
+    record += (char)BIN_EVENT_SHORT;
+    appendVarint(record, eventTypeId);
+    appendVarint(record, traceId);
+    appendVarint(record, moduleId);
+    appendVarint(record, time);
+    shortEvent = true;
+}
+
+void FlightRecorderWriter::beginSpan(int eventTypeId, int traceId, int moduleId, unsigned long long time, unsigned long long duration){
+    record.clear();
+    record += (char)BIN_SPAN_SHORT;
+    appendVarint(record, eventTypeId);
+    appendVarint(record, traceId);
+    appendVarint(record, moduleId);
+    appendVarint(record, time);
+    appendVarint(record, duration);
+    shortEvent = true;
+}
+
+void FlightRecorderWriter::endEvent(){
+    if (!shortEvent) record += (char)BIN_END;
+    shortEvent = false;
+    commit();
+}
+
+//A property that does not fit is left out, the record keeps room for BIN_END
+void FlightRecorderWriter::writeProperty(const PropertyText &name, const PropertyValue &value){
+    if (!current) return;
+    size_t limit = (current == &header) ? FLIGHT_HEADER_BYTES - 64 : FLIGHT_RECORD_BYTES - 1;
+    if (!fits(*current, limit, value.length + 32)) return;
+    int keyId = getKeyId(name);
+    if (!keyId) return;
+    if (shortEvent && current == &record){
+        record[0] = (char)((record[0] == (char)BIN_SPAN_SHORT) ? BIN_SPAN : BIN_EVENT);
+        shortEvent = false;
+    }
+    if (value.type == PROPERTY_STRING || value.type == PROPERTY_NONE){
+        *current += (char)BIN_PROPERTY;
+        appendVarint(*current, keyId);
+        appendBinaryString(*current, PropertyText(value.data, value.length));
+        return;
+    }
+    *current += (char)BIN_PROPERTY_TYPED;
+    appendVarint(*current, keyId);
+    appendBinaryValue(*current, value);
+}
+
+void FlightRecorderWriter::declareSignal(int id, const string &name, int width){
+    if (!fits(header, FLIGHT_HEADER_BYTES - 64, name.size() + 32)) return;
+    header += (char)BIN_SIGNAL;
+    appendVarint(header, id);
+    appendBinaryString(header, name);
+    appendVarint(header, width);
+}
+
+void FlightRecorderWriter::writeChange(int signalId, unsigned long long time, const PropertyValue &value){
+    record.clear();
+    if (!fits(record, FLIGHT_RECORD_BYTES, value.length + 32)) return;
+    record += (char)BIN_CHANGE;
+    appendVarint(record, signalId);
+    appendVarint(record, time);
+    appendBinaryValue(record, value);
+    commit();
+}
+
+//Links go in the ring, so a link is dropped along with the records around it
+void FlightRecorderWriter::writeLink(int kind, int fromTraceId, int toTraceId, unsigned long long time){
+    record.clear();
+    record += (char)BIN_LINK;
+    appendVarint(record, kind);
+    appendVarint(record, fromTraceId);
+    appendVarint(record, toTraceId);
+    appendVarint(record, time);
+    commit();
+}
+
+//Returns 0 for a name that does not fit in the key tables
+int FlightRecorderWriter::getKeyId(const PropertyText &name){
+    if (name.length > FLIGHT_KEY_LENGTH){
+        skip();
+        return 0;
+    }
+    keyBuffer.assign(name.data, name.length);
+    int *id = keyIdMap.find(keyBuffer);
+    if (id) return *id;
+    if (keyCount == (int)FLIGHT_KEYS){
+        skip();
+        return 0;
+    }
+    if (!fits(keys, FLIGHT_KEY_BYTES, name.length + 16)) return 0;
+    int keyId = ++keyCount;
+    keyIdMap.insert(keyBuffer, keyId);
+    keys += (char)BIN_KEY;
+    appendVarint(keys, keyId);
+    appendBinaryString(keys, name);
+    return keyId;
+}
+
+//Copies the finished record into the ring, dropping the oldest records to
+//make room
+void FlightRecorderWriter::commit(){
+    size_t size = record.size();
+    if (size + 4 > ring.bytes.size()){
+        dropped++;
+        return;
+    }
+    while (!ring.hasRoom(size)){
+        size_t oldest = ring.pop(evicted);
+        dropped++;
+        if (evicted[0] != (char)BIN_TRACE || oldest + 4 > traces.bytes.size()) continue;
+        while (!traces.hasRoom(oldest)) traces.dropOldest();
+        traces.push(&evicted[0], oldest);
+    }
+    ring.push(record.data(), size);
+}
+
+void FlightRecorderWriter::Ring::push(const char *data, size_t size){
+    char length[4] = {(char)(size & 0xFF), (char)((size >> 8) & 0xFF), (char)((size >> 16) & 0xFF), (char)((size >> 24) & 0xFF)};
+    size_t tail = (head + used) % bytes.size();
+    copyIn(tail, length, 4);
+    copyIn((tail + 4) % bytes.size(), data, size);
+    used += size + 4;
+}
+
+size_t FlightRecorderWriter::Ring::pop(vector<char> &record){
+    size_t size = read(head, record);
+    used -= 4 + size;
+    return size;
+}
+
+void FlightRecorderWriter::Ring::dropOldest(){
+    size_t size = lengthAt(head);
+    head = (head + 4 + size) % bytes.size();
+    used -= 4 + size;
+}
+
+size_t FlightRecorderWriter::Ring::lengthAt(size_t pos){
+    unsigned char length[4];
+    copyOut(pos, (char *)length, 4);
+    return length[0] | (length[1] << 8) | (length[2] << 16) | ((size_t)length[3] << 24);
+}
+
+size_t FlightRecorderWriter::Ring::read(size_t &pos, vector<char> &record){
+    size_t size = lengthAt(pos);
+    if (record.size() < size) record.resize(size);
+    copyOut((pos + 4) % bytes.size(), &record[0], size);
+    pos = (pos + 4 + size) % bytes.size();
+    return size;
+}
+
+void FlightRecorderWriter::Ring::copyIn(size_t pos, const char *data, size_t length){
+    size_t first = bytes.size() - pos;
+    if (first >= length){
+        memcpy(&bytes[pos], data, length);
+    }
+    else {
+        memcpy(&bytes[pos], data, first);
+        memcpy(&bytes[0], data + first, length - first);
+    }
+}
+
+void FlightRecorderWriter::Ring::copyOut(size_t pos, char *data, size_t length){
+    size_t first = bytes.size() - pos;
+    if (first >= length){
+        memcpy(data, &bytes[pos], length);
+    }
+    else {
+        memcpy(data, &bytes[pos], first);
+        memcpy(data + first, &bytes[0], length - first);
+    }
+}
+
+#pragma mark -
+#pragma mark ChromeTraceWriter
+
+//Appends str as a quoted JSON string
+static void appendJsonString(string &out, const PropertyText &str){
+    static const char hex[] = "0123456789abcdef";
+    out += '"';
+    for (size_t i = 0; i < str.length; i++){
+        unsigned char c = (unsigned char)str.data[i];
+        if (c == '"' || c == '\\'){
+            out += '\\';
+            out += (char)c;
+        }
+        else if (c < 0x20){
+            out += "\\u00";
+            out += hex[c >> 4];
+            out += hex[c & 0xF];
+        }
+        else {
+            out += (char)c;
+        }
+    }
+    out += '"';
+}
+
+//Numbers and booleans are written as JSON values, everything else as strings
+static void appendJsonValue(string &out, const PropertyValue &value){
+    char buffer[32];
+    switch (value.type){
+        case PROPERTY_INT:
+            out.append(buffer, formatDecimal(value.intValue, buffer));
+            break;
+        case PROPERTY_DOUBLE:
+            //JSON has no infinity or NaN
+            if (value.doubleValue - value.doubleValue == 0){
+                out.append(buffer, snprintf(buffer, sizeof(buffer), "%.17g", value.doubleValue));
+            }
+            else {
+                out += "null";
+            }
+            break;
+        case PROPERTY_BOOL:
+            out += value.boolValue ? "true" : "false";
+            break;
+        default: {
+            string text = value.toString();
+            appendJsonString(out, text);
+            break;
+        }
+    }
+}
+
+ChromeTraceWriter::ChromeTraceWriter(){
+    current = IN_NONE;
+    timeDigits = 0;
+    timeScale = 1;
+    traceMembers = 0;
+    flowCount = 0;
+    firstRecord = true;
+    processId = 0;
+    processIds.push_back(0);
+    TraceState unused;
+    unused.id = 0;
+    unused.marked = false;
+    unused.lastTime = 0;
+    unused.lastProcess = unused.lastThread = 0;
+    traces.resize(CHROME_TRACE_SLOTS, unused);
+}
+
+bool ChromeTraceWriter::open(const string &filename){
+    if (!outfile.open(filename, false)) return false;
+    //Resolutions are powers of ten, find which one relative to a microsecond
+    double ticksPerMicrosecond = 1e-6 / sc_core::sc_get_time_resolution().to_seconds();
+    if (ticksPerMicrosecond >= 1){
+        while (ticksPerMicrosecond >= 10*timeScale - timeScale/2){
+            timeScale *= 10;
+            timeDigits++;
+        }
+    }
+    else {
+        while (ticksPerMicrosecond * timeScale < 0.5) timeScale *= 10;
+    }
+    outfile << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    return true;
+}
+
+void ChromeTraceWriter::close(){
+    if (outfile.is_open()){
+        outfile << "\n]}\n";
+        outfile.flush();
+        outfile.close();
+    }
+}
+
+void ChromeTraceWriter::setIndexing(unsigned int /*eventInterval*/, unsigned int /*byteInterval*/){
+    //The reader library does not read JSON, so there is nothing to index for
+}
+
+void ChromeTraceWriter::beginRecord(){
+    if (!firstRecord) outfile << ",\n";
+    firstRecord = false;
+}
+
+void ChromeTraceWriter::appendTime(string &out, unsigned long long time){
+    char buffer[24];
+    if (timeDigits == 0){
+        out.append(buffer, formatDecimal(time * timeScale, buffer));
+        return;
+    }
+    out.append(buffer, formatDecimal(time / timeScale, buffer));
+    unsigned long long fraction = time % timeScale;
+    if (fraction == 0) return;
+    //Zero pad the fraction to timeDigits and drop its trailing zeros
+    size_t length = formatDecimal(fraction, buffer);
+    out += '.';
+    out.append(timeDigits - length, '0');
+    while (buffer[length-1] == '0') length--;
+    out.append(buffer, length);
+}
+
+//Metadata records name the process and thread tracks.  The sort index keeps
+//the threads in hierarchy order.
+void ChromeTraceWriter::beginModule(int id, const string &name){
+    string fullName = modulePath.empty() ? name : modulePath.back() + "." + name;
+    modulePath.push_back(fullName);
+    if (processIds.size() <= (size_t)id) processIds.resize(id+1, 0);
+    if (modulePath.size() == 1) processId = id;
+    processIds[id] = processId;
+    eventBuffer.clear();
+    char buffer[24];
+    string pid(buffer, formatDecimal((long long)processId, buffer));
+    string tid(buffer, formatDecimal((long long)id, buffer));
+    if (modulePath.size() == 1){
+        eventBuffer += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" + pid + ",\"args\":{\"name\":";
+        appendJsonString(eventBuffer, fullName);
+        eventBuffer += "}},\n";
+    }
+    eventBuffer += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + pid + ",\"tid\":" + tid + ",\"args\":{\"name\":";
+    appendJsonString(eventBuffer, fullName);
+    eventBuffer += "}},\n";
+    eventBuffer += "{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":" + pid + ",\"tid\":" + tid + ",\"args\":{\"sort_index\":" + tid + "}}";
+    beginRecord();
+    outfile.write(eventBuffer.data(), eventBuffer.size());
+}
+
+void ChromeTraceWriter::endModule(){
+    modulePath.pop_back();
+}
+
+void ChromeTraceWriter::beginEventType(int id, const string &name){
+    if (eventTypeNames.size() <= (size_t)id) eventTypeNames.resize(id+1);
+    eventTypeNames[id].clear();
+    appendJsonString(eventTypeNames[id], name);
+    current = IN_EVENTTYPE;
+}
+
+void ChromeTraceWriter::endEventType(){
+    current = IN_NONE;
+}
+
+void ChromeTraceWriter::beginTrace(int id, const string &name){
+    //Takes the slot over from any older trace still in it
+    TraceState &state = traces[(unsigned int)id % traces.size()];
+    state.id = id;
+    state.marked = false;
+    traceMembers = &state.properties;
+    *traceMembers = "\"name\":";
+    appendJsonString(*traceMembers, name);
+    current = IN_TRACE;
+}
+
+void ChromeTraceWriter::endTrace(){
+    traceMembers = 0;
+    current = IN_NONE;
+}
+
+//Events are zero length complete ("X") slices and spans slices of their
+//duration.  Each event after the first of its trace is joined to the one
+//before by a flow start ("s") on the previous slice and a finish ("f") on this
+//one, so the arrow is only written once both ends are known.
+void ChromeTraceWriter::beginEvent(int eventTypeId, int traceId, int moduleId, unsigned long long time){
+    beginSpan(eventTypeId, traceId, moduleId, time, 0);
+}
+
+void ChromeTraceWriter::beginSpan(int eventTypeId, int traceId, int moduleId, unsigned long long time, unsigned long long duration){
+    char buffer[24];
+    eventBuffer = "{\"name\":";
+    if ((size_t)eventTypeId < eventTypeNames.size()) eventBuffer += eventTypeNames[eventTypeId];
+    else eventBuffer += "\"\"";
+    eventBuffer += ",\"ph\":\"X\",\"ts\":";
+    appendTime(eventBuffer, time);
+    eventBuffer += ",\"dur\":";
+    appendTime(eventBuffer, duration);
+    eventBuffer += ",\"pid\":";
+    int processId = ((size_t)moduleId < processIds.size()) ? processIds[moduleId] : 0;
+    eventBuffer.append(buffer, formatDecimal((long long)processId, buffer));
+    eventBuffer += ",\"tid\":";
+    eventBuffer.append(buffer, formatDecimal((long long)moduleId, buffer));
+    eventBuffer += ",\"args\":{\"trace\":";
+    eventBuffer.append(buffer, formatDecimal((long long)traceId, buffer));
+    flowEnd.clear();
+    TraceState *state = findTrace(traceId);
+    if (state){
+        if (!state->marked){
+            eventBuffer += ",\"trace properties\":{" + state->properties + "}";
+            string().swap(state->properties);
+            state->marked = true;
+        }
+        else {
+            string flowStart;
+            flowCount++;
+            appendFlow(flowStart, 's', state->lastTime, state->lastProcess, state->lastThread);
+            beginRecord();
+            outfile.write(flowStart.data(), flowStart.size());
+            appendFlow(flowEnd, 'f', time, processId, moduleId);
+        }
+        state->lastTime = time;
+        state->lastProcess = processId;
+        state->lastThread = moduleId;
+    }
+    current = IN_EVENT;
+}
+
+void ChromeTraceWriter::endEvent(){
+    eventBuffer += "}}";
+    beginRecord();
+    outfile.write(eventBuffer.data(), eventBuffer.size());
+    if (!flowEnd.empty()){
+        beginRecord();
+        outfile.write(flowEnd.data(), flowEnd.size());
+    }
+    current = IN_NONE;
+}
+
+//Flow events bind to the slice enclosing their time on their thread.  Every
+//arrow has an id of its own so arrows that meet at an event can't be confused.
+void ChromeTraceWriter::appendFlow(string &out, char phase, unsigned long long time, int processId, int threadId){
+    char buffer[24];
+    out += "{\"name\":\"trace\",\"cat\":\"trace\",\"ph\":\"";
+    out += phase;
+    out += phase == 'f' ? "\",\"bp\":\"e\",\"id\":" : "\",\"id\":";
+    out.append(buffer, formatDecimal((long long)flowCount, buffer));
+    out += ",\"ts\":";
+    appendTime(out, time);
+    out += ",\"pid\":";
+    out.append(buffer, formatDecimal((long long)processId, buffer));
+    out += ",\"tid\":";
+    out.append(buffer, formatDecimal((long long)threadId, buffer));
+    out += '}';
+}
+
+void ChromeTraceWriter::retireTrace(int traceId){
+    TraceState *state = findTrace(traceId);
+    if (state){
+        state->id = 0;
+        string().swap(state->properties);
+    }
+}
+
+void ChromeTraceWriter::writeProperty(const PropertyText &name, const PropertyValue &value){
+    string *out;
+    switch (current){
+        case IN_TRACE: out = traceMembers; break;
+        case IN_EVENT: out = &eventBuffer; break;
+        default: return;
+    }
+    *out += ',';
+    appendJsonString(*out, name);
+    *out += ':';
+    appendJsonValue(*out, value);
+}
+
+//Signals go in a process of their own, numeric ones as counter tracks and the
+//rest (bit vectors and enums) as instant events carrying the value
+void ChromeTraceWriter::declareSignal(int id, const string &name, int /*width*/){
+    if (signalNames.empty()){
+        beginRecord();
+        outfile << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"Signals\"}}";
+    }
+    if (signalNames.size() <= (size_t)id) signalNames.resize(id+1);
+    signalNames[id].clear();
+    appendJsonString(signalNames[id], name);
+}
+
+void ChromeTraceWriter::writeChange(int signalId, unsigned long long time, const PropertyValue &value){
+    bool counter = (value.type == PROPERTY_INT || value.type == PROPERTY_DOUBLE || value.type == PROPERTY_BOOL);
+    eventBuffer = "{\"name\":";
+    if ((size_t)signalId < signalNames.size()) eventBuffer += signalNames[signalId];
+    else eventBuffer += "\"\"";
+    eventBuffer += counter ? ",\"ph\":\"C\",\"ts\":" : ",\"ph\":\"i\",\"s\":\"t\",\"ts\":";
+    appendTime(eventBuffer, time);
+    eventBuffer += ",\"pid\":0,\"tid\":0,\"args\":{\"value\":";
+    if (value.type == PROPERTY_BOOL) eventBuffer += value.boolValue ? '1' : '0';
+    else appendJsonValue(eventBuffer, value);
+    eventBuffer += "}}";
+    beginRecord();
+    outfile.write(eventBuffer.data(), eventBuffer.size());
+}
+
+//A child whose trace hasn't shown up on an event yet gets its parent in its
+//trace properties.  Other links become global instant events.
+void ChromeTraceWriter::writeLink(int kind, int fromTraceId, int toTraceId, unsigned long long time){
+    char buffer[24];
+    string from(buffer, formatDecimal((long long)fromTraceId, buffer));
+    TraceState *child = findTrace(toTraceId);
+    if (kind == LINK_CHILD && child && !child->marked){
+        child->properties += ",\"parent trace\":" + from;
+        return;
+    }
+    eventBuffer = "{\"name\":\"";
+    eventBuffer += (kind == LINK_MERGE) ? "merge trace" : "child trace";
+    eventBuffer += "\",\"ph\":\"i\",\"s\":\"g\",\"ts\":";
+    appendTime(eventBuffer, time);
+    eventBuffer += ",\"pid\":0,\"tid\":0,\"args\":{\"from\":" + from + ",\"to\":";
+    eventBuffer.append(buffer, formatDecimal((long long)toTraceId, buffer));
+    eventBuffer += "}}";
+    beginRecord();
+    outfile.write(eventBuffer.data(), eventBuffer.size());
+}
+
+#pragma mark -
+#pragma mark AsyncTraceWriter
+
+AsyncTraceWriter::AsyncTraceWriter(TraceWriter *target, unsigned int bufferRecords, size_t bufferBytes){
+    this->target = target;
+    this->bufferRecords = bufferRecords;
+    this->bufferBytes = bufferBytes;
+    for (int i = 0; i < 2; i++){
+        buffers[i].records.reserve(bufferRecords);
+        buffers[i].strings.reserve(bufferBytes);
+    }
+    fillBuffer = &buffers[0];
+    drainBuffer = &buffers[1];
+    drainPending = false;
+    stopping = false;
+    threadStarted = false;
+    closed = false;
+    pthread_mutex_init(&mutex, 0);
+    pthread_cond_init(&drainReady, 0);
+    pthread_cond_init(&drainDone, 0);
+}
+
+AsyncTraceWriter::~AsyncTraceWriter(){
+    close();
+    pthread_cond_destroy(&drainDone);
+    pthread_cond_destroy(&drainReady);
+    pthread_mutex_destroy(&mutex);
+    delete target;
+}
+
+void AsyncTraceWriter::setIndexing(unsigned int eventInterval, unsigned int byteInterval){
+    target->setIndexing(eventInterval, byteInterval);
+}
+
+//Opening happens on the simulation thread so the target can query the kernel
+bool AsyncTraceWriter::open(const string &filename){
+    if (!target->open(filename)) return false;
+    if (pthread_create(&thread, 0, threadEntry, this) != 0){
+        cout << "***Tracer Warning*** Cannot start the writer thread, writing synchronously." << endl;
+        return true;
+    }
+    threadStarted = true;
+    return true;
+}
+
+//Drains everything that is still queued and then closes the target
+void AsyncTraceWriter::close(){
+    if (closed) return;
+    closed = true;
+    if (threadStarted){
+        swapBuffers();
+        pthread_mutex_lock(&mutex);
+        stopping = true;
+        pthread_cond_signal(&drainReady);
+        pthread_mutex_unlock(&mutex);
+        pthread_join(thread, 0);
+        threadStarted = false;
+    }
+    else {
+        drain(fillBuffer);
+    }
+    target->close();
+}
+
+void AsyncTraceWriter::beginModule(int id, const string &name){
+    Record &rec = append(MODULE_BEGIN);
+    rec.ids[0] = id;
+    appendString(name, rec.nameOffset, rec.nameLength);
+}
+
+void AsyncTraceWriter::endModule(){
+    append(MODULE_END);
+}
+
+void AsyncTraceWriter::beginEventType(int id, const string &name){
+    Record &rec = append(EVENTTYPE_BEGIN);
+    rec.ids[0] = id;
+    appendString(name, rec.nameOffset, rec.nameLength);
+}
+
+void AsyncTraceWriter::endEventType(){
+    append(EVENTTYPE_END);
+}
+
+void AsyncTraceWriter::beginTrace(int id, const string &name){
+    Record &rec = append(TRACE_BEGIN);
+    rec.ids[0] = id;
+    appendString(name, rec.nameOffset, rec.nameLength);
+}
+
+void AsyncTraceWriter::endTrace(){
+    append(TRACE_END);
+}
+
+void AsyncTraceWriter::beginEvent(int eventTypeId, int traceId, int moduleId, unsigned long long time){
+    Record &rec = append(EVENT_BEGIN);
+    rec.ids[0] = eventTypeId;
+    rec.ids[1] = traceId;
+    rec.ids[2] = moduleId;
+    rec.time = time;
+}
+
+void AsyncTraceWriter::beginSpan(int eventTypeId, int traceId, int moduleId, unsigned long long time, unsigned long long duration){
+    Record &rec = append(SPAN_BEGIN);
+    rec.ids[0] = eventTypeId;
+    rec.ids[1] = traceId;
+    rec.ids[2] = moduleId;
+    rec.time = time;
+    rec.nameOffset = (size_t)(duration & 0xFFFFFFFF);
+    rec.nameLength = (size_t)(duration >> 32);
+}
+
+void AsyncTraceWriter::endEvent(){
+    append(EVENT_END);
+}
+
+void AsyncTraceWriter::writeProperty(const PropertyText &name, const PropertyValue &value){
+    Record &rec = append(PROPERTY);
+    rec.ids[0] = value.type;
+    rec.time = getValueBits(value);
+    appendString(name, rec.nameOffset, rec.nameLength);
+    appendString(PropertyText(value.data, value.length), rec.valueOffset, rec.valueLength);
+}
+
+void AsyncTraceWriter::declareSignal(int id, const string &name, int width){
+    Record &rec = append(SIGNAL);
+    rec.ids[0] = id;
+    rec.ids[1] = width;
+    appendString(name, rec.nameOffset, rec.nameLength);
+}
+
+//The time takes the place of the value bits, which go into the name slot instead
+void AsyncTraceWriter::writeChange(int signalId, unsigned long long time, const PropertyValue &value){
+    Record &rec = append(CHANGE);
+    rec.ids[0] = signalId;
+    rec.ids[1] = value.type;
+    rec.time = time;
+    unsigned long long bits = getValueBits(value);
+    rec.nameOffset = (size_t)(bits & 0xFFFFFFFF);
+    rec.nameLength = (size_t)(bits >> 32);
+    appendString(PropertyText(value.data, value.length), rec.valueOffset, rec.valueLength);
+}
+
+void AsyncTraceWriter::writeLink(int kind, int fromTraceId, int toTraceId, unsigned long long time){
+    Record &rec = append(LINK);
+    rec.ids[0] = kind;
+    rec.ids[1] = fromTraceId;
+    rec.ids[2] = toTraceId;
+    rec.time = time;
+}
+
+void AsyncTraceWriter::retireTrace(int traceId){
+    append(RETIRE).ids[0] = traceId;
+}
+
+AsyncTraceWriter::Record& AsyncTraceWriter::append(unsigned char kind){
+    //Only swap between records so a record is never split across buffers,
+    //which lets the arena go over bufferBytes by one record's strings.
+    //Without a writer thread the full buffer is written out right here.
+    if (fillBuffer->records.size() >= bufferRecords || fillBuffer->strings.size() >= bufferBytes){
+        if (threadStarted) swapBuffers();
+        else drain(fillBuffer);
+    }
+    fillBuffer->records.resize(fillBuffer->records.size()+1);
+    Record &rec = fillBuffer->records.back();
+    rec.kind = kind;
+    return rec;
+}
+
+void AsyncTraceWriter::appendString(const PropertyText &str, size_t &offset, size_t &length){
+    offset = fillBuffer->strings.size();
+    length = str.length;
+    fillBuffer->strings.append(str.data, str.length);
+}
+
+//Numbers and bools are queued as raw bits, strings and blobs in the arena
+unsigned long long AsyncTraceWriter::getValueBits(const PropertyValue &value){
+    unsigned long long bits = 0;
+    if (value.type == PROPERTY_INT) bits = (unsigned long long)value.intValue;
+    else if (value.type == PROPERTY_DOUBLE) memcpy(&bits, &value.doubleValue, sizeof(double));
+    else if (value.type == PROPERTY_BOOL) bits = value.boolValue ? 1 : 0;
+    return bits;
+}
+
+//Rebuilds the value of a PROPERTY or CHANGE record
+PropertyValue AsyncTraceWriter::getPropertyValue(int type, unsigned long long bits, const char *bytes, size_t length){
+    switch (type){
+        case PROPERTY_INT: return PropertyValue((long long)bits);
+        case PROPERTY_DOUBLE: {
+            double value;
+            memcpy(&value, &bits, sizeof(double));
+            return PropertyValue(value);
+        }
+        case PROPERTY_BOOL: return PropertyValue(bits != 0);
+        case PROPERTY_BLOB: return PropertyValue::blob((const unsigned char *)bytes, length);
+        default: return PropertyValue(PropertyText(bytes, length));
+    }
+}
+
+//Hands the fill buffer to the writer thread, waiting for the previous one to drain first
+void AsyncTraceWriter::swapBuffers(){
+    pthread_mutex_lock(&mutex);
+    while (drainPending){
+        pthread_cond_wait(&drainDone, &mutex);
+    }
+    Buffer *tmp = drainBuffer;
+    drainBuffer = fillBuffer;
+    fillBuffer = tmp;
+    drainPending = true;
+    pthread_cond_signal(&drainReady);
+    pthread_mutex_unlock(&mutex);
+}
+
+//Replays a buffer into the target and empties it (keeping its capacity)
+void AsyncTraceWriter::drain(Buffer *buffer){
+    const char *strings = buffer->strings.data();
+    for (size_t i = 0; i < buffer->records.size(); i++){
+        Record &rec = buffer->records[i];
+        switch (rec.kind){
+            case MODULE_BEGIN: target->beginModule(rec.ids[0], string(strings+rec.nameOffset, rec.nameLength)); break;
+            case MODULE_END: target->endModule(); break;
+            case EVENTTYPE_BEGIN: target->beginEventType(rec.ids[0], string(strings+rec.nameOffset, rec.nameLength)); break;
+            case EVENTTYPE_END: target->endEventType(); break;
+            case TRACE_BEGIN: target->beginTrace(rec.ids[0], string(strings+rec.nameOffset, rec.nameLength)); break;
+            case TRACE_END: target->endTrace(); break;
+            case EVENT_BEGIN: target->beginEvent(rec.ids[0], rec.ids[1], rec.ids[2], rec.time); break;
+            case LINK: target->writeLink(rec.ids[0], rec.ids[1], rec.ids[2], rec.time); break;
+            case RETIRE: target->retireTrace(rec.ids[0]); break;
+            case SPAN_BEGIN: {
+                unsigned long long duration = rec.nameOffset | ((unsigned long long)rec.nameLength << 32);
+                target->beginSpan(rec.ids[0], rec.ids[1], rec.ids[2], rec.time, duration);
+                break;
+            }
+            case EVENT_END: target->endEvent(); break;
+            case PROPERTY:
+                target->writeProperty(PropertyText(strings+rec.nameOffset, rec.nameLength),
+                                      getPropertyValue(rec.ids[0], rec.time, strings+rec.valueOffset, rec.valueLength));
+                break;
+            case SIGNAL: target->declareSignal(rec.ids[0], string(strings+rec.nameOffset, rec.nameLength), rec.ids[1]); break;
+            case CHANGE: {
+                unsigned long long bits = rec.nameOffset | ((unsigned long long)rec.nameLength << 32);
+                target->writeChange(rec.ids[0], rec.time, getPropertyValue(rec.ids[1], bits, strings+rec.valueOffset, rec.valueLength));
+                break;
+            }
+        }
+    }
+    buffer->records.clear();
+    buffer->strings.clear();
+}
+
+void AsyncTraceWriter::run(){
+    pthread_mutex_lock(&mutex);
+    while (true){
+        while (!drainPending && !stopping){
+            pthread_cond_wait(&drainReady, &mutex);
+        }
+        if (drainPending){
+            pthread_mutex_unlock(&mutex);
+            drain(drainBuffer);
+            pthread_mutex_lock(&mutex);
+            drainPending = false;
+            pthread_cond_signal(&drainDone);
+        }
+        else if (stopping){
+            break;
+        }
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+void* AsyncTraceWriter::threadEntry(void *arg){
+    ((AsyncTraceWriter *)arg)->run();
+    return 0;
+}
@@ -0,0 +1,465 @@
+/*
+ *  TraceWriter.h
+ *  LPTracer
+ *
+ *  http://www.logicpoet.com
+ *
+ *  Copyright 2008 Logic Poet. All rights reserved.
+ *
+ *  The MIT License
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without
+ *  restriction, including without limitation the rights to use,
+ *  copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following
+ *  conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *  OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _LPT_TRACE_WRITER_H_
+#define _LPT_TRACE_WRITER_H_
+
+#include "systemc.h"
+#include <fstream>
+#include <string>
+#include <map>
+#include <vector>
+#include <pthread.h>
+#include "PropertyList.h"
+#include "IdMap.h"
+#include "TraceFile.h"
+#include "TraceIndex.h"
+#include "TraceFormat.h"
+
+using sc_core::sc_time;
+using std::string;
+using std::map;
+using std::vector;
+
+namespace lpt{
+
+#pragma mark -
+#pragma mark TraceWriter
+    //Base class for the output backends.  The Tracer resolves all ids and hands
+    //the writer already numbered records, so a writer only has to worry about
+    //how they are laid out in the file.  Properties are written between the
+    //begin and end call of the record they belong to.
+    class TraceWriter{
+    public:
+        virtual ~TraceWriter(){}
+        virtual bool open(const string &filename) = 0;
+        virtual void close() = 0;
+        //Writes a sidecar index (filename + ".idx") on close, see TraceIndex.h.
+        //Must be called before open.
+        virtual void setIndexing(unsigned int eventInterval, unsigned int byteInterval) = 0;
+        //Module hierarchy, nested begin/end pairs
+        virtual void beginModule(int id, const string &name) = 0;
+        virtual void endModule() = 0;
+        //Event types, traces and events
+        virtual void beginEventType(int id, const string &name) = 0;
+        virtual void endEventType() = 0;
+        virtual void beginTrace(int id, const string &name) = 0;
+        virtual void endTrace() = 0;
+        //Times are sc_time values in units of the kernel time resolution
+        virtual void beginEvent(int eventTypeId, int traceId, int moduleId, unsigned long long time) = 0;
+        //An event that lasted duration from time, written when it ends.  Closed
+        //with endEvent like any other event.
+        virtual void beginSpan(int eventTypeId, int traceId, int moduleId, unsigned long long time, unsigned long long duration) = 0;
+        virtual void endEvent() = 0;
+        virtual void writeProperty(const PropertyText &name, const PropertyValue &value) = 0;
+        //Waveforms.  A signal is declared once before its first change.  Widths
+        //are in bits, 0 for real and enumerated values.
+        virtual void declareSignal(int id, const string &name, int width) = 0;
+        virtual void writeChange(int signalId, unsigned long long time, const PropertyValue &value) = 0;
+        //Links between traces that were already begun, see TraceLinkKind
+        virtual void writeLink(int kind, int fromTraceId, int toTraceId, unsigned long long time) = 0;
+        //The trace will have no more events or links, and its id may be reused
+        virtual void retireTrace(int traceId) = 0;
+        //Convenience for writing a whole property map or list
+        void writeProperties(const map<string, string> *props){
+            map<string,string>::const_iterator iter;
+            for (iter = props->begin(); iter != props->end(); iter++){
+                writeProperty(iter->first, iter->second);
+            }
+        }
+        void writeProperties(const map<string, StoredProperty> *props){
+            map<string,StoredProperty>::const_iterator iter;
+            for (iter = props->begin(); iter != props->end(); iter++){
+                writeProperty(iter->first, iter->second.getValue());
+            }
+        }
+        void writeProperties(const PropertyList *props){
+            for (unsigned int i = 0; i < props->size(); i++){
+                writeProperty(props->getName(i), props->getValue(i));
+            }
+        }
+    };
+
+#pragma mark -
+#pragma mark XmlTraceWriter
+    //Writes the Scansion XML format (http://www.logicpoet.com/DTD/scansion.dtd)
+    class XmlTraceWriter : public TraceWriter{
+    public:
+        XmlTraceWriter(bool compressed = false);
+        bool open(const string &filename);
+        void close();
+        void setIndexing(unsigned int eventInterval, unsigned int byteInterval);
+        void beginModule(int id, const string &name);
+        void endModule();
+        void beginEventType(int id, const string &name);
+        void endEventType();
+        void beginTrace(int id, const string &name);
+        void endTrace();
+        void beginEvent(int eventTypeId, int traceId, int moduleId, unsigned long long time);
+        void beginSpan(int eventTypeId, int traceId, int moduleId, unsigned long long time, unsigned long long duration);
+        void endEvent();
+        void writeProperty(const PropertyText &name, const PropertyValue &value);
+        void declareSignal(int id, const string &name, int width);
+        void writeChange(int signalId, unsigned long long time, const PropertyValue &value);
+        void writeLink(int kind, int fromTraceId, int toTraceId, unsigned long long time);
+        void retireTrace(int /*traceId*/) {}     //Nothing to record
+    protected:
+        TraceFile outfile;
+        bool compressed;
+        string filename;
+        TraceIndex index;
+        //Numbers and blobs are formatted here when they are written
+        string formatBuffer;
+        //True while an event tag is still open so it can be closed as an empty
+        //element if no properties follow
+        bool eventTagOpen;
+    };
+
+#pragma mark -
+#pragma mark BinaryTraceWriter
+    //Writes the compact binary format.  Ids and times are LEB128 varints and
+    //property names are interned so each name is only written once per file.
+    class BinaryTraceWriter : public TraceWriter{
+    public:
+        BinaryTraceWriter(bool compressed = false);
+        bool open(const string &filename);
+        void close();
+        void setIndexing(unsigned int eventInterval, unsigned int byteInterval);
+        void beginModule(int id, const string &name);
+        void endModule();
+        void beginEventType(int id, const string &name);
+        void endEventType();
+        void beginTrace(int id, const string &name);
+        void endTrace();
+        void beginEvent(int eventTypeId, int traceId, int moduleId, unsigned long long time);
+        void beginSpan(int eventTypeId, int traceId, int moduleId, unsigned long long time, unsigned long long duration);
+        void endEvent();
+        void writeProperty(const PropertyText &name, const PropertyValue &value);
+        void declareSignal(int id, const string &name, int width);
+        void writeChange(int signalId, unsigned long long time, const PropertyValue &value);
+        void writeLink(int kind, int fromTraceId, int toTraceId, unsigned long long time);
+        void retireTrace(int /*traceId*/) {}     //Nothing to record
+    protected:
+        TraceFile outfile;
+        bool compressed;
+        string filename;
+        TraceIndex index;
+        //Property name interning
+        int keyCount;
+        IdMap<string, int> keyIdMap;
+        int getKeyId(const PropertyText &name);
+        //Events are held until we know whether properties follow so that the
+        //short form can be used for events without properties
+        bool eventPending;
+        bool spanPending;
+        unsigned long long pendingEvent[5];     //Spans add their duration
+        void flushPendingEvent(bool withProperties);
+        //Encoding helpers
+        void writeTag(unsigned char tag);
+        void writeVarint(unsigned long long value);
+        void writeString(const PropertyText &str);
+        //Type byte and value of a typed property or change
+        void writeValue(const PropertyValue &value);
+        string valueBuffer;
+    };
+
+#pragma mark -
+#pragma mark FlightRecorderWriter
+    //Fixed sizes of the flight recorder's tables, reserved when it is made.
+    //Whatever does not fit is left out and counted in getSkippedCount().
+    static const size_t FLIGHT_HEADER_BYTES = 1 << 20;      //Modules, event types and signals
+    static const size_t FLIGHT_KEY_BYTES = 64 << 10;        //Property name keys
+    static const unsigned int FLIGHT_KEYS = 4096;
+    static const size_t FLIGHT_KEY_LENGTH = 256;            //Longest property name
+    static const size_t FLIGHT_RECORD_BYTES = 64 << 10;     //One trace, event or change
+
+    //Keeps only the most recent records, encoded in the binary format in a
+    //ring of fixed size allocated up front, and writes them out as a binary
+    //trace on dump() or close().  When the ring is full the oldest traces,
+    //events and changes are dropped.  Modules, event types, signals and
+    //property name keys are kept apart from the ring so every dump has them.
+    //Trace records the ring drops move to a ring of their own, an eighth of
+    //ringBytes, so a dump can still define the traces its events belong to.
+    class FlightRecorderWriter : public TraceWriter{
+    public:
+        FlightRecorderWriter(size_t ringBytes, bool compressed = false);
+        //Nothing is written until the first dump, open only keeps the filename
+        bool open(const string &filename);
+        //Dumps to the filename given to open
+        void close();
+        //Can be called any number of times, the ring is left as it is
+        bool dump(const string &filename);
+        void setIndexing(unsigned int eventInterval, unsigned int byteInterval);
+        void beginModule(int id, const string &name);
+        void endModule();
+        void beginEventType(int id, const string &name);
+        void endEventType();
+        void beginTrace(int id, const string &name);
+        void endTrace();
+        void beginEvent(int eventTypeId, int traceId, int moduleId, unsigned long long time);
+        void beginSpan(int eventTypeId, int traceId, int moduleId, unsigned long long time, unsigned long long duration);
+        void endEvent();
+        void writeProperty(const PropertyText &name, const PropertyValue &value);
+        void declareSignal(int id, const string &name, int width);
+        void writeChange(int signalId, unsigned long long time, const PropertyValue &value);
+        void writeLink(int kind, int fromTraceId, int toTraceId, unsigned long long time);
+        void retireTrace(int /*traceId*/) {}     //Nothing to record
+        //Records dropped from the ring to make room for newer ones
+        unsigned long long getDroppedCount() { return dropped; }
+        //Modules, event types, signals, keys and properties that did not fit
+        unsigned long long getSkippedCount() { return skipped; }
+    protected:
+        //Each record in a ring is a 4 byte length followed by its bytes, and
+        //may wrap around the end.  head is where the oldest record starts.
+        struct Ring{
+            vector<char> bytes;
+            size_t head;
+            size_t used;
+            bool hasRoom(size_t size) { return bytes.size() - used >= size + 4; }
+            //Copies a record in, there must be room for it
+            void push(const char *data, size_t size);
+            //Moves the oldest record out to record, returning its size
+            size_t pop(vector<char> &record);
+            void dropOldest();
+            size_t lengthAt(size_t pos);
+            //Copies the record at pos to record and moves pos to the next one
+            size_t read(size_t &pos, vector<char> &record);
+            void copyIn(size_t pos, const char *data, size_t length);
+            void copyOut(size_t pos, char *data, size_t length);
+        };
+        string filename;
+        bool compressed;
+        bool closed;
+        //Records that every dump starts with
+        string header;
+        string keys;
+        int keyCount;
+        IdMap<string, int> keyIdMap;
+        string keyBuffer;
+        int getKeyId(const PropertyText &name);
+        Ring ring;
+        //Trace records the ring dropped, for dumps whose events still use them
+        Ring traces;
+        vector<char> evicted;
+        unsigned long long dropped;
+        unsigned long long skipped;
+        //Nesting depth of modules being left out, and whether the current
+        //event type is
+        int skippedModules;
+        bool skippedEventType;
+        //Counts something left out, warning the first time
+        void skip();
+        //Whether bytes more fit in buffer within limit, counting a skip if not
+        bool fits(const string &buffer, size_t limit, size_t bytes);
+        //The record being built, copied into the ring when it ends.  Properties
+        //go to current, which is the header while inside an event type.
+        string record;
+        string *current;
+        bool shortEvent;
+        void commit();
+    };
+
+#pragma mark -
+#pragma mark ChromeTraceWriter
+    //Traces the Chrome writer keeps state for at once.  Trace ids are handed
+    //out in order, so a trace only loses its state once this many later
+    //traces have started.
+    static const unsigned int CHROME_TRACE_SLOTS = 16384;
+
+    //Writes Chrome Trace Event JSON for chrome://tracing and ui.perfetto.dev.
+    //Each top level module becomes a process and every module a thread in it,
+    //events are zero length slices, and the events of a trace are chained with
+    //flow arrows.  Records are written as they arrive; the only state kept is
+    //the module and event type names and a fixed table of live traces.
+    //The file is always plain text, compression and indexing are ignored.
+    class ChromeTraceWriter : public TraceWriter{
+    public:
+        ChromeTraceWriter();
+        bool open(const string &filename);
+        void close();
+        void setIndexing(unsigned int eventInterval, unsigned int byteInterval);
+        void beginModule(int id, const string &name);
+        void endModule();
+        void beginEventType(int id, const string &name);
+        void endEventType();
+        void beginTrace(int id, const string &name);
+        void endTrace();
+        void beginEvent(int eventTypeId, int traceId, int moduleId, unsigned long long time);
+        void beginSpan(int eventTypeId, int traceId, int moduleId, unsigned long long time, unsigned long long duration);
+        void endEvent();
+        void writeProperty(const PropertyText &name, const PropertyValue &value);
+        void declareSignal(int id, const string &name, int width);
+        void writeChange(int signalId, unsigned long long time, const PropertyValue &value);
+        void writeLink(int kind, int fromTraceId, int toTraceId, unsigned long long time);
+        void retireTrace(int traceId);
+    protected:
+        enum RecordKind { IN_NONE, IN_EVENTTYPE, IN_TRACE, IN_EVENT };
+        TraceFile outfile;
+        RecordKind current;
+        //Timestamps are in microseconds.  Ticks are divided by 10^timeDigits with
+        //the remainder as the fraction, or multiplied for resolutions above 1us.
+        int timeDigits;
+        unsigned long long timeScale;
+        //Module hierarchy: full names of the open modules, and the process
+        //(top level module) of every module by id
+        vector<string> modulePath;
+        vector<int> processIds;
+        int processId;
+        vector<string> eventTypeNames;
+        vector<string> signalNames;
+        //Live traces.  Trace properties are shown on the first event of the
+        //trace, so they are held as JSON members until then, and after that the
+        //last event is kept to start the flow arrow to the next one.  The table
+        //has CHROME_TRACE_SLOTS entries indexed by trace id, and an entry is
+        //dropped when its trace is retired or a later trace takes its slot, so
+        //traces that are never retired don't make it grow.
+        struct TraceState{
+            int id;             //0 for a free slot
+            string properties;
+            bool marked;
+            unsigned long long lastTime;
+            int lastProcess, lastThread;
+        };
+        vector<TraceState> traces;
+        string *traceMembers;
+        //Members of the event being written, as the record is built in one
+        //string, and the flow finish that binds it to the previous event
+        string eventBuffer;
+        string flowEnd;
+        unsigned long long flowCount;
+        bool firstRecord;
+        void beginRecord();
+        void appendTime(string &out, unsigned long long time);
+        void appendFlow(string &out, char phase, unsigned long long time, int processId, int threadId);
+        TraceState* findTrace(int id){
+            TraceState &state = traces[(unsigned int)id % traces.size()];
+            return state.id == id ? &state : 0;
+        }
+    };
+
+#pragma mark -
+#pragma mark AsyncTraceWriter
+    //Wraps another writer and moves all of its work onto a background thread.
+    //The simulation thread only appends fixed size records (strings go into a
+    //shared arena) to the fill buffer.  When it holds bufferRecords records or
+    //its arena bufferBytes bytes the buffers are swapped and the writer thread
+    //replays the records into the wrapped writer.
+    class AsyncTraceWriter : public TraceWriter{
+    public:
+        AsyncTraceWriter(TraceWriter *target, unsigned int bufferRecords = 65536, size_t bufferBytes = 4 << 20);
+        ~AsyncTraceWriter();
+        bool open(const string &filename);
+        void close();
+        void setIndexing(unsigned int eventInterval, unsigned int byteInterval);
+        void beginModule(int id, const string &name);
+        void endModule();
+        void beginEventType(int id, const string &name);
+        void endEventType();
+        void beginTrace(int id, const string &name);
+        void endTrace();
+        void beginEvent(int eventTypeId, int traceId, int moduleId, unsigned long long time);
+        void beginSpan(int eventTypeId, int traceId, int moduleId, unsigned long long time, unsigned long long duration);
+        void endEvent();
+        void writeProperty(const PropertyText &name, const PropertyValue &value);
+        void declareSignal(int id, const string &name, int width);
+        void writeChange(int signalId, unsigned long long time, const PropertyValue &value);
+        void writeLink(int kind, int fromTraceId, int toTraceId, unsigned long long time);
+        void retireTrace(int traceId);
+    protected:
+        enum RecordKind { MODULE_BEGIN, MODULE_END, EVENTTYPE_BEGIN, EVENTTYPE_END,
+                          TRACE_BEGIN, TRACE_END, EVENT_BEGIN, EVENT_END, PROPERTY,
+                          SIGNAL, CHANGE, SPAN_BEGIN, LINK, RETIRE };
+        struct Record{
+            unsigned char kind;
+            int ids[3];             //For properties ids[0] is the PropertyType, for changes ids[1], for links the kind
+            unsigned long long time;    //For properties the raw bits of the value
+            //Offsets and lengths into the buffer's string arena.  Changes keep the
+            //raw bits of their value in nameOffset and nameLength, spans their
+            //duration.
+            size_t nameOffset, nameLength;
+            size_t valueOffset, valueLength;
+        };
+        struct Buffer{
+            vector<Record> records;
+            string strings;
+        };
+        TraceWriter *target;
+        unsigned int bufferRecords;
+        size_t bufferBytes;
+        Buffer buffers[2];
+        Buffer *fillBuffer;         //Owned by the simulation thread
+        Buffer *drainBuffer;        //Owned by the writer thread while draining
+        bool drainPending;
+        bool stopping;
+        bool threadStarted;
+        bool closed;
+        pthread_t thread;
+        pthread_mutex_t mutex;
+        pthread_cond_t drainReady;
+        pthread_cond_t drainDone;
+        Record& append(unsigned char kind);
+        void appendString(const PropertyText &str, size_t &offset, size_t &length);
+        static unsigned long long getValueBits(const PropertyValue &value);
+        static PropertyValue getPropertyValue(int type, unsigned long long bits, const char *bytes, size_t length);
+        void swapBuffers();
+        void drain(Buffer *buffer);
+        void run();
+        static void* threadEntry(void *arg);
+    };
+
+#pragma mark -
+#pragma mark NullTraceWriter
+    //Writes nothing, for a Tracer that only keeps statistics
+    class NullTraceWriter : public TraceWriter{
+    public:
+        bool open(const string &/*filename*/) { return true; }
+        void close() {}
+        void setIndexing(unsigned int /*eventInterval*/, unsigned int /*byteInterval*/) {}
+        void beginModule(int /*id*/, const string &/*name*/) {}
+        void endModule() {}
+        void beginEventType(int /*id*/, const string &/*name*/) {}
+        void endEventType() {}
+        void beginTrace(int /*id*/, const string &/*name*/) {}
+        void endTrace() {}
+        void beginEvent(int /*eventTypeId*/, int /*traceId*/, int /*moduleId*/, unsigned long long /*time*/) {}
+        void beginSpan(int /*eventTypeId*/, int /*traceId*/, int /*moduleId*/, unsigned long long /*time*/, unsigned long long /*duration*/) {}
+        void endEvent() {}
+        void writeProperty(const PropertyText &/*name*/, const PropertyValue &/*value*/) {}
+        void declareSignal(int /*id*/, const string &/*name*/, int /*width*/) {}
+        void writeChange(int /*signalId*/, unsigned long long /*time*/, const PropertyValue &/*value*/) {}
+        void writeLink(int /*kind*/, int /*fromTraceId*/, int /*toTraceId*/, unsigned long long /*time*/) {}
+        void retireTrace(int /*traceId*/) {}
+    };
+
+} //namespace lpt
+
+#endif
@@ -33,6 +33,12 @@
 
 #include "Tracer.h"
 #include <iomanip>
+#include <csignal>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
 
 using namespace lpt;
 
@@ -47,11 +53,50 @@ Tracer* Tracer::getSharedTracer(){
     return &inst;
 }
 
+bool Tracer::enabled = true;
+
+void Tracer::setEnabled(bool enabled){
+    Tracer::enabled = enabled;
+}
+
+bool Tracer::isEnabled(){
+    return enabled;
+}
+
+int Tracer::level = LPTRACE_LEVEL_DEBUG;
+
+void Tracer::setLevel(int level){
+    Tracer::level = level;
+}
+
+int Tracer::getLevel(){
+    return level;
+}
+
 Tracer::Tracer(){
     traceCount = 0;
     moduleCount = 0;
     eventTypeCount = 0;
     initComplete = false;
+    format = XML_FORMAT;
+    async = false;
+    compressed = false;
+    indexing = false;
+    indexEventInterval = 1024;
+    indexByteInterval = 1 << 20;
+    writer = 0;
+    dataCapture = CAPTURE_FULL;
+    dataCaptureLimit = 0;
+    fileOutput = true;
+    pairsDropped = 0;
+    signalCount = 0;
+    signalsRegistered = false;
+    flightRecorderBytes = 0;
+    flightRecorder = 0;
+    sampleRate = 1;
+    sampleMode = SAMPLE_HASHED;
+    sampleSeed = 0;
+    sampleCandidates = 0;
     this->filename = "tracefile.scnx";
 }
 
@@ -60,43 +105,103 @@ Tracer::Tracer(char *filename){
     moduleCount = 0;
     eventTypeCount = 0;
     initComplete = false;
-    this->filename = filename;
+    format = XML_FORMAT;
+    async = false;
+    compressed = false;
+    indexing = false;
+    indexEventInterval = 1024;
+    indexByteInterval = 1 << 20;
+    writer = 0;
+    dataCapture = CAPTURE_FULL;
+    dataCaptureLimit = 0;
+    fileOutput = true;
+    pairsDropped = 0;
+    signalCount = 0;
+    signalsRegistered = false;
+    flightRecorderBytes = 0;
+    flightRecorder = 0;
+    sampleRate = 1;
+    sampleMode = SAMPLE_HASHED;
+    sampleSeed = 0;
+    sampleCandidates = 0;
+    setFilename(filename);
 }
 
 Tracer::~Tracer(){
-    if (outfile){
-        outfile << "</document>\n";
-        outfile.flush();
-        outfile.close();
+    if (!pairs.empty()) writeStatistics(cout);
+    if (flightRecorder){
+        vector<Tracer *> &recorders = flightRecorders();
+        recorders.erase(std::remove(recorders.begin(), recorders.end(), this), recorders.end());
+    }
+    if (writer){
+        writer->close();
+        delete writer;
     }
 }
 
 //This initializes the file.  Gets called the first time an event is marked to ensure elaboration has completed.
 void Tracer::initialize(){
-    outfile.open(filename.c_str());
-    if (!outfile){
+    loadFilterEnvironment();
+    if (!fileOutput){
+        writer = new NullTraceWriter();
+        registerAllModules();
+        initComplete = true;
+        return;
+    }
+    if (flightRecorderBytes){
+        //Recording only copies into memory, so there is nothing to index or
+        //move to another thread
+        flightRecorder = new FlightRecorderWriter(flightRecorderBytes, compressed);
+        writer = flightRecorder;
+        flightRecorders().push_back(this);
+    }
+    else {
+        switch (format){
+            case BINARY_FORMAT: writer = new BinaryTraceWriter(compressed); break;
+            case CHROME_FORMAT: writer = new ChromeTraceWriter(); break;
+            default: writer = new XmlTraceWriter(compressed); break;
+        }
+        if (indexing) writer->setIndexing(indexEventInterval, indexByteInterval);
+        if (async) writer = new AsyncTraceWriter(writer);
+    }
+    if (!writer->open(filename)){
         cout << "***Tracer Error*** Cannot Open Trace File : " << filename << endl;
         sc_stop();
     }
-    outfile << "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n";
-    outfile << "<!DOCTYPE document PUBLIC \"-//LOGICPOET//DTD Scansion Tracefile version 0.7//EN\"\n";
-    outfile << "\"http://www.logicpoet.com/DTD/scansion.dtd\" >\n";
-    outfile << "<document>\n";
     registerAllModules();
     initComplete = true;
 }
 
 #pragma mark -
-#pragma mark Filename Accessors
+#pragma mark Filename & Output Format Accessors
+string Tracer::getExtension(OutputFormat format){
+    switch (format){
+        case BINARY_FORMAT: return ".scnb";
+        case CHROME_FORMAT: return ".json";
+        default: return ".scnx";
+    }
+}
+
 void Tracer::setFilename(string filename){
-    if (!initialized){
+    if (!initComplete){
+        //A known extension selects its format, except that a flight recorder
+        //always dumps binary
+        OutputFormat formats[] = {XML_FORMAT, BINARY_FORMAT, CHROME_FORMAT};
+        for (int i = 0; i < 3 && !flightRecorderBytes; i++){
+            string formatExtension = getExtension(formats[i]);
+            if (filename.size() > formatExtension.size() && 
+                filename.compare(filename.size()-formatExtension.size(), formatExtension.size(), formatExtension) == 0){
+                format = formats[i];
+            }
+        }
         //First check to make sure that an extension was set and add one if it is missing
-        int pos = filename.find(".scnx");
+        string extension = getExtension(format);
+        string::size_type pos = filename.rfind(extension);
         bool addExtension = false;
         if (pos == string::npos) addExtension = true; //No extension found
-        if (pos != filename.size()-5) addExtension = true;  //Found it,but not in the right spot, so add another one        
+        else if (pos != filename.size()-extension.size()) addExtension = true;  //Found it,but not in the right spot, so add another one        
         this->filename = filename;
-        if (addExtension) this->filename += ".scnx";
+        if (addExtension) this->filename += extension;
     }
     else {
         cout << "***Tracer Warning*** Attempted to assign filename " << filename << "after trace recording has started\n.";
@@ -113,44 +218,370 @@ string Tracer::getFilename(){
 string Tracer::getSharedFilename(){
     return getSharedTracer()->getFilename();
 }
+void Tracer::setOutputFormat(OutputFormat format){
+    if (!initComplete){
+        //Swap the extension on the current filename to match the new format
+        string oldExtension = getExtension(this->format);
+        if (filename.size() >= oldExtension.size() &&
+            filename.compare(filename.size()-oldExtension.size(), oldExtension.size(), oldExtension) == 0){
+            filename.erase(filename.size()-oldExtension.size());
+        }
+        this->format = format;
+        filename += getExtension(format);
+    }
+    else {
+        cout << "***Tracer Warning*** Attempted to change the output format after trace recording has started.\n";
+        cout << "Ignoring new format.  File recorded to: " << this->filename << endl;
+    }
+}
+void Tracer::setSharedOutputFormat(OutputFormat format){
+    getSharedTracer()->setOutputFormat(format);
+}
+OutputFormat Tracer::getOutputFormat(){
+    return format;
+}
+void Tracer::setAsync(bool async){
+    if (!initComplete){
+        this->async = async;
+    }
+    else {
+        cout << "***Tracer Warning*** Attempted to change asynchronous mode after trace recording has started.\n";
+    }
+}
+void Tracer::setSharedAsync(bool async){
+    getSharedTracer()->setAsync(async);
+}
+bool Tracer::getAsync(){
+    return async;
+}
+void Tracer::setCompression(bool compressed){
+    if (initComplete){
+        cout << "***Tracer Warning*** Attempted to change compression after trace recording has started.\n";
+    }
+    else if (compressed && !TraceFile::compressionAvailable()){
+        cout << "***Tracer Warning*** Compression requested but the Tracer was built without LPTRACE_ZLIB.  Writing uncompressed.\n";
+    }
+    else {
+        this->compressed = compressed;
+    }
+}
+void Tracer::setSharedCompression(bool compressed){
+    getSharedTracer()->setCompression(compressed);
+}
+bool Tracer::getCompression(){
+    return compressed;
+}
+void Tracer::setIndexing(bool index, unsigned int eventInterval, unsigned int byteInterval){
+    if (!initComplete){
+        indexing = index;
+        indexEventInterval = eventInterval;
+        indexByteInterval = byteInterval;
+    }
+    else {
+        cout << "***Tracer Warning*** Attempted to change indexing after trace recording has started.\n";
+    }
+}
+void Tracer::setSharedIndexing(bool index, unsigned int eventInterval, unsigned int byteInterval){
+    getSharedTracer()->setIndexing(index, eventInterval, byteInterval);
+}
+bool Tracer::getIndexing(){
+    return indexing;
+}
+
+#pragma mark -
+#pragma mark Trace Sampling
+void Tracer::setSampling(unsigned int rate, SampleMode mode, unsigned int seed){
+    sampleRate = rate ? rate : 1;
+    sampleMode = mode;
+    sampleSeed = seed;
+}
+void Tracer::setSharedSampling(unsigned int rate, SampleMode mode, unsigned int seed){
+    getSharedTracer()->setSampling(rate, mode, seed);
+}
+unsigned int Tracer::getSampling(){
+    return sampleRate;
+}
+
+//Called once for every new trace, true if it is recorded
+bool Tracer::sampleTrace(){
+    if (sampleRate == 1) return true;
+    unsigned long long n = sampleCandidates++;
+    if (sampleMode == SAMPLE_EVERY_NTH) return n % sampleRate == 0;
+    //splitmix64 finalizer, well mixed even for consecutive n
+    n += (sampleSeed + 1) * 0x9E3779B97F4A7C15ULL;
+    n = (n ^ (n >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    n = (n ^ (n >> 27)) * 0x94D049BB133111EBULL;
+    n ^= n >> 31;
+    return n % sampleRate == 0;
+}
+
+#pragma mark -
+#pragma mark Flight Recorder
+void Tracer::setFlightRecorder(size_t ringBytes){
+    if (!initComplete){
+        flightRecorderBytes = ringBytes;
+        if (ringBytes) setOutputFormat(BINARY_FORMAT);
+    }
+    else {
+        cout << "***Tracer Warning*** Attempted to change flight recorder mode after trace recording has started.\n";
+    }
+}
+void Tracer::setSharedFlightRecorder(size_t ringBytes){
+    getSharedTracer()->setFlightRecorder(ringBytes);
+}
+size_t Tracer::getFlightRecorder(){
+    return flightRecorderBytes;
+}
+
+bool Tracer::dumpFlightRecorder(string filename){
+    if (!flightRecorder){
+        cout << "***Tracer Warning*** Nothing to dump, the Tracer is not recording in flight recorder mode." << endl;
+        return false;
+    }
+    if (filename == "") filename = this->filename;
+    if (!flightRecorder->dump(filename)){
+        cout << "***Tracer Error*** Cannot Open Trace File : " << filename << endl;
+        return false;
+    }
+    return true;
+}
+bool Tracer::dumpSharedFlightRecorder(string filename){
+    return getSharedTracer()->dumpFlightRecorder(filename);
+}
+
+//Tracers currently recording in flight recorder mode, for the signal handler
+vector<Tracer *>& Tracer::flightRecorders(){
+    static vector<Tracer *> recorders;
+    return recorders;
+}
+
+void Tracer::flightRecorderSignalHandler(int signalNumber){
+    //Put the default action back first so a fault while dumping ends the program
+    signal(signalNumber, SIG_DFL);
+    vector<Tracer *> &recorders = flightRecorders();
+    for (size_t i = 0; i < recorders.size(); i++){
+        recorders[i]->dumpFlightRecorder();
+    }
+    raise(signalNumber);
+}
+
+void Tracer::installFlightRecorderSignalHandlers(){
+    int signals[] = {SIGABRT, SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGINT, SIGTERM};
+    for (size_t i = 0; i < sizeof(signals)/sizeof(signals[0]); i++){
+        signal(signals[i], flightRecorderSignalHandler);
+    }
+}
+
+#pragma mark -
+#pragma mark Payload Data Capture
+//Unlike the format this can be changed at any time, it applies from the next event on
+void Tracer::setDataCapture(DataCapture capture, unsigned int limit){
+    if (capture == CAPTURE_DEFAULT) capture = CAPTURE_FULL;
+    dataCapture = capture;
+    dataCaptureLimit = limit;
+}
+void Tracer::setSharedDataCapture(DataCapture capture, unsigned int limit){
+    getSharedTracer()->setDataCapture(capture, limit);
+}
+
+#pragma mark -
+#pragma mark Latency Statistics
+//Traces with a latency pair open at once before the oldest is dropped
+static const unsigned int PAIR_LIVE_TRACES = 1 << 16;
+
+void Tracer::addLatencyPair(EventTypeHandle start, EventTypeHandle end, string name){
+    EventType *startType = EventType::fromHandle(start);
+    EventType *endType = EventType::fromHandle(end);
+    if (!startType || !endType){
+        cout << "***Tracer Error*** Latency pair " << name << " uses an event type handle that was never declared." << endl;
+        return;
+    }
+    addLatencyPair(startType->getFullName(), endType->getFullName(), name);
+}
+
+//Event types are matched by full name, so a pair applies however its event
+//types are marked
+void Tracer::addLatencyPair(string start, string end, string name){
+    LatencyPair pair;
+    pair.name = (name != "") ? name : start + " -> " + end;
+    pair.start = start;
+    pair.end = end;
+    pairs.push_back(pair);
+    //Open pairs are laid out per pair, so start the ring over
+    pairTraceIds.clear();
+    pairStarts.clear();
+    pairGroupIds.resize(pairs.size());
+    for (size_t id = 1; id < eventTypesById.size(); id++){
+        findLatencyPairRoles((int)id);
+    }
+}
+
+void Tracer::addSharedLatencyPair(EventTypeHandle start, EventTypeHandle end, string name){
+    getSharedTracer()->addLatencyPair(start, end, name);
+}
+void Tracer::addSharedLatencyPair(string start, string end, string name){
+    getSharedTracer()->addLatencyPair(start, end, name);
+}
+
+void Tracer::setFileOutput(bool output){
+    if (!initComplete){
+        fileOutput = output;
+    }
+    else {
+        cout << "***Tracer Warning*** File output cannot be changed after the first event is marked." << endl;
+    }
+}
+void Tracer::setSharedFileOutput(bool output){
+    getSharedTracer()->setFileOutput(output);
+}
+bool Tracer::getFileOutput(){
+    return fileOutput;
+}
+
+void Tracer::findLatencyPairRoles(int eventTypeId){
+    if (pairRoles.size() <= (size_t)eventTypeId) pairRoles.resize(eventTypeId+1);
+    vector<LatencyPairRole> &roles = pairRoles[eventTypeId];
+    roles.clear();
+    EventType *eType = ((size_t)eventTypeId < eventTypesById.size()) ? eventTypesById[eventTypeId] : 0;
+    if (!eType) return;
+    string name = eType->getFullName();
+    //Ends go first so an event type that ends a pair can also start the next one
+    for (size_t i = 0; i < pairs.size(); i++){
+        if (pairs[i].end != name) continue;
+        LatencyPairRole role = {(int)i, true};
+        roles.push_back(role);
+    }
+    for (size_t i = 0; i < pairs.size(); i++){
+        if (pairs[i].start != name) continue;
+        LatencyPairRole role = {(int)i, false};
+        roles.push_back(role);
+    }
+}
+
+void Tracer::recordLatencyPairs(int traceId, int moduleId, int eventTypeId, unsigned long long time){
+    if ((size_t)eventTypeId >= pairRoles.size()) return;
+    const vector<LatencyPairRole> &roles = pairRoles[eventTypeId];
+    if (roles.empty()) return;
+    if (pairTraceIds.empty()){
+        pairTraceIds.resize(PAIR_LIVE_TRACES, 0);
+        LatencyPairStart closed = {0, 0};
+        pairStarts.resize(PAIR_LIVE_TRACES * pairs.size(), closed);
+    }
+    size_t slot = (size_t)traceId % PAIR_LIVE_TRACES;
+    LatencyPairStart *starts = &pairStarts[slot * pairs.size()];
+    if (pairTraceIds[slot] != traceId){
+        //A trace too old to still be in the ring
+        if (pairTraceIds[slot] > traceId) return;
+        for (size_t i = 0; i < pairs.size(); i++){
+            if (starts[i].time) pairsDropped++;
+            starts[i].time = 0;
+        }
+        pairTraceIds[slot] = traceId;
+    }
+    for (size_t i = 0; i < roles.size(); i++){
+        LatencyPairStart &start = starts[roles[i].pair];
+        if (roles[i].end){
+            if (!start.time) continue;
+            unsigned long long startTime = start.time - 1;
+            recordLatency(roles[i].pair, start.moduleId, moduleId, (time > startTime) ? time - startTime : 0);
+            start.time = 0;
+        }
+        else if (!start.time){
+            start.time = time + 1;
+            start.moduleId = moduleId;
+        }
+    }
+}
+
+void Tracer::recordLatency(int pair, int startModuleId, int endModuleId, unsigned long long latency){
+    //Module ids are all known by the first event, so a dense table works
+    vector<int> &groupIds = pairGroupIds[pair];
+    size_t modules = moduleCount + 1;
+    if (groupIds.empty()) groupIds.resize(modules * modules, -1);
+    int &group = groupIds[startModuleId * modules + endModuleId];
+    if (group < 0){
+        group = (int)pairGroups.size();
+        pairGroups.push_back(LatencyPairGroup());
+        pairGroups.back().pair = pair;
+        pairGroups.back().startModuleId = startModuleId;
+        pairGroups.back().endModuleId = endModuleId;
+    }
+    pairGroups[group].histogram.record(latency);
+}
+
+//One table per pair, with times in nanoseconds
+void Tracer::writeStatistics(std::ostream &out){
+    double scale = sc_core::sc_get_time_resolution().to_seconds() * 1e9;
+    for (size_t pair = 0; pair < pairs.size(); pair++){
+        out << "Latency of " << pairs[pair].name << " (ns)" << endl;
+        out << std::left << std::setw(50) << "  start module -> end module" << std::right;
+        const char *columns[] = {"count", "min", "mean", "p50", "p90", "p99", "max", 0};
+        for (int c = 0; columns[c]; c++) out << std::setw(12) << columns[c];
+        out << endl;
+        for (size_t i = 0; i < pairGroups.size(); i++){
+            if (pairGroups[i].pair != (int)pair) continue;
+            const LatencyHistogram &histogram = pairGroups[i].histogram;
+            sc_module *startModule = modulesById[pairGroups[i].startModuleId];
+            sc_module *endModule = modulesById[pairGroups[i].endModuleId];
+            string modules = string(startModule ? startModule->name() : "?") + " -> " + (endModule ? endModule->name() : "?");
+            out << "  " << std::left << std::setw(48) << modules << std::right;
+            out << std::setw(12) << histogram.getCount();
+            out << std::setw(12) << histogram.getMin() * scale;
+            out << std::setw(12) << histogram.getMean() * scale;
+            out << std::setw(12) << histogram.getPercentile(50) * scale;
+            out << std::setw(12) << histogram.getPercentile(90) * scale;
+            out << std::setw(12) << histogram.getPercentile(99) * scale;
+            out << std::setw(12) << histogram.getMax() * scale << endl;
+        }
+    }
+    if (pairsDropped) out << pairsDropped << " latency pairs were dropped, more than " << PAIR_LIVE_TRACES << " traces had pairs open" << endl;
+}
 
 #pragma mark -
 #pragma mark Module Methods
 void Tracer::registerAllModules(){
+    moduleEnabled.assign(1, true);  //Id 0 is returned for unregistered modules
     sc_simcontext* context = sc_core::sc_get_curr_simcontext();
     sc_object* obj = context->first_object();
     while (obj){
         //Find the top level modules to start things off
         if (!obj->get_parent()){
-            if (obj->kind() == "sc_module"){
-                registerModule(obj);
+            if (strcmp(obj->kind(), "sc_module") == 0){
+                registerModule(obj, moduleFilter.includes.empty());
             }         
         }
         obj = context->next_object();
     }
 }
 
-void Tracer::registerModule(sc_object* mod){
+void Tracer::registerModule(sc_object* mod, bool parentEnabled){
     int index = ++moduleCount;
     //Start the module definition
-    outfile << "<module id=\"M" << index << "\" name=\"" << mod->basename() << "\">\n";
-    moduleIdMap.insert(std::pair<sc_module*, int>((sc_module *)mod, index));
+    writer->beginModule(index, mod->basename());
+    moduleIdMap.insert((sc_module *)mod, index);
+    if (modulesById.size() <= (size_t)index) modulesById.resize(index+1, 0);
+    modulesById[index] = (sc_module *)mod;
+    //Filtered modules are still written so the hierarchy stays whole
+    int match = moduleFilter.match(mod->name());
+    bool enabled = match ? match > 0 : parentEnabled;
+    if (moduleEnabled.size() <= (size_t)index) moduleEnabled.resize(index+1, true);
+    moduleEnabled[index] = enabled;
     //Register the child modules if they exist
     vector<sc_object*> children = ((sc_module *)mod)->get_child_objects();
-    for(int i = 0; i < children.size(); i++){
-        if (children[i]->kind() == "sc_module"){
-            registerModule(children[i]);
+    for(size_t i = 0; i < children.size(); i++){
+        if (strcmp(children[i]->kind(), "sc_module") == 0){
+            registerModule(children[i], enabled);
         } 
     }
     //End the module
-    outfile << "</module>\n";
+    writer->endModule();
 }
 
 
 int Tracer::getModuleId(sc_module* module){
-    map<sc_module *, int>::iterator iter = moduleIdMap.find(module);
-    if (iter != moduleIdMap.end()){
-        return iter->second;
+    int *id = moduleIdMap.find(module);
+    if (id){
+        return *id;
     } else {
         cout << "***Tracer Error*** Module " << module->name() << " is not registered.";
         sc_stop();
@@ -158,20 +589,141 @@ int Tracer::getModuleId(sc_module* module){
     }
 }
 
+#pragma mark -
+#pragma mark Filters
+//Glob match with * and ?, backtracking to the last * on a mismatch
+static bool globMatch(const char *pattern, const char *name){
+    const char *star = 0, *resume = 0;
+    while (*name){
+        if (*pattern == '*'){
+            star = pattern++;
+            resume = name;
+        }
+        else if (*pattern == '?' || *pattern == *name){
+            pattern++;
+            name++;
+        }
+        else if (star){
+            pattern = star + 1;
+            name = ++resume;
+        }
+        else {
+            return false;
+        }
+    }
+    while (*pattern == '*') pattern++;
+    return *pattern == 0;
+}
+
+void Tracer::NameFilter::add(const string &pattern){
+    if (pattern.empty()) return;
+    if (pattern[0] == '!') excludes.push_back(pattern.substr(1));
+    else includes.push_back(pattern);
+}
+
+//Excludes win over includes so "top.bus*" with "!top.bus.arbiter" works in any order
+int Tracer::NameFilter::match(const string &name) const {
+    for (size_t i = 0; i < excludes.size(); i++){
+        if (globMatch(excludes[i].c_str(), name.c_str())) return -1;
+    }
+    for (size_t i = 0; i < includes.size(); i++){
+        if (globMatch(includes[i].c_str(), name.c_str())) return 1;
+    }
+    return 0;
+}
+
+void Tracer::addModuleFilter(string pattern){
+    if (initComplete){
+        cout << "***Tracer Warning*** Attempted to add a module filter after trace recording has started.\n";
+        return;
+    }
+    moduleFilter.add(pattern);
+}
+void Tracer::addEventTypeFilter(string pattern){
+    if (initComplete){
+        cout << "***Tracer Warning*** Attempted to add an event type filter after trace recording has started.\n";
+        return;
+    }
+    eventTypeFilter.add(pattern);
+}
+void Tracer::addSharedModuleFilter(string pattern){
+    getSharedTracer()->addModuleFilter(pattern);
+}
+void Tracer::addSharedEventTypeFilter(string pattern){
+    getSharedTracer()->addEventTypeFilter(pattern);
+}
+
+bool Tracer::loadFilterFile(string filename){
+    std::ifstream file(filename.c_str());
+    if (!file){
+        cout << "***Tracer Error*** Cannot Open Filter File : " << filename << endl;
+        return false;
+    }
+    string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)){
+        lineNumber++;
+        size_t comment = line.find('#');
+        if (comment != string::npos) line.erase(comment);
+        std::istringstream words(line);
+        string kind, pattern;
+        if (!(words >> kind)) continue;
+        words >> pattern;
+        if (kind == "module" && !pattern.empty()) addModuleFilter(pattern);
+        else if (kind == "eventtype" && !pattern.empty()) addEventTypeFilter(pattern);
+        else cout << "***Tracer Warning*** " << filename << ":" << lineNumber << ": expected \"module <pattern>\" or \"eventtype <pattern>\".\n";
+    }
+    return true;
+}
+bool Tracer::loadSharedFilterFile(string filename){
+    return getSharedTracer()->loadFilterFile(filename);
+}
+
+void Tracer::addFilterList(NameFilter &filter, const char *patterns){
+    string list(patterns);
+    size_t start = 0;
+    while (start <= list.size()){
+        size_t end = list.find(',', start);
+        if (end == string::npos) end = list.size();
+        string pattern = list.substr(start, end - start);
+        size_t first = pattern.find_first_not_of(" \t");
+        size_t last = pattern.find_last_not_of(" \t");
+        if (first != string::npos) filter.add(pattern.substr(first, last - first + 1));
+        start = end + 1;
+    }
+}
+
+//Called from initialize(), so the environment adds to filters set in code
+void Tracer::loadFilterEnvironment(){
+    const char *value = getenv("LPTRACE_FILTER_FILE");
+    if (value && *value) loadFilterFile(value);
+    value = getenv("LPTRACE_MODULES");
+    if (value) addFilterList(moduleFilter, value);
+    value = getenv("LPTRACE_EVENTTYPES");
+    if (value) addFilterList(eventTypeFilter, value);
+}
+
 #pragma mark -
 #pragma mark Event Type Methods
 int Tracer::registerEventType(EventType * eType){
     int index = ++eventTypeCount;
-    outfile << "<eventtype id=\"E" << index << "\" name=\"" << eType->getName() << "\">\n";
-    writeProperties(eType->getProperties());
-    outfile << "</eventtype>\n";
-    eventTypeIdMap[eType] = index;
-    strEventTypeMap[eType->getFullName()] = eType;
+    writer->beginEventType(index, eType->getName());
+    writer->writeProperties(eType->getTypedProperties());
+    writer->endEventType();
+    eventTypeIdMap.insert(eType, index);
+    if (eventTypesById.size() <= (size_t)index) eventTypesById.resize(index+1, 0);
+    eventTypesById[index] = eType;
+    int match = eventTypeFilter.match(eType->getFullName());
+    if (eventTypeEnabled.size() <= (size_t)index) eventTypeEnabled.resize(index+1, true);
+    eventTypeEnabled[index] = match ? match > 0 : eventTypeFilter.includes.empty();
+    if (!pairs.empty()) findLatencyPairRoles(index);
+    strEventTypeMap.insert(eType->getFullName(), eType);
     return index;
 }
 
 EventType* Tracer::getStrEventType(string name){
-    EventType* et = strEventTypeMap[name];
+    EventType** found = strEventTypeMap.find(name);
+    EventType* et = found ? *found : 0;
     if (et == 0){
         et = new EventType(name);
         registerEventType(et);
@@ -179,10 +731,30 @@ EventType* Tracer::getStrEventType(string name){
     return et;
 }
 
+//Handles index straight into a table of this file's event type ids
+int Tracer::getEventTypeId(EventTypeHandle handle){
+    if (handle.id < handleEventTypeIds.size()){
+        int id = handleEventTypeIds[handle.id];
+        if (id) return id;
+    }
+    else {
+        handleEventTypeIds.resize(handle.id+1, 0);
+    }
+    EventType *eType = EventType::fromHandle(handle);
+    if (eType == 0){
+        cout << "***Tracer Error*** Event type handle " << handle.id << " was never declared." << endl;
+        sc_stop();
+        eType = getStrEventType("Undeclared Event Type");
+    }
+    int id = getEventTypeId(eType);
+    handleEventTypeIds[handle.id] = id;
+    return id;
+}
+
 int Tracer::getEventTypeId(EventType* eType){
-    map<EventType *, int>::iterator iter = eventTypeIdMap.find(eType);
-    if (iter != eventTypeIdMap.end()){
-        return iter->second;
+    int *id = eventTypeIdMap.find(eType);
+    if (id){
+        return *id;
     } else {
         return registerEventType(eType);
     }
@@ -190,65 +762,128 @@ int Tracer::getEventTypeId(EventType* eType){
 
 #pragma mark -
 #pragma mark Trace Methods
+//Trace id cached for traces that were sampled out
+static const int UNSAMPLED_TRACE = -1;
+
 int Tracer::registerTrace(Trace *trace){
+    return registerTrace(trace, sampleTrace());
+}
+
+int Tracer::registerTrace(Trace *trace, bool sampled){
+    if (!sampled){
+        if (trace->sampledOutBy == 0 || trace->sampledOutBy == this) trace->sampledOutBy = this;
+        else traceIdMap.insert(trace, UNSAMPLED_TRACE);
+        return UNSAMPLED_TRACE;
+    }
     //TODO: Check that trace name is unique
     int index = ++traceCount;
     if (trace->getName() != "")
-        outfile << "<trace id=\"T" << index << "\" name=\"" << trace->getName() << "\">\n";
+        writer->beginTrace(index, trace->getName());
     else 
-        outfile << "<trace id=\"T" << index << "\" name=\"T" << index << "\">\n";
-    writeProperties(trace->getProperties());
-    outfile << "</trace>\n";
-    traceIdMap[trace] = index;
+        writer->beginTrace(index, getDefaultTraceName(index));
+    writer->writeProperties(trace->getTypedProperties());
+    writer->endTrace();
+    traceIdMap.insert(trace, index);
     return index;
 }
 
 void Tracer::retireTrace(Trace *trans){
+    if (trans->sampledOutBy == this){
+        trans->sampledOutBy = 0;
+        return;
+    }
+    int *id = traceIdMap.find(trans);
+    if (!id) return;
+    if (*id != UNSAMPLED_TRACE) writer->retireTrace(*id);
     traceIdMap.erase(trans);
 }
 
 void Tracer::initializeTrace(Trace *trace){
+    if (!enabled) return;
     if (!initComplete) initialize();
     registerTrace(trace);
 }
 
+int Tracer::findTraceId(Trace* trans){
+    if (trans->sampledOutBy == this) return UNSAMPLED_TRACE;
+    int *id = traceIdMap.find(trans);
+    return id ? *id : 0;
+}
+
 int Tracer::getTraceId(Trace* trans){
-    map<Trace *, int>::iterator iter = traceIdMap.find(trans);
-    if (iter != traceIdMap.end()){
-        return iter->second;
-    } else {
-        return registerTrace(trans);
-    }
+    int id = findTraceId(trans);
+    return id ? id : registerTrace(trans);
 }
 
 #pragma mark -
 #pragma mark TLM Payload Trace Methods
 int Tracer::registerTrace(tlm_generic_payload *trans){
+    return registerTrace(trans, sampleTrace());
+}
+
+int Tracer::registerTrace(tlm_generic_payload *trans, bool sampled){
+    if (!sampled){
+        setTlmGenericPayloadId(trans, UNSAMPLED_TRACE);
+        return UNSAMPLED_TRACE;
+    }
     int index = ++traceCount;
-    outfile << "<trace id=\"T" << index << "\" name=\"" << "T"<< index << "\">\n";
+    writer->beginTrace(index, getDefaultTraceName(index));
     writeTlmGenericPayloadTraceProperties(trans);
-    outfile << "</trace>\n";
-    tlmPayloadIdMap[trans] = index;
+    writer->endTrace();
+    setTlmGenericPayloadId(trans, index);
     return index;
 }
 
 void Tracer::retireTrace(tlm_generic_payload *trans){
-    tlmPayloadIdMap.erase(trans);
+    int id = findTlmGenericPayloadId(trans);
+    if (id > 0) writer->retireTrace(id);
+    TraceIdExtension *ext = trans->get_extension<TraceIdExtension>();
+    if (ext && ext->owner == this){
+        ext->owner = 0;
+        ext->id = 0;
+    }
+    else {
+        tlmPayloadIdMap.erase(trans);
+    }
 }
 
 void Tracer::initializeTrace(tlm_generic_payload *trans){
+    if (!enabled) return;
     if (!initComplete) initialize();
     registerTrace(trans);
 }
 
 void Tracer::initializeTrace(string name, tlm_generic_payload *trans){
+    if (!enabled) return;
     if (!initComplete) initialize();
+    if (!sampleTrace()){
+        setTlmGenericPayloadId(trans, UNSAMPLED_TRACE);
+        return;
+    }
     int index = ++traceCount;
-    outfile << "<trace id=\"T" << index << "\" name=\"" << name << "\">\n";
+    writer->beginTrace(index, name);
     writeTlmGenericPayloadTraceProperties(trans);
-    outfile << "</trace>\n";
+    writer->endTrace();
     //TODO: Check that name is unique and warning the user about the name map override if not
-    tlmPayloadIdMap[trans] = index;
+    setTlmGenericPayloadId(trans, index);
+}
+
+void Tracer::setTlmGenericPayloadId(tlm_generic_payload* trans, int index){
+    TraceIdExtension *ext = trans->get_extension<TraceIdExtension>();
+    if (!ext){
+        ext = new TraceIdExtension();
+        //Auto extensions are freed by the payload's reset(), so a recycled payload
+        //automatically starts a new trace.  That is only allowed with a memory manager.
+        if (trans->has_mm()) trans->set_auto_extension(ext);
+        else trans->set_extension(ext);
+    }
+    if (ext->owner == 0 || ext->owner == this){
+        ext->owner = this;
+        ext->id = index;
+    }
+    else {
+        tlmPayloadIdMap.insert(trans, index);
+    }
 }
 
 void Tracer::writeTlmGenericPayloadTraceProperties(tlm_generic_payload *trans){
@@ -258,25 +893,30 @@ void Tracer::writeTlmGenericPayloadTraceProperties(tlm_generic_payload *trans){
         case tlm::TLM_WRITE_COMMAND: command = "Write"; break;
         case tlm::TLM_IGNORE_COMMAND: command = "Ignore"; break;
     }
-    outfile << "<property name=\"Command\" value=\"" << command << "\"/>\n";
+    writer->writeProperty("Command", command);
     char buffer[1024];
-    sprintf(buffer, "%X", trans->get_address());
-    outfile << "<property name=\"Adress\" value=\"0x" << buffer << "\"/>\n";
-    outfile << "<property name=\"Data Length\" value=\"" << trans->get_data_length() << "\"/>\n";
-    outfile << "<property name=\"Streaming Width\" value=\"" << trans->get_streaming_width() << "\"/>\n";
+    sprintf(buffer, "0x%llX", (unsigned long long)trans->get_address());
+    writer->writeProperty("Adress", buffer);
+    writer->writeProperty("Data Length", trans->get_data_length());
+    writer->writeProperty("Streaming Width", trans->get_streaming_width());
     if (trans->get_byte_enable_ptr()){
-        outfile << "<property name=\"Byte Enable Length\" value=\"" << trans->get_byte_enable_length() << "\"/>\n";
-        outfile << "<property name=\"Byte Enable\" value=\"" << trans->get_byte_enable_ptr() << "\"/>\n";
+        writer->writeProperty("Byte Enable Length", trans->get_byte_enable_length());
+        writer->writeProperty("Byte Enable", PropertyValue::blob(trans->get_byte_enable_ptr(), trans->get_byte_enable_length()));
     }
 }
 
-int Tracer::getTlmGenericPayloadId(tlm_generic_payload* trans){
-    map<tlm_generic_payload *, int>::iterator iter = tlmPayloadIdMap.find(trans);
-    if (iter != tlmPayloadIdMap.end()){
-        return iter->second;
-    } else {
-        return registerTrace(trans);
+int Tracer::findTlmGenericPayloadId(tlm_generic_payload* trans){
+    TraceIdExtension *ext = trans->get_extension<TraceIdExtension>();
+    if (ext && ext->owner == this){
+        return ext->id;
     }
+    int *id = (ext && ext->owner) ? tlmPayloadIdMap.find(trans) : 0;
+    return id ? *id : 0;
+}
+
+int Tracer::getTlmGenericPayloadId(tlm_generic_payload* trans){
+    int id = findTlmGenericPayloadId(trans);
+    return id ? id : registerTrace(trans);
 }
 
 #pragma mark -
@@ -284,16 +924,9 @@ int Tracer::getTlmGenericPayloadId(tlm_generic_payload* trans){
 
 void Tracer::mark(sc_module *module, tlm_generic_payload *trans, sc_time &time, EventType *etype){
 #ifndef LPTRACE_OFF
-    int traceId, moduleId, eventTypeId;
+    if (!enabled) return;
     if (!initComplete) initialize();
-    traceId = getTlmGenericPayloadId(trans);
-    moduleId = getModuleId(module);
-    eventTypeId = getEventTypeId(etype);
-    char buffer[1024];
-    sprintf(buffer, "%g", time.to_seconds());
-    outfile << "<event type=\"E" << eventTypeId << "\" trace=\"T" << traceId << "\" module=\"M" << moduleId << "\" time=\"" << buffer << "\">\n";
-    writeTlmGenericPayloadEventProperties(trans);
-    outfile << "</event>\n";    
+    markEvent(module, trans, time, getEventTypeId(etype), 0, 0);
 #endif
 }
 
@@ -303,8 +936,11 @@ void Tracer::mark(sc_module *module, tlm_generic_payload *trans, EventType *etyp
 }
 
 void Tracer::mark(sc_module *module, tlm_generic_payload *trans, sc_time &time, string eventType){
+#ifndef LPTRACE_OFF
+    if (!enabled) return;
     if (!initComplete) initialize();  //Need to initialize here if needed sing getStrEventType writes to file
     Tracer::mark(module, trans, time, getStrEventType(eventType));
+#endif
 }
 
 void Tracer::mark(sc_module *module, tlm_generic_payload *trans, string eventType){
@@ -312,46 +948,151 @@ void Tracer::mark(sc_module *module, tlm_generic_payload *trans, string eventTyp
     Tracer::mark(module, trans, time, eventType);
 }
 
-void Tracer::mark(sc_module *module, tlm_generic_payload *trans, sc_time &time, EventType *etype, map<string, string> properties){
+void Tracer::mark(sc_module *module, tlm_generic_payload *trans, sc_time &time, EventTypeHandle etype){
 #ifndef LPTRACE_OFF
-    int traceId, moduleId, eventTypeId;
+    if (!enabled) return;
     if (!initComplete) initialize();
-    traceId = getTlmGenericPayloadId(trans);
-    moduleId = getModuleId(module);
-    eventTypeId = getEventTypeId(etype);
-    char buffer[1024];
-    sprintf(buffer, "%g", time.to_seconds());
-    outfile << "<event type=\"E" << eventTypeId << "\" trace=\"T" << traceId << "\" module=\"M" << moduleId << "\" time=\"" << buffer << "\">\n";
-    writeTlmGenericPayloadEventProperties(trans);
-    writeProperties(&properties);
-    outfile << "</event>\n";    
+    markEvent(module, trans, time, getEventTypeId(etype), 0, 0);
 #endif
 }
 
-void Tracer::mark(sc_module *module, tlm_generic_payload *trans, EventType *etype, map<string, string> properties){
+void Tracer::mark(sc_module *module, tlm_generic_payload *trans, EventTypeHandle etype){
+    sc_time time = sc_time_stamp();
+    Tracer::mark(module, trans, time, etype);
+}
+
+void Tracer::mark(sc_module *module, tlm_generic_payload *trans, sc_time &time, EventType *etype, const map<string, string> &properties){
+#ifndef LPTRACE_OFF
+    if (!enabled) return;
+    if (!initComplete) initialize();
+    markEvent(module, trans, time, getEventTypeId(etype), &properties, 0);
+#endif
+}
+
+void Tracer::mark(sc_module *module, tlm_generic_payload *trans, EventType *etype, const map<string, string> &properties){
     sc_time time = sc_time_stamp();
     Tracer::mark(module, trans, time, etype, properties);
 }
 
-void Tracer::mark(sc_module *module, tlm_generic_payload *trans, sc_time &time, string eventType, map<string, string> properties){
+void Tracer::mark(sc_module *module, tlm_generic_payload *trans, sc_time &time, string eventType, const map<string, string> &properties){
+#ifndef LPTRACE_OFF
+    if (!enabled) return;
     if (!initComplete) initialize();  //Need to initialize here if needed sing getStrEventType writes to file
     Tracer::mark(module, trans, time, getStrEventType(eventType), properties);
+#endif
 }
 
-void Tracer::mark(sc_module *module, tlm_generic_payload *trans, string eventType, map<string, string> properties){
+void Tracer::mark(sc_module *module, tlm_generic_payload *trans, string eventType, const map<string, string> &properties){
     sc_time time = sc_time_stamp();
     Tracer::mark(module, trans, time, eventType, properties);
 }
 
-void Tracer::writeTlmGenericPayloadEventProperties(tlm_generic_payload *trans){
-    outfile << "<property name=\"Response Status\" value=\"" << trans->get_response_string() << "\"/>\n";
+void Tracer::mark(sc_module *module, tlm_generic_payload *trans, sc_time &time, EventTypeHandle etype, const map<string, string> &properties){
+#ifndef LPTRACE_OFF
+    if (!enabled) return;
+    if (!initComplete) initialize();
+    markEvent(module, trans, time, getEventTypeId(etype), &properties, 0);
+#endif
+}
+
+void Tracer::mark(sc_module *module, tlm_generic_payload *trans, EventTypeHandle etype, const map<string, string> &properties){
+    sc_time time = sc_time_stamp();
+    Tracer::mark(module, trans, time, etype, properties);
+}
+
+void Tracer::mark(sc_module *module, tlm_generic_payload *trans, sc_time &time, EventType *etype, const PropertyList &properties){
+#ifndef LPTRACE_OFF
+    if (!enabled) return;
+    if (!initComplete) initialize();
+    markEvent(module, trans, time, getEventTypeId(etype), 0, &properties);
+#endif
+}
+
+void Tracer::mark(sc_module *module, tlm_generic_payload *trans, EventType *etype, const PropertyList &properties){
+    sc_time time = sc_time_stamp();
+    Tracer::mark(module, trans, time, etype, properties);
+}
+
+void Tracer::mark(sc_module *module, tlm_generic_payload *trans, sc_time &time, string eventType, const PropertyList &properties){
+#ifndef LPTRACE_OFF
+    if (!enabled) return;
+    if (!initComplete) initialize();  //Need to initialize here if needed sing getStrEventType writes to file
+    Tracer::mark(module, trans, time, getStrEventType(eventType), properties);
+#endif
+}
+
+void Tracer::mark(sc_module *module, tlm_generic_payload *trans, string eventType, const PropertyList &properties){
+    sc_time time = sc_time_stamp();
+    Tracer::mark(module, trans, time, eventType, properties);
+}
+
+void Tracer::mark(sc_module *module, tlm_generic_payload *trans, sc_time &time, EventTypeHandle etype, const PropertyList &properties){
+#ifndef LPTRACE_OFF
+    if (!enabled) return;
+    if (!initComplete) initialize();
+    markEvent(module, trans, time, getEventTypeId(etype), 0, &properties);
+#endif
+}
+
+void Tracer::mark(sc_module *module, tlm_generic_payload *trans, EventTypeHandle etype, const PropertyList &properties){
+    sc_time time = sc_time_stamp();
+    Tracer::mark(module, trans, time, etype, properties);
+}
+
+//All of the tlm_generic_payload marks end up here once the event type is resolved
+void Tracer::markEvent(sc_module *module, tlm_generic_payload *trans, const sc_time &time, int eventTypeId, const map<string, string> *properties, const PropertyList *propertyList){
+    int traceId, moduleId;
+    if (!eventTypeEnabled[eventTypeId]) return;
+    moduleId = getModuleId(module);
+    if (!moduleEnabled[moduleId]) return;
+    traceId = getTlmGenericPayloadId(trans);
+    if (traceId == UNSAMPLED_TRACE) return;
+    if (!pairs.empty()) recordLatencyPairs(traceId, moduleId, eventTypeId, time.value());
+    if (!fileOutput) return;
+    writer->beginEvent(eventTypeId, traceId, moduleId, time.value());
+    writeTlmGenericPayloadEventProperties(trans, eventTypeId);
+    if (properties) writer->writeProperties(properties);
+    if (propertyList) writer->writeProperties(propertyList);
+    writer->endEvent();
+}
+
+void Tracer::writeTlmGenericPayloadEventProperties(tlm_generic_payload *trans, int eventTypeId){
+    writer->writeProperty("Response Status", trans->get_response_string());
     unsigned char *ptr = trans->get_data_ptr();
-    if (ptr){
-        outfile << "<property name=\"Data\" value=\"0x";
-        for (int i = trans->get_data_length()-1; i >= 0; i--){
-            outfile << std::setw( 2 ) << std::setfill('0') << std::uppercase << hex << (int)ptr[i];
+    if (!ptr) return;
+    //The event type's own policy wins over the Tracer's
+    DataCapture capture = dataCapture;
+    unsigned int limit = dataCaptureLimit;
+    EventType *eType = ((size_t)eventTypeId < eventTypesById.size()) ? eventTypesById[eventTypeId] : 0;
+    if (eType && eType->getDataCapture() != CAPTURE_DEFAULT){
+        capture = eType->getDataCapture();
+        limit = eType->getDataCaptureLimit();
+    }
+    unsigned int length = trans->get_data_length();
+    switch (capture){
+        case CAPTURE_NONE:
+            break;
+        case CAPTURE_HASH: {
+            //FNV-1a, written as a number like the data itself
+            unsigned long long hash = 14695981039346656037ULL;
+            for (unsigned int i = 0; i < length; i++){
+                hash ^= ptr[i];
+                hash *= 1099511628211ULL;
+            }
+            unsigned char bytes[8];
+            for (int i = 0; i < 8; i++){
+                bytes[i] = (unsigned char)(hash >> (8*i));
+            }
+            writer->writeProperty("Data Hash", PropertyValue::blob(bytes, 8));
+            break;
         }
-        outfile << "\"/>\n";
+        case CAPTURE_FIRST_BYTES:
+            if (length > limit) length = limit;
+            writer->writeProperty("Data", PropertyValue::blob(ptr, length));
+            break;
+        default:
+            writer->writeProperty("Data", PropertyValue::blob(ptr, length));
+            break;
     }
 }
 
@@ -361,16 +1102,11 @@ void Tracer::writeTlmGenericPayloadEventProperties(tlm_generic_payload *trans){
 
 void Tracer::mark(sc_module *module, Trace *trans, sc_time &time, EventType *etype){
 #ifndef LPTRACE_OFF
-    int traceId, moduleId, eventTypeId;
+    if (!enabled) return;
     if (!initComplete) initialize();
-    traceId = getTraceId(trans);
-    moduleId = getModuleId(module);
-    eventTypeId = getEventTypeId(etype);
-    char buffer[1024];
-    sprintf(buffer, "%g", time.to_seconds());
-    outfile << "<event type=\"E" << eventTypeId << "\" trace=\"T" << traceId << "\" module=\"M" << moduleId << "\" time=\"" << buffer << "\"/>\n";
+    markEvent(module, trans, time, getEventTypeId(etype), 0, 0);
 #endif
-}   
+}
 
 void Tracer::mark(sc_module *module, Trace *trans, EventType *etype){
     sc_time time = sc_time_stamp();
@@ -378,8 +1114,11 @@ void Tracer::mark(sc_module *module, Trace *trans, EventType *etype){
 }
 
 void Tracer::mark(sc_module *module, Trace *trans, sc_time &time, string eventType){
+#ifndef LPTRACE_OFF
+    if (!enabled) return;
     if (!initComplete) initialize();  //Need to initialize here if needed sing getStrEventType writes to file
     Tracer::mark(module, trans, time, getStrEventType(eventType));
+#endif
 }
 
 void Tracer::mark(sc_module *module, Trace *trans, string eventType){
@@ -387,77 +1126,357 @@ void Tracer::mark(sc_module *module, Trace *trans, string eventType){
     Tracer::mark(module, trans, time, eventType);
 }
 
-void Tracer::mark(sc_module *module, Trace *trans, sc_time &time, EventType *etype, map<string, string> properties){
+void Tracer::mark(sc_module *module, Trace *trans, sc_time &time, EventTypeHandle etype){
 #ifndef LPTRACE_OFF
-    int traceId, moduleId, eventTypeId;
+    if (!enabled) return;
     if (!initComplete) initialize();
-    traceId = getTraceId(trans);
-    moduleId = getModuleId(module);
-    eventTypeId = getEventTypeId(etype);
-    char buffer[1024];
-    sprintf(buffer, "%g", time.to_seconds());
-    outfile << "<event type=\"E" << eventTypeId << "\" trace=\"T" << traceId << "\" module=\"M" << moduleId << "\" time=\"" << buffer << "\">\n";
-    writeProperties(&properties);
-    outfile << "</event>\n";  
+    markEvent(module, trans, time, getEventTypeId(etype), 0, 0);
+#endif
+}
+
+void Tracer::mark(sc_module *module, Trace *trans, EventTypeHandle etype){
+    sc_time time = sc_time_stamp();
+    Tracer::mark(module, trans, time, etype);
+}
+
+void Tracer::mark(sc_module *module, Trace *trans, sc_time &time, EventType *etype, const map<string, string> &properties){
+#ifndef LPTRACE_OFF
+    if (!enabled) return;
+    if (!initComplete) initialize();
+    markEvent(module, trans, time, getEventTypeId(etype), &properties, 0);
+#endif
+}
+
+void Tracer::mark(sc_module *module, Trace *trans, EventType *etype, const map<string, string> &properties){
+    sc_time time = sc_time_stamp();
+    Tracer::mark(module, trans, time, etype, properties);
+}
+
+void Tracer::mark(sc_module *module, Trace *trans, sc_time &time, string eventType, const map<string, string> &properties){
+#ifndef LPTRACE_OFF
+    if (!enabled) return;
+    if (!initComplete) initialize();  //Need to initialize here if needed sing getStrEventType writes to file
+    Tracer::mark(module, trans, time, getStrEventType(eventType), properties);
+#endif
+}
+
+void Tracer::mark(sc_module *module, Trace *trans, string eventType, const map<string, string> &properties){
+    sc_time time = sc_time_stamp();
+    Tracer::mark(module, trans, time, eventType, properties);
+}
+
+void Tracer::mark(sc_module *module, Trace *trans, sc_time &time, EventTypeHandle etype, const map<string, string> &properties){
+#ifndef LPTRACE_OFF
+    if (!enabled) return;
+    if (!initComplete) initialize();
+    markEvent(module, trans, time, getEventTypeId(etype), &properties, 0);
+#endif
+}
+
+void Tracer::mark(sc_module *module, Trace *trans, EventTypeHandle etype, const map<string, string> &properties){
+    sc_time time = sc_time_stamp();
+    Tracer::mark(module, trans, time, etype, properties);
+}
+
+void Tracer::mark(sc_module *module, Trace *trans, sc_time &time, EventType *etype, const PropertyList &properties){
+#ifndef LPTRACE_OFF
+    if (!enabled) return;
+    if (!initComplete) initialize();
+    markEvent(module, trans, time, getEventTypeId(etype), 0, &properties);
 #endif
 }
 
-void Tracer::mark(sc_module *module, Trace *trans, EventType *etype, map<string, string> properties){
+void Tracer::mark(sc_module *module, Trace *trans, EventType *etype, const PropertyList &properties){
     sc_time time = sc_time_stamp();
     Tracer::mark(module, trans, time, etype, properties);
 }
 
-void Tracer::mark(sc_module *module, Trace *trans, sc_time &time, string eventType, map<string, string> properties){
+void Tracer::mark(sc_module *module, Trace *trans, sc_time &time, string eventType, const PropertyList &properties){
+#ifndef LPTRACE_OFF
+    if (!enabled) return;
     if (!initComplete) initialize();  //Need to initialize here if needed sing getStrEventType writes to file
     Tracer::mark(module, trans, time, getStrEventType(eventType), properties);
+#endif
 }
 
-void Tracer::mark(sc_module *module, Trace *trans, string eventType, map<string, string> properties){
+void Tracer::mark(sc_module *module, Trace *trans, string eventType, const PropertyList &properties){
     sc_time time = sc_time_stamp();
     Tracer::mark(module, trans, time, eventType, properties);
 }
 
+void Tracer::mark(sc_module *module, Trace *trans, sc_time &time, EventTypeHandle etype, const PropertyList &properties){
+#ifndef LPTRACE_OFF
+    if (!enabled) return;
+    if (!initComplete) initialize();
+    markEvent(module, trans, time, getEventTypeId(etype), 0, &properties);
+#endif
+}
+
+void Tracer::mark(sc_module *module, Trace *trans, EventTypeHandle etype, const PropertyList &properties){
+    sc_time time = sc_time_stamp();
+    Tracer::mark(module, trans, time, etype, properties);
+}
+
+//All of the Trace marks end up here once the event type is resolved
+void Tracer::markEvent(sc_module *module, Trace *trans, const sc_time &time, int eventTypeId, const map<string, string> *properties, const PropertyList *propertyList){
+    int traceId, moduleId;
+    if (!eventTypeEnabled[eventTypeId]) return;
+    moduleId = getModuleId(module);
+    if (!moduleEnabled[moduleId]) return;
+    traceId = getTraceId(trans);
+    if (traceId == UNSAMPLED_TRACE) return;
+    if (!pairs.empty()) recordLatencyPairs(traceId, moduleId, eventTypeId, time.value());
+    if (!fileOutput) return;
+    writer->beginEvent(eventTypeId, traceId, moduleId, time.value());
+    if (properties) writer->writeProperties(properties);
+    if (propertyList) writer->writeProperties(propertyList);
+    writer->endEvent();
+}
+
 #pragma mark -
-#pragma mark Misc Methods
-void Tracer::writeProperties(map<string,string> *props){
-    map<string,string>::iterator iter;
-    iter = props->begin();
-    while(iter != props->end()){
-        outfile << "<property name=\"" << iter->first << "\" value=\"" << iter->second << "\"/>\n";
-        iter++;
+#pragma mark Trace Links
+//A new child is recorded if and only if its parent is.  A merged trace is
+//recorded if any trace merged into it before its first event was, so a merge
+//from a trace that was sampled out leaves it undecided
+void Tracer::addChildTrace(Trace *parent, Trace *child){
+    if (!enabled) return;
+    if (!initComplete) initialize();
+    int parentId = getTraceId(parent);
+    int childId = findTraceId(child);
+    if (!childId) childId = registerTrace(child, parentId != UNSAMPLED_TRACE);
+    writeLink(LINK_CHILD, parentId, childId);
+}
+
+void Tracer::addChildTrace(tlm_generic_payload *parent, tlm_generic_payload *child){
+    if (!enabled) return;
+    if (!initComplete) initialize();
+    int parentId = getTlmGenericPayloadId(parent);
+    int childId = findTlmGenericPayloadId(child);
+    if (!childId) childId = registerTrace(child, parentId != UNSAMPLED_TRACE);
+    writeLink(LINK_CHILD, parentId, childId);
+}
+
+void Tracer::mergeTrace(Trace *into, Trace *from){
+    if (!enabled) return;
+    if (!initComplete) initialize();
+    int fromId = getTraceId(from);
+    if (fromId == UNSAMPLED_TRACE) return;
+    int intoId = findTraceId(into);
+    if (!intoId) intoId = registerTrace(into, true);
+    writeLink(LINK_MERGE, fromId, intoId);
+}
+
+void Tracer::mergeTrace(tlm_generic_payload *into, tlm_generic_payload *from){
+    if (!enabled) return;
+    if (!initComplete) initialize();
+    int fromId = getTlmGenericPayloadId(from);
+    if (fromId == UNSAMPLED_TRACE) return;
+    int intoId = findTlmGenericPayloadId(into);
+    if (!intoId) intoId = registerTrace(into, true);
+    writeLink(LINK_MERGE, fromId, intoId);
+}
+
+//A link to a trace that was sampled out would point at nothing
+void Tracer::writeLink(int kind, int fromTraceId, int toTraceId){
+    if (!fileOutput) return;
+    if (fromTraceId == UNSAMPLED_TRACE || toTraceId == UNSAMPLED_TRACE) return;
+    writer->writeLink(kind, fromTraceId, toTraceId, sc_time_stamp().value());
+}
+
+#pragma mark -
+#pragma mark Spans
+
+Tracer::SpanId Tracer::beginSpan(sc_module *module, tlm_generic_payload *trans, EventType *etype){
+#ifndef LPTRACE_OFF
+    if (!enabled) return 0;
+    if (!initComplete) initialize();
+    return beginSpanEvent(module, trans, getEventTypeId(etype));
+#else
+    return 0;
+#endif
+}
+
+Tracer::SpanId Tracer::beginSpan(sc_module *module, tlm_generic_payload *trans, string eventType){
+#ifndef LPTRACE_OFF
+    if (!enabled) return 0;
+    if (!initComplete) initialize();
+    return beginSpanEvent(module, trans, getEventTypeId(getStrEventType(eventType)));
+#else
+    return 0;
+#endif
+}
+
+Tracer::SpanId Tracer::beginSpan(sc_module *module, tlm_generic_payload *trans, EventTypeHandle etype){
+#ifndef LPTRACE_OFF
+    if (!enabled) return 0;
+    if (!initComplete) initialize();
+    return beginSpanEvent(module, trans, getEventTypeId(etype));
+#else
+    return 0;
+#endif
+}
+
+Tracer::SpanId Tracer::beginSpan(sc_module *module, Trace *trans, EventType *etype){
+#ifndef LPTRACE_OFF
+    if (!enabled) return 0;
+    if (!initComplete) initialize();
+    return beginSpanEvent(module, trans, getEventTypeId(etype));
+#else
+    return 0;
+#endif
+}
+
+Tracer::SpanId Tracer::beginSpan(sc_module *module, Trace *trans, string eventType){
+#ifndef LPTRACE_OFF
+    if (!enabled) return 0;
+    if (!initComplete) initialize();
+    return beginSpanEvent(module, trans, getEventTypeId(getStrEventType(eventType)));
+#else
+    return 0;
+#endif
+}
+
+Tracer::SpanId Tracer::beginSpan(sc_module *module, Trace *trans, EventTypeHandle etype){
+#ifndef LPTRACE_OFF
+    if (!enabled) return 0;
+    if (!initComplete) initialize();
+    return beginSpanEvent(module, trans, getEventTypeId(etype));
+#else
+    return 0;
+#endif
+}
+
+void Tracer::endSpan(SpanId span){
+    endSpanEvent(span, 0, 0);
+}
+
+void Tracer::endSpan(SpanId span, const map<string, string> &properties){
+    endSpanEvent(span, &properties, 0);
+}
+
+void Tracer::endSpan(SpanId span, const PropertyList &properties){
+    endSpanEvent(span, 0, &properties);
+}
+
+//Filtered and sampled out spans are dropped here just like marked events
+Tracer::SpanId Tracer::beginSpanEvent(sc_module *module, tlm_generic_payload *trans, int eventTypeId){
+    if (!eventTypeEnabled[eventTypeId]) return 0;
+    int moduleId = getModuleId(module);
+    if (!moduleEnabled[moduleId]) return 0;
+    int traceId = getTlmGenericPayloadId(trans);
+    if (traceId == UNSAMPLED_TRACE) return 0;
+    return openSpan(eventTypeId, traceId, moduleId, trans);
+}
+
+Tracer::SpanId Tracer::beginSpanEvent(sc_module *module, Trace *trans, int eventTypeId){
+    if (!eventTypeEnabled[eventTypeId]) return 0;
+    int moduleId = getModuleId(module);
+    if (!moduleEnabled[moduleId]) return 0;
+    int traceId = getTraceId(trans);
+    if (traceId == UNSAMPLED_TRACE) return 0;
+    return openSpan(eventTypeId, traceId, moduleId, 0);
+}
+
+Tracer::SpanId Tracer::openSpan(int eventTypeId, int traceId, int moduleId, tlm_generic_payload *payload){
+    unsigned long long time = sc_time_stamp().value();
+    //Latency statistics see the span as an event at its begin time
+    if (!pairs.empty()) recordLatencyPairs(traceId, moduleId, eventTypeId, time);
+    SpanId id;
+    if (!freeSpanIds.empty()){
+        id = freeSpanIds.back();
+        freeSpanIds.pop_back();
+    }
+    else {
+        openSpans.push_back(OpenSpan());
+        id = (SpanId)openSpans.size();
+    }
+    OpenSpan &span = openSpans[id-1];
+    span.eventTypeId = eventTypeId;
+    span.traceId = traceId;
+    span.moduleId = moduleId;
+    span.time = time;
+    span.payload = payload;
+    return id;
+}
+
+void Tracer::endSpanEvent(SpanId id, const map<string, string> *properties, const PropertyList *propertyList){
+    if (id <= 0 || (size_t)id > openSpans.size() || openSpans[id-1].eventTypeId == 0){
+        if (id != 0) cout << "***Tracer Warning*** Span " << id << " ended but it is not open." << endl;
+        return;
+    }
+    OpenSpan &span = openSpans[id-1];
+    if (fileOutput){
+        unsigned long long time = sc_time_stamp().value();
+        writer->beginSpan(span.eventTypeId, span.traceId, span.moduleId, span.time, time - span.time);
+        if (span.payload) writeTlmGenericPayloadEventProperties(span.payload, span.eventTypeId);
+        if (properties) writer->writeProperties(properties);
+        if (propertyList) writer->writeProperties(propertyList);
+        writer->endEvent();
     }
+    span.eventTypeId = 0;
+    freeSpanIds.push_back(id);
+}
+
+#pragma mark -
+#pragma mark Misc Methods
+string Tracer::getDefaultTraceName(int index){
+    char buffer[32];
+    sprintf(buffer, "T%d", index);
+    return buffer;
 }
 
 #pragma mark -
 #pragma mark sc_trace_file methods
-void Tracer::trace(const bool&, const std::string&){}
-void Tracer::trace(const sc_dt::sc_bit&, const std::string&){}
-void Tracer::trace(const sc_dt::sc_logic&, const std::string&){}
-void Tracer::trace(const unsigned char&, const std::string&, int){}
-void Tracer::trace(const short unsigned int&, const std::string&, int){}
-void Tracer::trace(const unsigned int&, const std::string&, int){}
-void Tracer::trace(const long unsigned int&, const std::string&, int){}
-void Tracer::trace(const char&, const std::string&, int){}
-void Tracer::trace(const short int&, const std::string&, int){}
-void Tracer::trace(const int&, const std::string&, int){}
-void Tracer::trace(const long int&, const std::string&, int){}
-void Tracer::trace(const sc_dt::int64&, const std::string&, int){}
-void Tracer::trace(const sc_dt::uint64&, const std::string&, int){}
-void Tracer::trace(const float&, const std::string&){}
-void Tracer::trace(const double&, const std::string&){}
-void Tracer::trace(const sc_dt::sc_int_base&, const std::string&){}
-void Tracer::trace(const sc_dt::sc_uint_base&, const std::string&){}
-void Tracer::trace(const sc_dt::sc_signed&, const std::string&){}
-void Tracer::trace(const sc_dt::sc_unsigned&, const std::string&){}
-void Tracer::trace(const sc_dt::sc_fxval&, const std::string&){}
-void Tracer::trace(const sc_dt::sc_fxval_fast&, const std::string&){}
-void Tracer::trace(const sc_dt::sc_fxnum&, const std::string&){}
-void Tracer::trace(const sc_dt::sc_fxnum_fast&, const std::string&){}
-void Tracer::trace(const sc_dt::sc_bv_base&, const std::string&){}
-void Tracer::trace(const sc_dt::sc_lv_base&, const std::string&){}
-void Tracer::trace(const unsigned int&, const std::string&, const char**){}
+int Tracer::addSignal(const string &name, int width){
+    if (!signalsRegistered){
+        sc_core::sc_get_curr_simcontext()->add_trace_file(this);
+        signalsRegistered = true;
+    }
+    SignalDeclaration declaration = {++signalCount, name, width};
+    undeclaredSignals.push_back(declaration);
+    return declaration.id;
+}
+
+void Tracer::trace(const bool &value, const std::string &name){ signals.add(value, addSignal(name, 1)); }
+void Tracer::trace(const sc_dt::sc_bit &value, const std::string &name){ signals.add(value, addSignal(name, 1)); }
+void Tracer::trace(const sc_dt::sc_logic &value, const std::string &name){ signals.add(value, addSignal(name, 1)); }
+void Tracer::trace(const unsigned char &value, const std::string &name, int width){ signals.add(value, addSignal(name, width)); }
+void Tracer::trace(const short unsigned int &value, const std::string &name, int width){ signals.add(value, addSignal(name, width)); }
+void Tracer::trace(const unsigned int &value, const std::string &name, int width){ signals.add(value, addSignal(name, width)); }
+void Tracer::trace(const long unsigned int &value, const std::string &name, int width){ signals.add(value, addSignal(name, width)); }
+void Tracer::trace(const char &value, const std::string &name, int width){ signals.add(value, addSignal(name, width)); }
+void Tracer::trace(const short int &value, const std::string &name, int width){ signals.add(value, addSignal(name, width)); }
+void Tracer::trace(const int &value, const std::string &name, int width){ signals.add(value, addSignal(name, width)); }
+void Tracer::trace(const long int &value, const std::string &name, int width){ signals.add(value, addSignal(name, width)); }
+void Tracer::trace(const sc_dt::int64 &value, const std::string &name, int width){ signals.add(value, addSignal(name, width)); }
+void Tracer::trace(const sc_dt::uint64 &value, const std::string &name, int width){ signals.add(value, addSignal(name, width)); }
+void Tracer::trace(const float &value, const std::string &name){ signals.add(value, addSignal(name, 0)); }
+void Tracer::trace(const double &value, const std::string &name){ signals.add(value, addSignal(name, 0)); }
+void Tracer::trace(const sc_dt::sc_int_base &value, const std::string &name){ signals.add(value, addSignal(name, value.length())); }
+void Tracer::trace(const sc_dt::sc_uint_base &value, const std::string &name){ signals.add(value, addSignal(name, value.length())); }
+void Tracer::trace(const sc_dt::sc_signed &value, const std::string &name){ signals.add(value, addSignal(name, value.length())); }
+void Tracer::trace(const sc_dt::sc_unsigned &value, const std::string &name){ signals.add(value, addSignal(name, value.length())); }
+void Tracer::trace(const sc_dt::sc_fxval &value, const std::string &name){ signals.add(value, addSignal(name, 0)); }
+void Tracer::trace(const sc_dt::sc_fxval_fast &value, const std::string &name){ signals.add(value, addSignal(name, 0)); }
+void Tracer::trace(const sc_dt::sc_fxnum &value, const std::string &name){ signals.add(value, addSignal(name, 0)); }
+void Tracer::trace(const sc_dt::sc_fxnum_fast &value, const std::string &name){ signals.add(value, addSignal(name, 0)); }
+void Tracer::trace(const sc_dt::sc_bv_base &value, const std::string &name){ signals.add(value, addSignal(name, value.length())); }
+void Tracer::trace(const sc_dt::sc_lv_base &value, const std::string &name){ signals.add(value, addSignal(name, value.length())); }
+void Tracer::trace(const unsigned int &value, const std::string &name, const char **names){ signals.add(value, addSignal(name, 0), names); }
 void Tracer::write_comment(const std::string&){}
-void Tracer::cycle(bool){}
+
+//Like the VCD writer, values are sampled once at the end of each time step
+//rather than after every delta cycle
+void Tracer::cycle(bool deltaCycle){
+    if (deltaCycle || !enabled || signalCount == 0) return;
+    if (!initComplete) initialize();
+    if (!fileOutput) return;
+    for (size_t i = 0; i < undeclaredSignals.size(); i++){
+        writer->declareSignal(undeclaredSignals[i].id, undeclaredSignals[i].name, undeclaredSignals[i].width);
+    }
+    undeclaredSignals.clear();
+    signals.writeChanges(writer, sc_time_stamp().value());
+}
 
 
 
@@ -42,6 +42,11 @@
 #include <map>
 #include "Trace.h"
 #include "EventType.h"
+#include "TraceWriter.h"
+#include "IdMap.h"
+#include "TraceIdExtension.h"
+#include "LatencyHistogram.h"
+#include "SignalTable.h"
 
 using sc_core::sc_module;
 using sc_core::sc_time;
@@ -55,15 +60,73 @@ using sc_core::sc_trace_file;
 #pragma mark -
 #pragma mark Tracer Global Defines
 //Global defines for easy use of the shared tracer.  Marking events provides the 
-//pointer to the source module but can only be called from within an sc_module
-#define MarkEvent(...) Tracer::getSharedTracer()->mark(this,##__VA_ARGS__);
-#define InitializeTrace(...) Tracer::getSharedTracer()->initializeTrace(##__VA_ARGS__);
-#define RetireTrace(trace) Tracer::getSharedTracer()->retireTrace(trace);
+//pointer to the source module but can only be called from within an sc_module.
+//The arguments are only evaluated when tracing is enabled, so building event
+//names or property maps at the call site costs nothing when it is off.
+//RetireTrace is always called since it only keeps the Tracer's record of live
+//traces right, and a trace retired while tracing is off must not live on when
+//it is turned back on.  Defining LPTRACE_OFF removes the calls entirely.
+#ifndef LPTRACE_OFF
+#define MarkEvent(...) do { if (lpt::Tracer::enabled) lpt::Tracer::getSharedTracer()->mark(this,##__VA_ARGS__); } while (0)
+#define InitializeTrace(...) do { if (lpt::Tracer::enabled) lpt::Tracer::getSharedTracer()->initializeTrace(__VA_ARGS__); } while (0)
+#define RetireTrace(trace) do { lpt::Tracer::getSharedTracer()->retireTrace(trace); } while (0)
+#define AddChildTrace(parent, child) do { if (lpt::Tracer::enabled) lpt::Tracer::getSharedTracer()->addChildTrace(parent, child); } while (0)
+#define MergeTrace(into, from) do { if (lpt::Tracer::enabled) lpt::Tracer::getSharedTracer()->mergeTrace(into, from); } while (0)
+#else
+#define MarkEvent(...) do { } while (0)
+#define InitializeTrace(...) do { } while (0)
+#define RetireTrace(trace) do { } while (0)
+#define AddChildTrace(parent, child) do { } while (0)
+#define MergeTrace(into, from) do { } while (0)
+#endif
+
+//Trace levels, from the least to the most detailed.  Marks made with the
+//leveled macros below are compiled out when their level is above LPTRACE_LEVEL
+//(define it when compiling the model, e.g. -DLPTRACE_LEVEL=1 for transaction
+//level only), and the rest are skipped at run time when their level is above
+//Tracer::setLevel().  Plain MarkEvent is not leveled.
+#define LPTRACE_LEVEL_TRANSACTION 1
+#define LPTRACE_LEVEL_PHASE 2
+#define LPTRACE_LEVEL_DEBUG 3
+#ifndef LPTRACE_LEVEL
+#define LPTRACE_LEVEL LPTRACE_LEVEL_DEBUG
+#endif
+//Records a span from here to the end of the enclosing scope, see ScopedSpan.
+//It declares a variable, so it can't be the whole body of an if or a loop.
+#define LPTRACE_CONCAT_(a, b) a##b
+#define LPTRACE_CONCAT(a, b) LPTRACE_CONCAT_(a, b)
+#ifndef LPTRACE_OFF
+#define MarkSpan(...) lpt::ScopedSpan LPTRACE_CONCAT(lptSpan, __LINE__)(this, ##__VA_ARGS__)
+#else
+#define MarkSpan(...) do { } while (0)
+#endif
+
+#if !defined(LPTRACE_OFF) && LPTRACE_LEVEL >= LPTRACE_LEVEL_TRANSACTION
+#define MarkTransactionEvent(...) do { if (lpt::Tracer::enabled && lpt::Tracer::level >= LPTRACE_LEVEL_TRANSACTION) lpt::Tracer::getSharedTracer()->mark(this,##__VA_ARGS__); } while (0)
+#else
+#define MarkTransactionEvent(...) do { } while (0)
+#endif
+#if !defined(LPTRACE_OFF) && LPTRACE_LEVEL >= LPTRACE_LEVEL_PHASE
+#define MarkPhaseEvent(...) do { if (lpt::Tracer::enabled && lpt::Tracer::level >= LPTRACE_LEVEL_PHASE) lpt::Tracer::getSharedTracer()->mark(this,##__VA_ARGS__); } while (0)
+#else
+#define MarkPhaseEvent(...) do { } while (0)
+#endif
+#if !defined(LPTRACE_OFF) && LPTRACE_LEVEL >= LPTRACE_LEVEL_DEBUG
+#define MarkDebugEvent(...) do { if (lpt::Tracer::enabled && lpt::Tracer::level >= LPTRACE_LEVEL_DEBUG) lpt::Tracer::getSharedTracer()->mark(this,##__VA_ARGS__); } while (0)
+#else
+#define MarkDebugEvent(...) do { } while (0)
+#endif
 
 #pragma mark -
 
 namespace lpt{
 
+    //How Tracer::setSampling picks the traces it records
+    enum SampleMode {
+        SAMPLE_HASHED,          //A hash of the trace's sequence number, so periodic traffic doesn't alias
+        SAMPLE_EVERY_NTH        //The first trace and every Nth after it
+    };
+
     class Tracer : public sc_trace_file{
     public:
 #pragma mark -
@@ -71,20 +134,43 @@ namespace lpt{
         //Ideally this gets used as a singleton, but the constructors are public in case
         //you need to have multiple trace files for some reason.  You can't use the defined 
         //macros in that case though.
-        Tracer::Tracer();
+        Tracer();
         Tracer(char * filename);
         static Tracer* getSharedTracer();
         ~Tracer();
 #pragma mark -
+#pragma mark Runtime Enable
+        //Checked by the global macros before their arguments are evaluated and
+        //by mark() itself, so disabled tracing costs a single branch per event
+        static bool enabled;
+        static void setEnabled(bool enabled);
+        static bool isEnabled();
+        //Run time threshold for the leveled MarkTransactionEvent, MarkPhaseEvent
+        //and MarkDebugEvent macros, one of the LPTRACE_LEVEL_ values.  Marks above
+        //it cost one more branch.  Defaults to LPTRACE_LEVEL_DEBUG (everything).
+        static int level;
+        static void setLevel(int level);
+        static int getLevel();
+#pragma mark -
 #pragma mark TLM OSCI Payload Recording
         void mark(sc_module *module, tlm_generic_payload *trans, sc_time &time, EventType *etype);
         void mark(sc_module *module, tlm_generic_payload *trans, EventType *etype);
         void mark(sc_module *module, tlm_generic_payload *trans, sc_time &time, string eventType);
         void mark(sc_module *module, tlm_generic_payload *trans, string eventType);
-        void mark(sc_module *module, tlm_generic_payload *trans, sc_time &time, EventType *etype, map<string, string> properties);
-        void mark(sc_module *module, tlm_generic_payload *trans, EventType *etype, map<string, string> properties);
-        void mark(sc_module *module, tlm_generic_payload *trans, sc_time &time, string eventType, map<string, string> properties);
-        void mark(sc_module *module, tlm_generic_payload *trans, string eventType, map<string, string> properties);
+        void mark(sc_module *module, tlm_generic_payload *trans, sc_time &time, EventTypeHandle etype);
+        void mark(sc_module *module, tlm_generic_payload *trans, EventTypeHandle etype);
+        void mark(sc_module *module, tlm_generic_payload *trans, sc_time &time, EventType *etype, const map<string, string> &properties);
+        void mark(sc_module *module, tlm_generic_payload *trans, EventType *etype, const map<string, string> &properties);
+        void mark(sc_module *module, tlm_generic_payload *trans, sc_time &time, string eventType, const map<string, string> &properties);
+        void mark(sc_module *module, tlm_generic_payload *trans, string eventType, const map<string, string> &properties);
+        void mark(sc_module *module, tlm_generic_payload *trans, sc_time &time, EventTypeHandle etype, const map<string, string> &properties);
+        void mark(sc_module *module, tlm_generic_payload *trans, EventTypeHandle etype, const map<string, string> &properties);
+        void mark(sc_module *module, tlm_generic_payload *trans, sc_time &time, EventType *etype, const PropertyList &properties);
+        void mark(sc_module *module, tlm_generic_payload *trans, EventType *etype, const PropertyList &properties);
+        void mark(sc_module *module, tlm_generic_payload *trans, sc_time &time, string eventType, const PropertyList &properties);
+        void mark(sc_module *module, tlm_generic_payload *trans, string eventType, const PropertyList &properties);
+        void mark(sc_module *module, tlm_generic_payload *trans, sc_time &time, EventTypeHandle etype, const PropertyList &properties);
+        void mark(sc_module *module, tlm_generic_payload *trans, EventTypeHandle etype, const PropertyList &properties);
         void initializeTrace(string name, tlm_generic_payload *trans);
         void initializeTrace(tlm_generic_payload *trans);
         void retireTrace(tlm_generic_payload *trans);
@@ -94,17 +180,60 @@ namespace lpt{
         void mark(sc_module *module, Trace *trans, EventType *etype);
         void mark(sc_module *module, Trace *trans, sc_time &time, string eventType);
         void mark(sc_module *module, Trace *trans, string eventType);
-        void mark(sc_module *module, Trace *trans, sc_time &time, EventType *etype, map<string, string> properties);
-        void mark(sc_module *module, Trace *trans, EventType *etype, map<string, string> properties);
-        void mark(sc_module *module, Trace *trans, sc_time &time, string eventType, map<string, string> properties);
-        void mark(sc_module *module, Trace *trans, string eventType, map<string, string> properties);
+        void mark(sc_module *module, Trace *trans, sc_time &time, EventTypeHandle etype);
+        void mark(sc_module *module, Trace *trans, EventTypeHandle etype);
+        void mark(sc_module *module, Trace *trans, sc_time &time, EventType *etype, const map<string, string> &properties);
+        void mark(sc_module *module, Trace *trans, EventType *etype, const map<string, string> &properties);
+        void mark(sc_module *module, Trace *trans, sc_time &time, string eventType, const map<string, string> &properties);
+        void mark(sc_module *module, Trace *trans, string eventType, const map<string, string> &properties);
+        void mark(sc_module *module, Trace *trans, sc_time &time, EventTypeHandle etype, const map<string, string> &properties);
+        void mark(sc_module *module, Trace *trans, EventTypeHandle etype, const map<string, string> &properties);
+        void mark(sc_module *module, Trace *trans, sc_time &time, EventType *etype, const PropertyList &properties);
+        void mark(sc_module *module, Trace *trans, EventType *etype, const PropertyList &properties);
+        void mark(sc_module *module, Trace *trans, sc_time &time, string eventType, const PropertyList &properties);
+        void mark(sc_module *module, Trace *trans, string eventType, const PropertyList &properties);
+        void mark(sc_module *module, Trace *trans, sc_time &time, EventTypeHandle etype, const PropertyList &properties);
+        void mark(sc_module *module, Trace *trans, EventTypeHandle etype, const PropertyList &properties);
         void initializeTrace(Trace *trace);
         //This must be called when re-using a trace pointer for a new trace
         void retireTrace(Trace *trace);     
 #pragma mark -
+#pragma mark Trace Links
+        //Records that child was split off parent (a copy of a multicast packet,
+        //a burst cut into beats) or that from was merged into into, as a link
+        //record holding just the two trace ids, so the child or merged trace
+        //doesn't repeat the other's properties.  A child first seen here follows
+        //the sampling decision of its parent, and a merged trace is recorded if
+        //any of the traces merged into it is.  Merging several traces into one
+        //takes one call for each.
+        void addChildTrace(Trace *parent, Trace *child);
+        void addChildTrace(tlm_generic_payload *parent, tlm_generic_payload *child);
+        void mergeTrace(Trace *into, Trace *from);
+        void mergeTrace(tlm_generic_payload *into, tlm_generic_payload *from);
+#pragma mark -
+#pragma mark Spans
+        //A span is a begin/end pair recorded as a single event that has the
+        //begin time and a duration, written when the span ends.  beginSpan
+        //returns 0 when the span isn't recorded (tracing off, filtered or
+        //sampled out), and endSpan ignores 0.  The payload properties of a
+        //tlm_generic_payload are taken at the end, so it must still be valid.
+        typedef int SpanId;
+        SpanId beginSpan(sc_module *module, tlm_generic_payload *trans, EventType *etype);
+        SpanId beginSpan(sc_module *module, tlm_generic_payload *trans, string eventType);
+        SpanId beginSpan(sc_module *module, tlm_generic_payload *trans, EventTypeHandle etype);
+        SpanId beginSpan(sc_module *module, Trace *trans, EventType *etype);
+        SpanId beginSpan(sc_module *module, Trace *trans, string eventType);
+        SpanId beginSpan(sc_module *module, Trace *trans, EventTypeHandle etype);
+        void endSpan(SpanId span);
+        void endSpan(SpanId span, const map<string, string> &properties);
+        void endSpan(SpanId span, const PropertyList &properties);
+#pragma mark -
 #pragma mark sc_trace_file methods
-        //Methods required for sc_trace_file inheritance.  Not implemeted yet, but 
-        //in a future revision this will be use for tracing waves as well as TLM events
+        //Waveform tracing, so sc_trace() can record signals into the same file as
+        //the transactions.  The first trace call adds the Tracer to the kernel's
+        //trace files; from then on the values are compared with their last
+        //written values at the end of every time step and only changes are
+        //written.  Traced objects must outlive the simulation.
         void trace(const bool&, const std::string&);
         void trace(const sc_dt::sc_bit&, const std::string&);
         void trace(const sc_dt::sc_logic&, const std::string&);
@@ -134,12 +263,106 @@ namespace lpt{
         void write_comment(const std::string&);
         void cycle(bool);
 #pragma mark -
-#pragma mark Filename Accessors
-        //Note: filenames cannot be set after the first event is marked
+#pragma mark Filename & Output Format Accessors
+        //Note: filenames and formats cannot be set after the first event is marked.
+        //A filename ending in ".scnb" selects the binary format and one ending in
+        //".json" the Chrome Trace Event format, otherwise the extension for the
+        //current format is appended if it is missing.
         void setFilename(string filename);
         static void setSharedFilename(string filename);
         string getFilename();
         static string getSharedFilename();
+        void setOutputFormat(OutputFormat format);
+        static void setSharedOutputFormat(OutputFormat format);
+        OutputFormat getOutputFormat();
+        //In asynchronous mode formatting and file I/O happen on a background
+        //writer thread and the simulation thread only queues records
+        void setAsync(bool async);
+        static void setSharedAsync(bool async);
+        bool getAsync();
+        //Compressed files are written in independently compressed blocks (see
+        //TraceFile.h).  Needs the library built with LPTRACE_ZLIB defined.
+        void setCompression(bool compressed);
+        static void setSharedCompression(bool compressed);
+        bool getCompression();
+        //Writes a sidecar index (filename + ".idx") with the position of every
+        //eventInterval-th event (or one every byteInterval bytes) and of every
+        //trace record, for fast seeking into large traces
+        void setIndexing(bool index, unsigned int eventInterval = 1024, unsigned int byteInterval = 1 << 20);
+        static void setSharedIndexing(bool index, unsigned int eventInterval = 1024, unsigned int byteInterval = 1 << 20);
+        bool getIndexing();
+#pragma mark -
+#pragma mark Module & Event Type Filters
+        //Limits recording to some modules and event types.  Patterns are globs
+        //(* and ?) on the hierarchical module name ("top.bus*") or the event
+        //type's full name; a leading ! excludes.  With any include pattern only
+        //matches are recorded, otherwise everything but the excludes.  A module
+        //pattern covers the module's whole subtree, and a deeper match overrides
+        //it.  Filters are resolved into one enable bit per module and event type
+        //as they are registered, so they must be added before the first event.
+        //The environment variables LPTRACE_MODULES and LPTRACE_EVENTTYPES (comma
+        //separated patterns) and LPTRACE_FILTER_FILE are read at the first event.
+        void addModuleFilter(string pattern);
+        void addEventTypeFilter(string pattern);
+        static void addSharedModuleFilter(string pattern);
+        static void addSharedEventTypeFilter(string pattern);
+        //One pattern per line, "module <pattern>" or "eventtype <pattern>", with
+        //# starting a comment.  False if the file cannot be read.
+        bool loadFilterFile(string filename);
+        static bool loadSharedFilterFile(string filename);
+#pragma mark -
+#pragma mark Trace Sampling
+        //Records only one in rate traces.  The decision is made once when a trace
+        //is first seen and cached on the payload's TraceIdExtension or the Trace,
+        //so the events of a trace that is sampled out are dropped after a single
+        //check, without writing a trace record or adding map entries.  Both modes
+        //are deterministic, seed picks a different hashed subset.  A rate of 0 or
+        //1 records every trace.  Applies to traces first seen after the call.
+        void setSampling(unsigned int rate, SampleMode mode = SAMPLE_HASHED, unsigned int seed = 0);
+        static void setSharedSampling(unsigned int rate, SampleMode mode = SAMPLE_HASHED, unsigned int seed = 0);
+        unsigned int getSampling();
+#pragma mark -
+#pragma mark Flight Recorder
+        //Flight recorder mode keeps only the most recent records, in the binary
+        //format in a ring of ringBytes allocated at the first event, instead of
+        //writing the whole simulation.  The ring is written to the trace file
+        //(switched to the binary format) when the Tracer is destroyed, when
+        //dumpFlightRecorder is called, and on a fatal signal once the handlers
+        //are installed.  Must be set before the first event, 0 turns it off.
+        void setFlightRecorder(size_t ringBytes);
+        static void setSharedFlightRecorder(size_t ringBytes);
+        size_t getFlightRecorder();
+        //Writes the ring to filename, or the trace file if none is given
+        bool dumpFlightRecorder(string filename = "");
+        static bool dumpSharedFlightRecorder(string filename = "");
+        //Dumps every flight recorder on SIGABRT (so also on a failed assert),
+        //SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGINT and SIGTERM, then lets the
+        //signal take its default action.  The dump allocates, so this is best
+        //effort if the heap itself is what broke.
+        static void installFlightRecorderSignalHandlers();
+#pragma mark -
+#pragma mark Payload Data Capture
+        //How much tlm_generic_payload data is recorded for event types that don't
+        //set their own policy with EventType::setDataCapture().  Defaults to full.
+        void setDataCapture(DataCapture capture, unsigned int limit = 0);
+        static void setSharedDataCapture(DataCapture capture, unsigned int limit = 0);
+#pragma mark -
+#pragma mark Latency Statistics
+        //Measures the time from a start event to the next end event on the same
+        //trace while simulating, into a histogram per pair of start and end
+        //modules.  Latency pairs can be added before or after their event types
+        //are first marked.  The tables are written to cout when the Tracer is
+        //destroyed, or call writeStatistics after sc_start returns.
+        void addLatencyPair(EventTypeHandle start, EventTypeHandle end, string name = "");
+        void addLatencyPair(string start, string end, string name = "");
+        static void addSharedLatencyPair(EventTypeHandle start, EventTypeHandle end, string name = "");
+        static void addSharedLatencyPair(string start, string end, string name = "");
+        void writeStatistics(std::ostream &out);
+        //With file output off nothing is written and marking only updates the
+        //statistics.  Must be set before the first event.
+        void setFileOutput(bool output);
+        static void setSharedFileOutput(bool output);
+        bool getFileOutput();
     protected:
 #pragma mark -
 #pragma mark Internal Methods
@@ -147,35 +370,170 @@ namespace lpt{
         void initialize();
         string filename;
         //File Management
-        ofstream outfile;
+        OutputFormat format;
+        bool async;
+        bool compressed;
+        bool indexing;
+        unsigned int indexEventInterval;
+        unsigned int indexByteInterval;
+        size_t flightRecorderBytes;
+        FlightRecorderWriter *flightRecorder;   //The writer, when in flight recorder mode
+        static vector<Tracer *>& flightRecorders();
+        static void flightRecorderSignalHandler(int signalNumber);
+        TraceWriter *writer;
         bool initComplete;
+        static string getExtension(OutputFormat format);
         //Modules
         int moduleCount;
-        map<sc_module *, int> moduleIdMap;
+        IdMap<sc_module *, int> moduleIdMap;
         void registerAllModules();
-        void registerModule(sc_object* mod);
+        void registerModule(sc_object* mod, bool parentEnabled);
         int getModuleId(sc_module* module);
+        //Filters, and the enable bits they resolve to by file id
+        struct NameFilter{
+            vector<string> includes;
+            vector<string> excludes;
+            void add(const string &pattern);
+            //1 if name matches an include, -1 if an exclude, 0 if neither
+            int match(const string &name) const;
+        };
+        NameFilter moduleFilter;
+        NameFilter eventTypeFilter;
+        vector<bool> moduleEnabled;
+        vector<bool> eventTypeEnabled;
+        void loadFilterEnvironment();
+        void addFilterList(NameFilter &filter, const char *patterns);
         //Event Types
         int eventTypeCount;
-        map<EventType *, int> eventTypeIdMap;
-        map<string, EventType *> strEventTypeMap;
+        IdMap<EventType *, int> eventTypeIdMap;
+        IdMap<string, EventType *> strEventTypeMap;
         int registerEventType(EventType * eType);
         EventType* getStrEventType(string name);
         int getEventTypeId(EventType* eType);
+        //File event type ids indexed by declared handle id, 0 if not registered yet
+        vector<int> handleEventTypeIds;
+        int getEventTypeId(EventTypeHandle handle);
+        //Event types indexed by file id, for looking up their capture policy
+        vector<EventType *> eventTypesById;
         //Traces
         int traceCount;
-        map<Trace *, int> traceIdMap;
+        unsigned int sampleRate;
+        SampleMode sampleMode;
+        unsigned long long sampleSeed;
+        unsigned long long sampleCandidates;    //Traces seen, sampled in or out
+        bool sampleTrace();
+        IdMap<Trace *, int> traceIdMap;
         int registerTrace(Trace *trace);
+        int registerTrace(Trace *trace, bool sampled);
+        int findTraceId(Trace* trans);     //0 if the trace is new
         int getTraceId(Trace* trans);
-        void writeProperties(map<string, string> *props);
-        //tlm_generic_payload 
-        map<tlm_generic_payload *, int> tlmPayloadIdMap;
+        void markEvent(sc_module *module, Trace *trans, const sc_time &time, int eventTypeId, const map<string, string> *properties, const PropertyList *propertyList);
+        //Spans that have begun and not ended, by SpanId - 1.  Ended slots have
+        //an event type id of 0 and are reused.
+        struct OpenSpan{
+            int eventTypeId;
+            int traceId;
+            int moduleId;
+            unsigned long long time;
+            tlm_generic_payload *payload;   //0 for Trace objects
+        };
+        vector<OpenSpan> openSpans;
+        vector<SpanId> freeSpanIds;
+        SpanId beginSpanEvent(sc_module *module, tlm_generic_payload *trans, int eventTypeId);
+        SpanId beginSpanEvent(sc_module *module, Trace *trans, int eventTypeId);
+        SpanId openSpan(int eventTypeId, int traceId, int moduleId, tlm_generic_payload *payload);
+        void endSpanEvent(SpanId span, const map<string, string> *properties, const PropertyList *propertyList);
+        string getDefaultTraceName(int index);
+        DataCapture dataCapture;
+        unsigned int dataCaptureLimit;
+        //tlm_generic_payload ids are cached in a TraceIdExtension on the payload.
+        //The map is only used when another Tracer already owns the extension.
+        IdMap<tlm_generic_payload *, int> tlmPayloadIdMap;
+        void setTlmGenericPayloadId(tlm_generic_payload* trans, int index);
         int registerTrace(tlm_generic_payload *trans);
+        int registerTrace(tlm_generic_payload *trans, bool sampled);
+        int findTlmGenericPayloadId(tlm_generic_payload* trans);   //0 if the payload has no trace yet
         int getTlmGenericPayloadId(tlm_generic_payload* trans);
+        void writeLink(int kind, int fromTraceId, int toTraceId);
+        void markEvent(sc_module *module, tlm_generic_payload *trans, const sc_time &time, int eventTypeId, const map<string, string> *properties, const PropertyList *propertyList);
         void writeTlmGenericPayloadTraceProperties(tlm_generic_payload *trans);
-        void writeTlmGenericPayloadEventProperties(tlm_generic_payload *trans);
+        void writeTlmGenericPayloadEventProperties(tlm_generic_payload *trans, int eventTypeId);
+        //Latency statistics.  Open pairs are kept in a ring indexed by trace id,
+        //which works since trace ids are handed out in order.
+        struct LatencyPair{
+            string name;
+            string start;
+            string end;
+        };
+        struct LatencyPairRole{
+            int pair;
+            bool end;
+        };
+        struct LatencyPairStart{
+            unsigned long long time;    //Kept plus one, 0 when the pair is not open
+            int moduleId;
+        };
+        struct LatencyPairGroup{
+            int pair;
+            int startModuleId;
+            int endModuleId;
+            LatencyHistogram histogram;
+        };
+        bool fileOutput;
+        vector<LatencyPair> pairs;
+        vector<vector<LatencyPairRole> > pairRoles; //Indexed by file event type id, ends first
+        vector<int> pairTraceIds;                   //Trace in each ring slot
+        vector<LatencyPairStart> pairStarts;        //pairs.size() per ring slot
+        vector<vector<int> > pairGroupIds;          //Per pair, by start and end module id
+        vector<LatencyPairGroup> pairGroups;
+        unsigned long long pairsDropped;
+        vector<sc_module *> modulesById;
+        void findLatencyPairRoles(int eventTypeId);
+        void recordLatencyPairs(int traceId, int moduleId, int eventTypeId, unsigned long long time);
+        void recordLatency(int pair, int startModuleId, int endModuleId, unsigned long long latency);
+        //Waveforms.  Signals are declared in the file at the first cycle after
+        //they are traced, since the file is only opened once elaboration is done.
+        struct SignalDeclaration{
+            int id;
+            string name;
+            int width;
+        };
+        SignalTables signals;
+        int signalCount;
+        bool signalsRegistered;
+        vector<SignalDeclaration> undeclaredSignals;
+        int addSignal(const string &name, int width);
     };  
 
+#pragma mark -
+#pragma mark ScopedSpan
+    //Records a span from its construction to the end of its scope, or to
+    //end() if that is called first.  The transaction can be a payload or a
+    //Trace and the event type a handle, an EventType or a name, as for mark().
+    class ScopedSpan{
+    public:
+        template <class Transaction, class Type>
+        ScopedSpan(sc_module *module, Transaction *trans, Type etype, Tracer *tracer = Tracer::getSharedTracer()){
+            this->tracer = tracer;
+            span = Tracer::enabled ? tracer->beginSpan(module, trans, etype) : 0;
+        }
+        ~ScopedSpan(){ end(); }
+        void end(){
+            if (span) tracer->endSpan(span);
+            span = 0;
+        }
+        void end(const PropertyList &properties){
+            if (span) tracer->endSpan(span, properties);
+            span = 0;
+        }
+    private:
+        Tracer *tracer;
+        Tracer::SpanId span;
+        //Copying would end the span twice
+        ScopedSpan(const ScopedSpan &);
+        ScopedSpan& operator=(const ScopedSpan &);
+    };
+
 } //namespace lpt
 
 #endif
\ No newline at end of file
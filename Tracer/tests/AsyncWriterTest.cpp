@@ -0,0 +1,258 @@
+/*
+ *  AsyncWriterTest.cpp
+ *  LPTracer
+ *
+ *  http://www.logicpoet.com
+ *
+ *  Copyright 2008 Logic Poet. All rights reserved.
+ *
+ *  The MIT License
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without
+ *  restriction, including without limitation the rights to use,
+ *  copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following
+ *  conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *  OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+//Checks that the asynchronous writer hands the wrapped writer exactly the
+//calls it was given, in order and with the same values, whatever the buffer
+//size, and that its output files are byte for byte those of the wrapped
+//writer used directly.
+//
+//The binary and XML writers take the time resolution from SystemC, so this
+//links with it:
+//  g++ -O2 -I$SYSTEMC_HOME/include -I../source AsyncWriterTest.cpp ../source/TraceWriter.cpp ../source/TraceFile.cpp ../source/TraceIndex.cpp -L$SYSTEMC_HOME/lib-linux64 -lsystemc -lpthread -o AsyncWriterTest && ./AsyncWriterTest
+
+#include "TraceWriter.h"
+#include "TestCheck.h"
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <cstdio>
+#include <algorithm>
+
+using namespace lpt;
+
+#pragma mark -
+#pragma mark RecordingWriter
+
+//Logs every call as a line of text.  The log lives outside the writer because
+//the asynchronous writer deletes the writer it wraps.
+class RecordingWriter : public TraceWriter{
+public:
+    RecordingWriter(vector<string> *log){ this->log = log; }
+    ~RecordingWriter(){ add(); }
+    bool open(const string &filename){ add() << "open " << filename; return true; }
+    void close(){ add() << "close"; }
+    void setIndexing(unsigned int eventInterval, unsigned int byteInterval){ add() << "index " << eventInterval << " " << byteInterval; }
+    void beginModule(int id, const string &name){ add() << "module " << id << " " << name; }
+    void endModule(){ add() << "end module"; }
+    void beginEventType(int id, const string &name){ add() << "event type " << id << " " << name; }
+    void endEventType(){ add() << "end event type"; }
+    void beginTrace(int id, const string &name){ add() << "trace " << id << " " << name; }
+    void endTrace(){ add() << "end trace"; }
+    void beginEvent(int eventTypeId, int traceId, int moduleId, unsigned long long time){
+        add() << "event " << eventTypeId << " " << traceId << " " << moduleId << " " << time;
+    }
+    void beginSpan(int eventTypeId, int traceId, int moduleId, unsigned long long time, unsigned long long duration){
+        add() << "span " << eventTypeId << " " << traceId << " " << moduleId << " " << time << " " << duration;
+    }
+    void endEvent(){ add() << "end event"; }
+    void writeProperty(const PropertyText &name, const PropertyValue &value){
+        add() << "property " << name.toString() << " " << describe(value);
+    }
+    void declareSignal(int id, const string &name, int width){ add() << "signal " << id << " " << name << " " << width; }
+    void writeChange(int signalId, unsigned long long time, const PropertyValue &value){
+        add() << "change " << signalId << " " << time << " " << describe(value);
+    }
+    void writeLink(int kind, int fromTraceId, int toTraceId, unsigned long long time){
+        add() << "link " << kind << " " << fromTraceId << " " << toTraceId << " " << time;
+    }
+    void retireTrace(int traceId){ add() << "retire " << traceId; }
+protected:
+    vector<string> *log;
+    std::ostringstream line;
+    //Starts a new line, the previous one is complete by now
+    std::ostringstream& add(){
+        if (!line.str().empty()) log->push_back(line.str());
+        line.str("");
+        return line;
+    }
+    //Type and text of a value, so a value that changed type shows up
+    static string describe(const PropertyValue &value){
+        vector<char> buffer(value.length*2 + 64);
+        PropertyText text = value.format(&buffer[0], buffer.size());
+        std::ostringstream out;
+        out << value.type << ":" << text.toString();
+        return out.str();
+    }
+};
+
+#pragma mark -
+#pragma mark Writing
+
+static void writeRecords(TraceWriter &writer, int traces){
+    writer.beginModule(1, "top");
+    writer.beginModule(2, "bus");
+    writer.endModule();
+    writer.endModule();
+    writer.beginEventType(1, "Request");
+    writer.writeProperty("Category", "tlm");
+    writer.endEventType();
+    writer.declareSignal(1, "top.count", 8);
+    //Longer than a buffer's worth of records, so the string arena grows
+    string longText(5000, 'x');
+    unsigned char data[5] = {0x00, 0x01, 0x7F, 0x80, 0xFF};
+    for (int i = 0; i < traces; i++){
+        unsigned long long time = i * 10ULL;
+        char name[16];
+        snprintf(name, sizeof(name), "T%d", i + 1);
+        writer.beginTrace(i + 1, name);
+        writer.writeProperty("Index", i);
+        writer.endTrace();
+        writer.beginEvent(1, i + 1, 2, time);
+        writer.writeProperty("Signed", -1234567890123LL * i);
+        writer.writeProperty("Unsigned", 18446744073709551615ULL);
+        writer.writeProperty("Ratio", 1.0 / (i + 1));
+        writer.writeProperty("Flag", i % 2 == 0);
+        writer.writeProperty("Data", PropertyValue::blob(data, sizeof(data)));
+        if (i % 50 == 0) writer.writeProperty(longText, longText);
+        writer.endEvent();
+        writer.writeChange(1, time, (i % 3) ? PropertyValue(i) : PropertyValue(0.5 * i));
+        writer.beginSpan(1, i + 1, 1, time + 1, 7);
+        writer.endEvent();
+        if (i > 0) writer.writeLink(i % 2 ? LINK_CHILD : LINK_MERGE, i, i + 1, time);
+        writer.retireTrace(i + 1);
+    }
+}
+
+static string readFile(const string &filename){
+    std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+    return string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+#pragma mark -
+#pragma mark Tests
+
+//The wrapped writer sees the same calls as a writer used directly, whether
+//the buffers swap after every record or never
+static void testSameCalls(){
+    vector<string> expected;
+    RecordingWriter *direct = new RecordingWriter(&expected);
+    direct->setIndexing(16, 4096);
+    direct->open("calls");
+    writeRecords(*direct, 500);
+    direct->close();
+    delete direct;
+
+    unsigned int sizes[] = {1, 2, 7, 1000, 65536};
+    for (size_t i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++){
+        vector<string> log;
+        AsyncTraceWriter *writer = new AsyncTraceWriter(new RecordingWriter(&log), sizes[i]);
+        writer->setIndexing(16, 4096);
+        CHECK(writer->open("calls"));
+        writeRecords(*writer, 500);
+        writer->close();
+        delete writer;
+        CHECK_EQUAL(log.size(), expected.size());
+        size_t first = 0;
+        while (first < log.size() && first < expected.size() && log[first] == expected[first]) first++;
+        if (first < log.size() && first < expected.size()){
+            printf("With %u records a buffer, call %u differs:\n  %s\n  %s\n", sizes[i], (unsigned int)first, log[first].c_str(), expected[first].c_str());
+        }
+        CHECK(log == expected);
+    }
+}
+
+//Exposes how far the string arenas grew
+class ArenaProbe : public AsyncTraceWriter{
+public:
+    ArenaProbe(TraceWriter *target, size_t bufferBytes) : AsyncTraceWriter(target, 65536, bufferBytes) {}
+    size_t getArenaCapacity(){ return std::max(buffers[0].strings.capacity(), buffers[1].strings.capacity()); }
+};
+
+//Buffers also swap when their string arena reaches its byte budget, which
+//only the long property goes past, and the calls still arrive unchanged
+static void testArenaBudget(){
+    vector<string> expected;
+    RecordingWriter *direct = new RecordingWriter(&expected);
+    direct->open("calls");
+    writeRecords(*direct, 500);
+    direct->close();
+    delete direct;
+
+    size_t budgets[] = {1, 4096, 16384};
+    for (size_t i = 0; i < sizeof(budgets)/sizeof(budgets[0]); i++){
+        vector<string> log;
+        ArenaProbe *writer = new ArenaProbe(new RecordingWriter(&log), budgets[i]);
+        CHECK(writer->open("calls"));
+        writeRecords(*writer, 500);
+        writer->close();
+        //The long property's name and value are 10000 bytes, growth may double it
+        CHECK(writer->getArenaCapacity() <= 2 * (budgets[i] + 10100));
+        delete writer;
+        CHECK(log == expected);
+    }
+}
+
+//Deleting the writer without closing it still writes everything queued
+static void testDeleteDrains(){
+    vector<string> log;
+    AsyncTraceWriter *writer = new AsyncTraceWriter(new RecordingWriter(&log), 3);
+    CHECK(writer->open("calls"));
+    writeRecords(*writer, 20);
+    delete writer;
+    CHECK(log.size() > 20 * 10);
+    CHECK(!log.empty() && log.back() == "close");
+    CHECK(!log.empty() && log[log.size()-2] == "retire 20");
+}
+
+//Writes through a wrapped writer and directly and compares the files and indexes
+static void testSameFile(TraceWriter *direct, TraceWriter *wrapped, const string &filename){
+    string asyncName = "Async-" + filename;
+    direct->setIndexing(8, 4096);
+    CHECK(direct->open(filename));
+    writeRecords(*direct, 2000);
+    direct->close();
+    delete direct;
+    AsyncTraceWriter *writer = new AsyncTraceWriter(wrapped, 5);
+    writer->setIndexing(8, 4096);
+    CHECK(writer->open(asyncName));
+    writeRecords(*writer, 2000);
+    writer->close();
+    delete writer;
+
+    string expected = readFile(filename);
+    CHECK(expected.size() > 100000);
+    CHECK(readFile(asyncName) == expected);
+    CHECK(readFile(asyncName + ".idx") == readFile(filename + ".idx"));
+    remove(filename.c_str());
+    remove((filename + ".idx").c_str());
+    remove(asyncName.c_str());
+    remove((asyncName + ".idx").c_str());
+}
+
+int sc_main(int, char *[]){
+    testSameCalls();
+    testArenaBudget();
+    testDeleteDrains();
+    testSameFile(new BinaryTraceWriter(), new BinaryTraceWriter(), "AsyncWriterTest.scnb");
+    testSameFile(new XmlTraceWriter(), new XmlTraceWriter(), "AsyncWriterTest.scnx");
+    return testResult("AsyncWriterTest");
+}
@@ -0,0 +1,219 @@
+/*
+ *  FilterTest.cpp
+ *  LPTracer
+ *
+ *  http://www.logicpoet.com
+ *
+ *  Copyright 2008 Logic Poet. All rights reserved.
+ *
+ *  The MIT License
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without
+ *  restriction, including without limitation the rights to use,
+ *  copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following
+ *  conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *  OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+//Checks module and event type filters through the trace file a Tracer
+//writes: module patterns cover subtrees with deeper matches overriding them,
+//! excludes, * and ? glob as documented, filter files and the environment
+//variables give the same results as the API, and filters added after the
+//first event are ignored.
+//
+//Links with SystemC, the Tracer and the reader library:
+//  g++ -O2 -I$SYSTEMC_HOME/include -I../source -I../reader FilterTest.cpp ../source/Tracer.cpp ../source/TraceWriter.cpp ../source/TraceFile.cpp ../source/TraceIndex.cpp ../reader/TraceReader.cpp -L$SYSTEMC_HOME/lib-linux64 -lsystemc -lpthread -o FilterTest && ./FilterTest
+
+#include "Tracer.h"
+#include "TraceReader.h"
+#include "TestCheck.h"
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace lpt;
+using std::set;
+
+static const char *FILENAME = "FilterTest.scnb";
+static const char *EVENT_TYPES[] = {"Request", "Response", "DebugRead", "DebugWrite"};
+static const int EVENT_TYPE_COUNT = 4;
+
+#pragma mark -
+#pragma mark Model
+
+//top
+//  bus
+//    arbiter
+//    decoder
+//  cpu
+struct Leaf : sc_module{
+    Leaf(sc_module_name name) : sc_module(name) {}
+};
+struct Bus : sc_module{
+    Leaf arbiter, decoder;
+    Bus(sc_module_name name) : sc_module(name), arbiter("arbiter"), decoder("decoder") {}
+};
+struct Top : sc_module{
+    Bus bus;
+    Leaf cpu;
+    Top(sc_module_name name) : sc_module(name), bus("bus"), cpu("cpu") {}
+};
+
+static Top *top;
+
+#pragma mark -
+#pragma mark Recording
+
+//Marks every event type from every module, each on a trace of its own, and
+//returns "module:event type" for each event in the file
+static set<string> record(Tracer *tracer){
+    sc_module *modules[] = {top, &top->bus, &top->bus.arbiter, &top->bus.decoder, &top->cpu};
+    for (size_t i = 0; i < sizeof(modules)/sizeof(modules[0]); i++){
+        for (int j = 0; j < EVENT_TYPE_COUNT; j++){
+            Trace trace;
+            tracer->mark(modules[i], &trace, EVENT_TYPES[j]);
+            tracer->retireTrace(&trace);
+        }
+    }
+    delete tracer;
+
+    set<string> events;
+    TraceReader reader;
+    CHECK(reader.open(FILENAME));
+    TraceRecord record;
+    while (reader.next(record)){
+        if (record.kind != RECORD_EVENT) continue;
+        const EventTypeInfo *type = reader.getEventType(record.eventTypeId);
+        events.insert(reader.getModulePath(record.moduleId) + ":" + (type ? type->name.str() : "?"));
+    }
+    CHECK(reader.getError().empty());
+    remove(FILENAME);
+    return events;
+}
+
+//Every event type from the given modules, or every module from the given
+//event types, as record() returns them
+static set<string> expect(const char *modules, const char *eventTypes){
+    const char *allModules = "top top.bus top.bus.arbiter top.bus.decoder top.cpu";
+    string moduleList = modules ? modules : allModules;
+    string typeList = eventTypes ? eventTypes : "Request Response DebugRead DebugWrite";
+    set<string> events;
+    std::istringstream moduleWords(moduleList);
+    string module;
+    while (moduleWords >> module){
+        std::istringstream typeWords(typeList);
+        string type;
+        while (typeWords >> type) events.insert(module + ":" + type);
+    }
+    return events;
+}
+
+//A Tracer with the given module and event type patterns, space separated
+static Tracer* filtered(const char *modules, const char *eventTypes){
+    Tracer *tracer = new Tracer((char *)FILENAME);
+    std::istringstream moduleWords(modules ? modules : "");
+    std::istringstream typeWords(eventTypes ? eventTypes : "");
+    string pattern;
+    while (moduleWords >> pattern) tracer->addModuleFilter(pattern);
+    while (typeWords >> pattern) tracer->addEventTypeFilter(pattern);
+    return tracer;
+}
+
+#pragma mark -
+#pragma mark Tests
+
+static void testModules(){
+    CHECK(record(filtered(0, 0)) == expect(0, 0));
+    //A pattern covers the subtree
+    CHECK(record(filtered("top.bus", 0)) == expect("top.bus top.bus.arbiter top.bus.decoder", 0));
+    //A deeper exclude overrides it, in either order
+    CHECK(record(filtered("top.bus !top.bus.arbiter", 0)) == expect("top.bus top.bus.decoder", 0));
+    CHECK(record(filtered("!top.bus.arbiter top.bus", 0)) == expect("top.bus top.bus.decoder", 0));
+    //Only excludes record everything else
+    CHECK(record(filtered("!top.bus", 0)) == expect("top top.cpu", 0));
+    CHECK(record(filtered("!top.bus*", 0)) == expect("top top.cpu", 0));
+    //A deeper include inside an excluded subtree
+    CHECK(record(filtered("top !top.bus top.bus.decoder", 0)) == expect("top top.bus.decoder top.cpu", 0));
+    //? is exactly one character, and the children of a match inherit it
+    CHECK(record(filtered("top.???", 0)) == expect("top.bus top.bus.arbiter top.bus.decoder top.cpu", 0));
+    CHECK(record(filtered("top.?", 0)).empty());
+    CHECK(record(filtered("*.*der", 0)) == expect("top.bus.decoder", 0));
+}
+
+static void testEventTypes(){
+    CHECK(record(filtered(0, "!Debug*")) == expect(0, "Request Response"));
+    CHECK(record(filtered(0, "Re?uest")) == expect(0, "Request"));
+    CHECK(record(filtered(0, "Debug????? Request")) == expect(0, "DebugWrite Request"));
+    CHECK(record(filtered(0, "*e* !*Write")) == expect(0, "Request Response DebugRead"));
+    //Both filters must pass
+    CHECK(record(filtered("top.cpu", "Re*")) == expect("top.cpu", "Request Response"));
+}
+
+static void testFilterFile(){
+    std::ofstream file("FilterTest.filters");
+    file << "# Only the bus, without its arbiter\n"
+         << "module top.bus\n"
+         << "module !top.bus.arbiter   # a trailing comment\n"
+         << "\n"
+         << "eventtype !Debug*\n";
+    file.close();
+    Tracer *tracer = new Tracer((char *)FILENAME);
+    CHECK(tracer->loadFilterFile("FilterTest.filters"));
+    CHECK(record(tracer) == expect("top.bus top.bus.decoder", "Request Response"));
+    remove("FilterTest.filters");
+
+    //Reports the missing file and records everything
+    tracer = new Tracer((char *)FILENAME);
+    CHECK(!tracer->loadFilterFile("FilterTest.missing"));
+    CHECK(record(tracer) == expect(0, 0));
+}
+
+//The environment is read at the first event and adds to the API's filters
+static void testEnvironment(){
+    setenv("LPTRACE_MODULES", "top.bus,!top.bus.arbiter", 1);
+    setenv("LPTRACE_EVENTTYPES", "Request", 1);
+    CHECK(record(filtered(0, "Response")) == expect("top.bus top.bus.decoder", "Request Response"));
+    unsetenv("LPTRACE_MODULES");
+    unsetenv("LPTRACE_EVENTTYPES");
+    CHECK(record(filtered(0, 0)) == expect(0, 0));
+}
+
+//Filters are resolved as modules and event types register, so late ones are
+//refused with a warning rather than applied to part of the trace
+static void testLateFilters(){
+    Tracer *tracer = new Tracer((char *)FILENAME);
+    Trace trace;
+    tracer->mark(&top->cpu, &trace, "Request");
+    tracer->retireTrace(&trace);
+    tracer->addModuleFilter("top.bus");
+    tracer->addEventTypeFilter("!Request");
+    set<string> events = record(tracer);
+    CHECK(events == expect(0, 0));
+}
+
+int sc_main(int, char *[]){
+    top = new Top("top");
+    testModules();
+    testEventTypes();
+    testFilterFile();
+    testEnvironment();
+    testLateFilters();
+    return testResult("FilterTest");
+}
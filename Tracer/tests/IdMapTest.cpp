@@ -0,0 +1,165 @@
+/*
+ *  IdMapTest.cpp
+ *  LPTracer
+ *
+ *  http://www.logicpoet.com
+ *
+ *  Copyright 2008 Logic Poet. All rights reserved.
+ *
+ *  The MIT License
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without
+ *  restriction, including without limitation the rights to use,
+ *  copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following
+ *  conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *  OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+//Checks IdMap against std::map through long runs of random inserts,
+//overwrites and erases, so lookups have to probe past tombstones and the table
+//is rehashed both to grow and to clear tombstones out.  Also checks that a
+//steady churn of traces being retired and registered doesn't grow the table.
+//
+//This does not need SystemC.  Build and run with:
+//  g++ -O2 -I../source IdMapTest.cpp -o IdMapTest && ./IdMapTest
+
+#include "IdMap.h"
+#include "TestCheck.h"
+#include <map>
+#include <cstdlib>
+
+using lpt::IdMap;
+
+//Exposes the table size
+template <class Key, class Value>
+class CheckedIdMap : public IdMap<Key, Value>{
+public:
+    size_t capacity() const { return this->slots.size(); }
+};
+
+struct Payload{ int data; };
+
+//Every key in the oracle is found with its value, and the sizes agree
+template <class Key>
+static bool sameContents(CheckedIdMap<Key, int> &map, std::map<Key, int> &oracle){
+    if (map.size() != oracle.size()) return false;
+    typename std::map<Key, int>::iterator iter;
+    for (iter = oracle.begin(); iter != oracle.end(); iter++){
+        int *value = map.find(iter->first);
+        if (!value || *value != iter->second) return false;
+    }
+    return true;
+}
+
+static void testRandomOperations(){
+    const int keyCount = 5000;
+    vector<Payload> payloads(keyCount);
+    CheckedIdMap<Payload *, int> map;
+    std::map<Payload *, int> oracle;
+    srand(1);
+    bool agreed = true;
+    for (int i = 0; i < 400000 && agreed; i++){
+        Payload *key = &payloads[rand() % keyCount];
+        switch (rand() % 3){
+            case 0:
+            case 1:
+                map.insert(key, i);
+                oracle[key] = i;
+                break;
+            default:
+                agreed = (map.erase(key) == (oracle.erase(key) == 1));
+                break;
+        }
+        int *found = map.find(key);
+        std::map<Payload *, int>::iterator expected = oracle.find(key);
+        if (expected == oracle.end()) agreed = agreed && !found;
+        else agreed = agreed && found && *found == expected->second;
+        if (i % 50000 == 0) agreed = agreed && sameContents(map, oracle);
+    }
+    CHECK(agreed);
+    CHECK(sameContents(map, oracle));
+}
+
+static void testEraseEverything(){
+    vector<Payload> payloads(1000);
+    CheckedIdMap<Payload *, int> map;
+    for (size_t i = 0; i < payloads.size(); i++) map.insert(&payloads[i], (int)i + 1);
+    CHECK_EQUAL(map.size(), payloads.size());
+    for (size_t i = 0; i < payloads.size(); i += 2) CHECK(map.erase(&payloads[i]));
+    //Odd keys sit behind tombstones left by the even ones
+    bool found = true;
+    for (size_t i = 1; i < payloads.size(); i += 2){
+        int *value = map.find(&payloads[i]);
+        found = found && value && *value == (int)i + 1;
+    }
+    CHECK(found);
+    for (size_t i = 1; i < payloads.size(); i += 2) CHECK(map.erase(&payloads[i]));
+    CHECK_EQUAL(map.size(), (size_t)0);
+    CHECK(!map.erase(&payloads[0]));
+    bool empty = true;
+    for (size_t i = 0; i < payloads.size(); i++) empty = empty && !map.find(&payloads[i]);
+    CHECK(empty);
+}
+
+static void testChurnDoesNotGrow(){
+    //Like a model recycling its payloads: a fixed number live, each retired
+    //and registered again under a new id over and over
+    const int live = 300;
+    vector<Payload> payloads(live * 50);
+    CheckedIdMap<Payload *, int> map;
+    for (int i = 0; i < live; i++) map.insert(&payloads[i], i);
+    size_t capacity = map.capacity();
+    bool intact = true;
+    for (int round = 0; round < 200000; round++){
+        int retired = round % (int)payloads.size();
+        int added = (round + live) % (int)payloads.size();
+        map.erase(&payloads[retired]);
+        map.insert(&payloads[added], round);
+        intact = intact && map.size() == (size_t)live && map.find(&payloads[added]);
+    }
+    CHECK(intact);
+    //Tombstones are cleared by rehashing in place rather than by doubling
+    CHECK(map.capacity() <= capacity * 2);
+}
+
+static void testStringKeys(){
+    CheckedIdMap<string, int> map;
+    std::map<string, int> oracle;
+    char name[32];
+    for (int i = 0; i < 2000; i++){
+        snprintf(name, sizeof(name), "Event Type %d", i % 700);
+        if (i % 5 == 4){
+            map.erase(name);
+            oracle.erase(name);
+        }
+        else {
+            map.insert(name, i);
+            oracle[name] = i;
+        }
+    }
+    CHECK(sameContents(map, oracle));
+    CHECK(!map.find(""));
+}
+
+int main(){
+    testRandomOperations();
+    testEraseEverything();
+    testChurnDoesNotGrow();
+    testStringKeys();
+    return testResult("IdMapTest");
+}
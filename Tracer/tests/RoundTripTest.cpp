@@ -0,0 +1,599 @@
+/*
+ *  RoundTripTest.cpp
+ *  LPTracer
+ *
+ *  http://www.logicpoet.com
+ *
+ *  Copyright 2008 Logic Poet. All rights reserved.
+ *
+ *  The MIT License
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without
+ *  restriction, including without limitation the rights to use,
+ *  copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following
+ *  conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *  OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+//Writes the same records through each trace writer and reads them back with
+//the reader library: XML and binary must read back identically, compressed
+//or not, with the values and types that were written; the index must lead
+//to the right records; a flight recorder dump must hold the latest records;
+//and Chrome output must be valid JSON with every flow arrow complete.
+//
+//The writers take the time resolution from SystemC, so this links with it:
+//  g++ -O2 -I$SYSTEMC_HOME/include -I../source -I../reader RoundTripTest.cpp ../source/TraceWriter.cpp ../source/TraceFile.cpp ../source/TraceIndex.cpp ../reader/TraceReader.cpp ../reader/IndexReader.cpp ../reader/ParallelTraceReader.cpp -L$SYSTEMC_HOME/lib-linux64 -lsystemc -lpthread -o RoundTripTest && ./RoundTripTest
+//Add -DLPTRACE_ZLIB and -lz to check compressed traces as well.
+
+#include "TraceWriter.h"
+#include "TraceReader.h"
+#include "IndexReader.h"
+#include "ParallelTraceReader.h"
+#include "TestCheck.h"
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <cstdio>
+
+using namespace lpt;
+
+static const int TRACES = 3000;
+//Every trace has an event, a span and a short event
+static const int EVENTS = TRACES * 3;
+static const int LINKS = TRACES / 10 - 1;
+static const int CHANGES = (TRACES + 6) / 7;
+
+#pragma mark -
+#pragma mark Writing
+
+static void writeRecords(TraceWriter &writer){
+    writer.beginModule(1, "top");
+    writer.beginModule(2, "bus");
+    writer.endModule();
+    writer.endModule();
+    writer.beginModule(3, "mem");
+    writer.endModule();
+    writer.beginEventType(1, "Request");
+    writer.writeProperty("Category", "tlm");
+    writer.endEventType();
+    writer.beginEventType(2, "Response");
+    writer.endEventType();
+    writer.declareSignal(1, "top.count", 8);
+    unsigned char data[4] = {0xDE, 0xAD, 0x00, 0x0F};
+    for (int i = 0; i < TRACES; i++){
+        unsigned long long time = i * 1000ULL;
+        char name[16];
+        snprintf(name, sizeof(name), "T%d", i + 1);
+        writer.beginTrace(i + 1, name);
+        writer.writeProperty("Address", (long long)i * 64);
+        writer.writeProperty("Command", (i % 2) ? "Read" : "Write");
+        writer.endTrace();
+        //Child links come before the trace's first event, merges after it
+        if (i % 20 == 10) writer.writeLink(LINK_CHILD, i, i + 1, time);
+        writer.beginEvent(1, i + 1, 2, time);
+        writer.writeProperty("Length", 4);
+        writer.writeProperty("Offset", -i);
+        writer.writeProperty("Ratio", 0.25 * i);
+        writer.writeProperty("Ok", i % 3 == 0);
+        writer.writeProperty("Data", PropertyValue::blob(data, sizeof(data)));
+        writer.endEvent();
+        if (i % 7 == 0) writer.writeChange(1, time, i % 256);
+        //Spans end after the next trace starts, so event times in the file are not in order
+        writer.beginSpan(2, i + 1, 3, time + 100, 1200);
+        writer.writeProperty("Status", "TLM_OK_RESPONSE");
+        writer.endEvent();
+        if (i > 0 && i % 20 == 0) writer.writeLink(LINK_MERGE, i, i + 1, time);
+        writer.beginEvent(2, i + 1, 3, time + 500);
+        writer.endEvent();
+        writer.retireTrace(i + 1);
+    }
+}
+
+//An index entry every indexInterval events, none for 0
+static bool writeFile(TraceWriter *writer, const string &filename, unsigned int indexInterval = 0){
+    if (indexInterval) writer->setIndexing(indexInterval, 1 << 20);
+    bool opened = writer->open(filename);
+    if (opened){
+        writeRecords(*writer);
+        writer->close();
+    }
+    delete writer;
+    return opened;
+}
+
+#pragma mark -
+#pragma mark Reading
+
+//One line per record with the fields TraceRecord documents for its kind,
+//properties as text
+static string describe(const TraceRecord &record){
+    std::ostringstream out;
+    out << record.kind << " id=" << record.id;
+    switch (record.kind){
+        case RECORD_MODULE_BEGIN:
+            out << " parent=" << record.parentId << " name=" << record.name.str();
+            break;
+        case RECORD_EVENTTYPE:
+        case RECORD_TRACE:
+            out << " name=" << record.name.str();
+            break;
+        case RECORD_SIGNAL:
+            out << " name=" << record.name.str() << " width=" << record.width;
+            break;
+        case RECORD_EVENT:
+            out << " type=" << record.eventTypeId << " trace=" << record.traceId << " module=" << record.moduleId
+                << " time=" << record.time << " span=" << record.span;
+            if (record.span) out << " duration=" << record.duration;
+            break;
+        case RECORD_CHANGE:
+            out << " time=" << record.time;
+            break;
+        case RECORD_LINK:
+            out << " from=" << record.parentId << " to=" << record.traceId << " time=" << record.time;
+            break;
+        default:
+            break;
+    }
+    for (size_t i = 0; i < record.properties.size(); i++){
+        out << " " << record.properties[i].name.str() << "=" << record.properties[i].toString();
+    }
+    return out.str();
+}
+
+static bool readLines(const string &filename, vector<string> &lines, unsigned int threads = 1){
+    TraceReader reader;
+    lines.clear();
+    if (!reader.open(filename, threads)){
+        printf("%s\n", reader.getError().c_str());
+        return false;
+    }
+    TraceRecord record;
+    while (reader.next(record)) lines.push_back(describe(record));
+    if (!reader.getError().empty()){
+        printf("%s: %s\n", filename.c_str(), reader.getError().c_str());
+        return false;
+    }
+    return true;
+}
+
+//Prints the first difference so a failure says where to look
+static bool sameLines(const vector<string> &actual, const vector<string> &expected, const string &what){
+    for (size_t i = 0; i < actual.size() && i < expected.size(); i++){
+        if (actual[i] != expected[i]){
+            printf("%s differs at record %u:\n  %s\n  %s\n", what.c_str(), (unsigned int)i, actual[i].c_str(), expected[i].c_str());
+            return false;
+        }
+    }
+    if (actual.size() != expected.size()){
+        printf("%s has %u records, expected %u\n", what.c_str(), (unsigned int)actual.size(), (unsigned int)expected.size());
+        return false;
+    }
+    return true;
+}
+
+static string readFile(const string &filename){
+    std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+    return string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+#pragma mark -
+#pragma mark Tests
+
+static void testContents(const string &filename, bool typed){
+    TraceReader reader;
+    CHECK(reader.open(filename));
+    CHECK(reader.getResolution() > 0);
+    TraceRecord record;
+    int events = 0, spans = 0, links = 0, merges = 0, changes = 0, traces = 0;
+    bool eventsRight = true, tracesRight = true, changesRight = true, linksRight = true;
+    while (reader.next(record)){
+        switch (record.kind){
+            case RECORD_TRACE: {
+                traces++;
+                long long address;
+                const PropertyRef *property = record.findProperty("Address");
+                tracesRight = tracesRight && property && property->getInt(address) && address == (record.id - 1) * 64LL;
+                property = record.findProperty("Command");
+                tracesRight = tracesRight && property && property->toString() == ((record.id % 2) ? "Write" : "Read");
+                break;
+            }
+            case RECORD_EVENT: {
+                unsigned long long time = (record.traceId - 1) * 1000ULL;
+                if (record.span){
+                    spans++;
+                    eventsRight = eventsRight && record.eventTypeId == 2 && record.time == time + 100 && record.duration == 1200;
+                    break;
+                }
+                events++;
+                if (record.eventTypeId == 2){
+                    eventsRight = eventsRight && record.time == time + 500 && record.properties.empty();
+                    break;
+                }
+                long long length, offset;
+                double ratio;
+                bool ok;
+                const PropertyRef *data = record.findProperty("Data");
+                eventsRight = eventsRight && record.time == time && record.moduleId == 2
+                    && record.findProperty("Length") && record.findProperty("Length")->getInt(length) && length == 4
+                    && record.findProperty("Offset") && record.findProperty("Offset")->getInt(offset) && offset == 1 - record.traceId
+                    && record.findProperty("Ratio") && record.findProperty("Ratio")->getDouble(ratio) && ratio == 0.25 * (record.traceId - 1)
+                    && record.findProperty("Ok") && record.findProperty("Ok")->getBool(ok) && ok == ((record.traceId - 1) % 3 == 0)
+                    && data;
+                if (typed && data){
+                    eventsRight = eventsRight && record.findProperty("Length")->type == PROPERTY_INT
+                        && record.findProperty("Ratio")->type == PROPERTY_DOUBLE && record.findProperty("Ok")->type == PROPERTY_BOOL
+                        && data->type == PROPERTY_BLOB && data->text.length == 4 && (unsigned char)data->text.data[0] == 0xDE;
+                }
+                break;
+            }
+            case RECORD_CHANGE: {
+                changes++;
+                long long value;
+                changesRight = changesRight && record.id == 1 && record.properties.size() == 1
+                    && record.properties[0].getInt(value) && value == (long long)((record.time / 1000) % 256);
+                break;
+            }
+            case RECORD_LINK:
+                links++;
+                if (record.id == LINK_MERGE) merges++;
+                linksRight = linksRight && record.traceId == record.parentId + 1 && record.time == record.parentId * 1000ULL;
+                break;
+            default:
+                break;
+        }
+    }
+    CHECK(reader.getError().empty());
+    CHECK_EQUAL(traces, TRACES);
+    CHECK_EQUAL(events, TRACES * 2);
+    CHECK_EQUAL(spans, TRACES);
+    CHECK_EQUAL(changes, CHANGES);
+    CHECK_EQUAL(links, LINKS);
+    CHECK_EQUAL(merges, LINKS / 2);
+    CHECK(tracesRight);
+    CHECK(eventsRight);
+    CHECK(changesRight);
+    CHECK(linksRight);
+    CHECK_EQUAL(reader.getModulePath(2), string("top.bus"));
+    CHECK(reader.getEventType(1) && reader.getEventType(1)->name == "Request");
+    CHECK(reader.getSignal(1) && reader.getSignal(1)->width == 8);
+}
+
+//Seeks to the entry findTime gives for a time and checks that reading from
+//there finds the events of every trace that starts at or after that time
+static void testIndex(const string &filename){
+    IndexReader index;
+    CHECK(index.open(filename + ".idx"));
+    CHECK_EQUAL(index.getEventCount(), (unsigned long long)EVENTS);
+    const vector<IndexReader::Entry> &entries = index.getEntries();
+    CHECK(entries.size() >= (size_t)(EVENTS / 64) && entries.size() <= (size_t)EVENTS);
+    bool sorted = true;
+    for (size_t i = 1; i < entries.size(); i++) sorted = sorted && entries[i-1].time <= entries[i].time;
+    CHECK(sorted);
+
+    TraceReader reader;
+    CHECK(reader.open(filename));
+    const vector<string> &keys = index.getKeys();
+    for (size_t id = 1; id < keys.size(); id++) reader.setKey((int)id, StringRef(keys[id].data(), keys[id].size()));
+    TraceRecord record;
+    bool found = true;
+    for (unsigned long long time = 0; time < TRACES * 1000ULL; time += 97531){
+        size_t entry = index.findTime(time);
+        CHECK(reader.seek(entries[entry].position));
+        //Events of the traces from time on: two events and a span each
+        int expected = (int)(TRACES - (time + 999) / 1000) * 3;
+        unsigned long long firstTrace = (time + 999) / 1000 + 1;
+        int seen = 0;
+        while (reader.next(record)){
+            if (record.kind == RECORD_EVENT && (unsigned long long)record.traceId >= firstTrace) seen++;
+        }
+        found = found && seen == expected;
+    }
+    CHECK(found);
+
+    //Trace records can be read directly
+    bool traces = true;
+    for (int id = 1; id <= TRACES; id += 311){
+        TracePosition position;
+        traces = traces && index.getTraceStart(id, position) && reader.readAt(position, record)
+            && record.kind == RECORD_TRACE && record.id == id;
+    }
+    CHECK(traces);
+    TracePosition position;
+    CHECK(index.getEventTypeStart(2, position) && reader.readAt(position, record) && record.kind == RECORD_EVENTTYPE && record.id == 2);
+}
+
+//Counts the events a thread sees and those whose module and event type its
+//chunk resolves
+class ResolvingVisitor : public ChunkVisitor{
+public:
+    ResolvingVisitor(){ events = 0; resolved = 0; }
+    void visit(const TraceRecord &record, TraceReader &chunk){
+        if (record.kind != RECORD_EVENT) return;
+        events++;
+        if (chunk.getEventType(record.eventTypeId) && chunk.getModule(record.moduleId)) resolved++;
+    }
+    int events, resolved;
+};
+
+static void testParallel(const string &filename){
+    ParallelTraceReader reader;
+    CHECK(reader.open(filename, 4));
+    vector<EventSummary> events;
+    CHECK(reader.readEvents(events));
+    CHECK_EQUAL(events.size(), (size_t)EVENTS);
+    bool ordered = true;
+    for (size_t i = 1; i < events.size(); i++) ordered = ordered && events[i-1].time <= events[i].time;
+    CHECK(ordered);
+
+    //Every chunk finds the modules and event types from the head of the file,
+    //and afterwards the tables hold every trace.  Only the XML trace is big
+    //enough to be cut into chunks.
+    ParallelTraceReader visited;
+    CHECK(visited.open(filename, 4));
+    if (filename == "RoundTripTest.scnx") CHECK(visited.getChunkCount() > 1);
+    ResolvingVisitor visitors[4];
+    vector<ChunkVisitor *> list;
+    for (int i = 0; i < 4; i++) list.push_back(&visitors[i]);
+    CHECK(visited.read(list));
+    int seen = 0, resolved = 0;
+    for (int i = 0; i < 4; i++){
+        seen += visitors[i].events;
+        resolved += visitors[i].resolved;
+    }
+    CHECK_EQUAL(seen, EVENTS);
+    CHECK_EQUAL(resolved, EVENTS);
+    CHECK_EQUAL(visited.getReader().getTraceCount(), TRACES);
+}
+
+static void testFlightRecorder(const vector<string> &expected){
+    //A ring that holds everything dumps the whole trace
+    FlightRecorderWriter *writer = new FlightRecorderWriter(64 << 20);
+    CHECK(writer->open("RoundTripTest-ring.scnb"));
+    writeRecords(*writer);
+    CHECK_EQUAL(writer->getDroppedCount(), 0ULL);
+    CHECK(writer->dump("RoundTripTest-ring.scnb"));
+    delete writer;
+    vector<string> lines;
+    CHECK(readLines("RoundTripTest-ring.scnb", lines));
+    CHECK(sameLines(lines, expected, "Full flight recorder dump"));
+
+    //A small ring keeps the latest records.  The traces whose records it
+    //dropped are written from the copies kept apart, so every event can find
+    //its trace with its name, and all can find their event type.
+    writer = new FlightRecorderWriter(32 << 10);
+    CHECK(writer->open("RoundTripTest-ring.scnb"));
+    writeRecords(*writer);
+    CHECK(writer->getDroppedCount() > 0);
+    CHECK_EQUAL(writer->getSkippedCount(), 0ULL);
+    writer->close();
+    delete writer;
+    TraceReader reader;
+    CHECK(reader.open("RoundTripTest-ring.scnb"));
+    TraceRecord record;
+    int events = 0;
+    int firstTrace = 0, lastTrace = 0;
+    bool resolved = true;
+    while (reader.next(record)){
+        if (record.kind == RECORD_TRACE && !firstTrace) firstTrace = record.id;
+        if (record.kind != RECORD_EVENT) continue;
+        events++;
+        lastTrace = record.traceId;
+        char name[16];
+        snprintf(name, sizeof(name), "T%d", record.traceId);
+        const TraceInfo *trace = reader.getTrace(record.traceId);
+        resolved = resolved && reader.getEventType(record.eventTypeId) && trace && trace->name.str() == name;
+    }
+    CHECK(reader.getError().empty());
+    CHECK(events > 0 && events < EVENTS);
+    CHECK(firstTrace > 1);
+    CHECK_EQUAL(lastTrace, TRACES);
+    CHECK(resolved);
+
+    //Property names past the key table are left out and counted
+    writer = new FlightRecorderWriter(1 << 20);
+    CHECK(writer->open("RoundTripTest-ring.scnb"));
+    writer->beginEventType(1, "Request");
+    writer->endEventType();
+    writer->beginTrace(1, "T1");
+    writer->endTrace();
+    writer->beginEvent(1, 1, 0, 0);
+    for (unsigned int i = 0; i < FLIGHT_KEYS + 10; i++){
+        char key[16];
+        snprintf(key, sizeof(key), "K%u", i);
+        writer->writeProperty(key, (long long)i);
+    }
+    writer->writeProperty(string(FLIGHT_KEY_LENGTH + 1, 'L'), 1);
+    writer->endEvent();
+    CHECK_EQUAL(writer->getSkippedCount(), 11ULL);
+    writer->close();
+    delete writer;
+    TraceReader keyReader;
+    CHECK(keyReader.open("RoundTripTest-ring.scnb"));
+    size_t properties = 0;
+    while (keyReader.next(record)){
+        if (record.kind == RECORD_EVENT) properties = record.properties.size();
+    }
+    CHECK(keyReader.getError().empty());
+    CHECK_EQUAL(properties, (size_t)FLIGHT_KEYS);
+    remove("RoundTripTest-ring.scnb");
+}
+
+#pragma mark -
+#pragma mark Chrome JSON
+
+//Just enough of a JSON parser to tell whether the text is valid
+class JsonChecker{
+public:
+    JsonChecker(const string &text){ pos = text.data(); end = pos + text.size(); }
+    bool check(){
+        if (!value()) return false;
+        space();
+        return pos == end;
+    }
+protected:
+    const char *pos, *end;
+    void space(){ while (pos < end && (*pos == ' ' || *pos == '\n' || *pos == '\r' || *pos == '\t')) pos++; }
+    bool literal(const char *word){
+        size_t length = strlen(word);
+        if ((size_t)(end - pos) < length || strncmp(pos, word, length) != 0) return false;
+        pos += length;
+        return true;
+    }
+    bool string(){
+        if (pos >= end || *pos != '"') return false;
+        for (pos++; pos < end; pos++){
+            if (*pos == '"'){ pos++; return true; }
+            if ((unsigned char)*pos < 0x20) return false;
+            if (*pos == '\\') pos++;
+        }
+        return false;
+    }
+    bool number(){
+        const char *start = pos;
+        if (pos < end && *pos == '-') pos++;
+        while (pos < end && (isdigit((unsigned char)*pos) || *pos == '.' || *pos == 'e' || *pos == 'E' || *pos == '+' || *pos == '-')) pos++;
+        return pos > start && isdigit((unsigned char)pos[-1]);
+    }
+    bool value(){
+        space();
+        if (pos >= end) return false;
+        switch (*pos){
+            case '{': return members('}', true);
+            case '[': return members(']', false);
+            case '"': return string();
+            case 't': return literal("true");
+            case 'f': return literal("false");
+            case 'n': return literal("null");
+            default: return number();
+        }
+    }
+    bool members(char close, bool object){
+        pos++;
+        space();
+        if (pos < end && *pos == close){ pos++; return true; }
+        while (true){
+            if (object){
+                space();
+                if (!string()) return false;
+                space();
+                if (pos >= end || *pos++ != ':') return false;
+            }
+            if (!value()) return false;
+            space();
+            if (pos >= end) return false;
+            if (*pos == close){ pos++; return true; }
+            if (*pos++ != ',') return false;
+        }
+    }
+};
+
+static int countOf(const string &text, const string &what){
+    int count = 0;
+    for (size_t pos = text.find(what); pos != string::npos; pos = text.find(what, pos + 1)) count++;
+    return count;
+}
+
+static void testChrome(){
+    CHECK(writeFile(new ChromeTraceWriter(), "RoundTripTest.json"));
+    string text = readFile("RoundTripTest.json");
+    CHECK(JsonChecker(text).check());
+    CHECK_EQUAL(countOf(text, "\"ph\":\"X\""), EVENTS);
+    CHECK_EQUAL(countOf(text, "\"ph\":\"C\""), CHANGES);
+    //Three events per trace, joined by two arrows with both ends written
+    CHECK_EQUAL(countOf(text, "\"ph\":\"s\""), TRACES * 2);
+    CHECK_EQUAL(countOf(text, "\"ph\":\"f\""), TRACES * 2);
+    CHECK_EQUAL(countOf(text, "\"trace properties\""), TRACES);
+    //A child link before the trace's first event becomes a property of the
+    //trace, later links are instants
+    CHECK_EQUAL(countOf(text, "\"parent trace\":"), LINKS - LINKS / 2);
+    CHECK_EQUAL(countOf(text, "\"name\":\"child trace\""), 0);
+    CHECK_EQUAL(countOf(text, "\"name\":\"merge trace\""), LINKS / 2);
+    remove("RoundTripTest.json");
+}
+
+//Traces are never retired here.  A trace whose slot a newer one has taken
+//gets no arrow to its next event, one still in its slot does.
+static void testChromeSlots(){
+    ChromeTraceWriter *writer = new ChromeTraceWriter();
+    CHECK(writer->open("RoundTripTest-slots.json"));
+    writer->beginModule(1, "top");
+    writer->endModule();
+    writer->beginEventType(1, "Request");
+    writer->endEventType();
+    int traces = (int)CHROME_TRACE_SLOTS + 1;
+    for (int id = 1; id <= traces; id++){
+        writer->beginTrace(id, "T");
+        writer->endTrace();
+        writer->beginEvent(1, id, 1, id);
+        writer->endEvent();
+    }
+    writer->beginEvent(1, 1, 1, traces + 1);
+    writer->endEvent();
+    writer->beginEvent(1, 2, 1, traces + 2);
+    writer->endEvent();
+    writer->close();
+    delete writer;
+    string text = readFile("RoundTripTest-slots.json");
+    CHECK(JsonChecker(text).check());
+    CHECK_EQUAL(countOf(text, "\"trace properties\""), traces);
+    CHECK_EQUAL(countOf(text, "\"ph\":\"s\""), 1);
+    CHECK_EQUAL(countOf(text, "\"ph\":\"f\""), 1);
+    remove("RoundTripTest-slots.json");
+}
+
+int sc_main(int, char *[]){
+    CHECK(writeFile(new XmlTraceWriter(), "RoundTripTest.scnx"));
+    //An entry for every event, so the index sees the times out of order
+    CHECK(writeFile(new BinaryTraceWriter(), "RoundTripTest.scnb", 1));
+    testContents("RoundTripTest.scnx", false);
+    testContents("RoundTripTest.scnb", true);
+
+    vector<string> xml, binary;
+    CHECK(readLines("RoundTripTest.scnx", xml));
+    CHECK(readLines("RoundTripTest.scnb", binary));
+    CHECK(sameLines(binary, xml, "Binary trace"));
+    //Integer times and the later elements come with a newer DTD version
+    CHECK(readFile("RoundTripTest.scnx").find("DTD Scansion Tracefile version 0.8//EN") != string::npos);
+    //Blobs show as one hex number, last byte first, as payload data always has
+    CHECK_EQUAL(countOf(readFile("RoundTripTest.scnx"), "<property name=\"Data\" value=\"0x0F00ADDE\"/>"), TRACES);
+    testIndex("RoundTripTest.scnb");
+    testParallel("RoundTripTest.scnb");
+    testParallel("RoundTripTest.scnx");
+    testFlightRecorder(binary);
+
+#ifdef LPTRACE_ZLIB
+    vector<string> lines;
+    CHECK(writeFile(new XmlTraceWriter(true), "RoundTripTest-z.scnx"));
+    CHECK(readLines("RoundTripTest-z.scnx", lines, 4));
+    CHECK(sameLines(lines, xml, "Compressed XML trace"));
+    CHECK(writeFile(new BinaryTraceWriter(true), "RoundTripTest-z.scnb", 64));
+    CHECK(readLines("RoundTripTest-z.scnb", lines));
+    CHECK(sameLines(lines, xml, "Compressed binary trace"));
+    testIndex("RoundTripTest-z.scnb");
+    remove("RoundTripTest-z.scnx");
+    remove("RoundTripTest-z.scnb");
+    remove("RoundTripTest-z.scnb.idx");
+#endif
+
+    testChrome();
+    testChromeSlots();
+    remove("RoundTripTest.scnx");
+    remove("RoundTripTest.scnb");
+    remove("RoundTripTest.scnb.idx");
+    return testResult("RoundTripTest");
+}
@@ -0,0 +1,180 @@
+/*
+ *  SamplingTest.cpp
+ *  LPTracer
+ *
+ *  http://www.logicpoet.com
+ *
+ *  Copyright 2008 Logic Poet. All rights reserved.
+ *
+ *  The MIT License
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without
+ *  restriction, including without limitation the rights to use,
+ *  copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following
+ *  conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *  OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+//Checks trace sampling through the trace file a Tracer writes: the same seed
+//records the same traces in any Tracer, another seed records others, about
+//one in rate traces are kept, SAMPLE_EVERY_NTH keeps exactly the first and
+//every Nth after it, and child and merged traces follow their parents.
+//
+//Links with SystemC, the Tracer and the reader library:
+//  g++ -O2 -I$SYSTEMC_HOME/include -I../source -I../reader SamplingTest.cpp ../source/Tracer.cpp ../source/TraceWriter.cpp ../source/TraceFile.cpp ../source/TraceIndex.cpp ../reader/TraceReader.cpp -L$SYSTEMC_HOME/lib-linux64 -lsystemc -lpthread -o SamplingTest && ./SamplingTest
+
+#include "Tracer.h"
+#include "TraceReader.h"
+#include "TestCheck.h"
+#include <set>
+#include <cstdio>
+
+using namespace lpt;
+using std::set;
+
+static const char *FILENAME = "SamplingTest.scnb";
+static const int TRACES = 8000;
+
+struct Bus : sc_module{
+    Bus(sc_module_name name) : sc_module(name) {}
+};
+
+//Names of the traces in the file.  Every event must belong to one of them,
+//so a trace that was sampled out cannot leave events behind.
+static set<string> readTraceNames(const string &filename, int *events = 0){
+    set<string> names;
+    if (events) *events = 0;
+    TraceReader reader;
+    CHECK(reader.open(filename));
+    TraceRecord record;
+    bool eventsRecorded = true;
+    while (reader.next(record)){
+        if (record.kind == RECORD_TRACE) names.insert(record.name.str());
+        if (record.kind != RECORD_EVENT) continue;
+        eventsRecorded = eventsRecorded && reader.getTrace(record.traceId);
+        if (events) (*events)++;
+    }
+    CHECK(reader.getError().empty());
+    CHECK(eventsRecorded);
+    remove(filename.c_str());
+    return names;
+}
+
+static string traceName(char prefix, int i){
+    char name[16];
+    snprintf(name, sizeof(name), "%c%d", prefix, i);
+    return name;
+}
+
+//Marks TRACES traces named T0, T1, ... with a Tracer sampling as given
+static set<string> sample(Bus &bus, unsigned int rate, SampleMode mode, unsigned int seed){
+    Tracer *tracer = new Tracer((char *)FILENAME);
+    tracer->setSampling(rate, mode, seed);
+    for (int i = 0; i < TRACES; i++){
+        Trace trace(traceName('T', i));
+        tracer->mark(&bus, &trace, "Request");
+        tracer->mark(&bus, &trace, "Response");
+        tracer->retireTrace(&trace);
+    }
+    delete tracer;
+    return readTraceNames(FILENAME);
+}
+
+#pragma mark -
+#pragma mark Tests
+
+static void testHashed(Bus &bus){
+    set<string> first = sample(bus, 8, SAMPLE_HASHED, 0);
+    CHECK(first == sample(bus, 8, SAMPLE_HASHED, 0));
+    CHECK(first != sample(bus, 8, SAMPLE_HASHED, 1));
+    //8000 / 8 is 1000, give or take 5 standard deviations
+    CHECK(first.size() > 850 && first.size() < 1150);
+    set<string> seeded = sample(bus, 8, SAMPLE_HASHED, 7);
+    CHECK(seeded.size() > 850 && seeded.size() < 1150);
+    CHECK(seeded == sample(bus, 8, SAMPLE_HASHED, 7));
+}
+
+static void testEveryNth(Bus &bus){
+    set<string> expected;
+    for (int i = 0; i < TRACES; i += 5) expected.insert(traceName('T', i));
+    CHECK(sample(bus, 5, SAMPLE_EVERY_NTH, 0) == expected);
+    //The seed only picks a hashed subset
+    CHECK(sample(bus, 5, SAMPLE_EVERY_NTH, 3) == expected);
+}
+
+//Payloads keep the decision in their TraceIdExtension rather than on a Trace
+static void testPayloads(Bus &bus){
+    Tracer *tracer = new Tracer((char *)FILENAME);
+    tracer->setSampling(5, SAMPLE_EVERY_NTH);
+    for (int i = 0; i < TRACES; i++){
+        tlm::tlm_generic_payload payload;
+        tracer->mark(&bus, &payload, "Request");
+        tracer->mark(&bus, &payload, "Response");
+        tracer->retireTrace(&payload);
+    }
+    delete tracer;
+    int events;
+    CHECK_EQUAL(readTraceNames(FILENAME, &events).size(), (size_t)(TRACES / 5));
+    CHECK_EQUAL(events, TRACES / 5 * 2);
+}
+
+static void testEverything(Bus &bus){
+    CHECK_EQUAL(sample(bus, 1, SAMPLE_HASHED, 0).size(), (size_t)TRACES);
+    CHECK_EQUAL(sample(bus, 0, SAMPLE_HASHED, 0).size(), (size_t)TRACES);
+}
+
+//A child is recorded exactly when its parent is.  A trace merged from a
+//recorded trace is recorded too, whatever its own sample would have been.
+static void testRelatedTraces(Bus &bus){
+    Tracer *tracer = new Tracer((char *)FILENAME);
+    tracer->setSampling(4, SAMPLE_HASHED, 0);
+    for (int i = 0; i < TRACES; i++){
+        Trace parent(traceName('P', i)), child(traceName('C', i)), merged(traceName('M', i));
+        tracer->mark(&bus, &parent, "Request");
+        tracer->addChildTrace(&parent, &child);
+        tracer->mark(&bus, &child, "Request");
+        tracer->mergeTrace(&merged, &parent);
+        tracer->mark(&bus, &merged, "Response");
+        tracer->retireTrace(&parent);
+        tracer->retireTrace(&child);
+        tracer->retireTrace(&merged);
+    }
+    delete tracer;
+    set<string> names = readTraceNames(FILENAME);
+    int parents = 0;
+    bool childrenFollow = true, mergesFollow = true;
+    for (int i = 0; i < TRACES; i++){
+        bool parent = names.count(traceName('P', i)) > 0;
+        if (parent) parents++;
+        childrenFollow = childrenFollow && parent == (names.count(traceName('C', i)) > 0);
+        mergesFollow = mergesFollow && (!parent || names.count(traceName('M', i)) > 0);
+    }
+    CHECK(parents > 0 && parents < TRACES);
+    CHECK(childrenFollow);
+    CHECK(mergesFollow);
+}
+
+int sc_main(int, char *[]){
+    Bus bus("bus");
+    testHashed(bus);
+    testEveryNth(bus);
+    testPayloads(bus);
+    testEverything(bus);
+    testRelatedTraces(bus);
+    return testResult("SamplingTest");
+}
@@ -0,0 +1,56 @@
+/*
+ *  TestCheck.h
+ *  LPTracer
+ *
+ *  http://www.logicpoet.com
+ *
+ *  Copyright 2008 Logic Poet. All rights reserved.
+ *
+ *  The MIT License
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without
+ *  restriction, including without limitation the rights to use,
+ *  copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following
+ *  conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *  OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _LPT_TEST_CHECK_H_
+#define _LPT_TEST_CHECK_H_
+
+#include <cstdio>
+
+//Minimal checks for the tests in this directory.  A failed CHECK prints where
+//it failed and the test goes on, so one run shows every failure.  main returns
+//testResult(), which is 0 only if every check passed.
+static int testChecks = 0;
+static int testFailures = 0;
+
+#define CHECK(condition) do { testChecks++; if (!(condition)){ testFailures++; \
+    printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); } } while (0)
+
+#define CHECK_EQUAL(actual, expected) do { testChecks++; if (!((actual) == (expected))){ testFailures++; \
+    printf("%s:%d: %s is not %s\n", __FILE__, __LINE__, #actual, #expected); } } while (0)
+
+static int testResult(const char *name){
+    if (testFailures) printf("%s: %d of %d checks failed\n", name, testFailures, testChecks);
+    else printf("%s: all %d checks passed\n", name, testChecks);
+    return testFailures ? 1 : 0;
+}
+
+#endif
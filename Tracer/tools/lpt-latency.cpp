@@ -0,0 +1,178 @@
+/*
+ *  lpt-latency.cpp
+ *  LPTracer
+ *
+ *  http://www.logicpoet.com
+ *
+ *  Copyright 2008 Logic Poet. All rights reserved.
+ *
+ *  The MIT License
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without
+ *  restriction, including without limitation the rights to use,
+ *  copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following
+ *  conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *  OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+//Prints latency percentiles for spans between pairs of events on the same
+//trace, grouped by module and property:
+//  lpt-latency [options] tracefile
+//    -s, --span START END  a span from START to END events (* and ? wildcards),
+//                          can be repeated
+//    -v, --via PATTERN     keep the module of this event within the last span
+//    -g, --group LIST      group by modules: comma separated start, end, via
+//    -p, --property NAME   group by a property of the start event or its trace
+//    -u, --unit UNIT       s, ms, us, ns (default) or ps
+//    --histogram           print the distribution of every group as well
+//    --live N              traces kept for open spans (default 1048576)
+//For the at_1_phase example, request to response latency per initiator and
+//target:
+//  lpt-latency -s "Initiator FW: Send BEGIN_REQ" "Initiator BW: Receive BEGIN_RESP"
+//              -v "Target FW: Receive BEGIN_REQ" -g start,via at_1_phase.scnx
+//
+//This does not need SystemC.  Build with:
+//  g++ -O2 -I../source -I../reader lpt-latency.cpp ../reader/TraceReader.cpp ../reader/TraceQuery.cpp ../reader/IndexReader.cpp ../reader/LatencyAnalyzer.cpp -o lpt-latency
+//Add -DLPTRACE_ZLIB and -lz to read compressed traces.
+
+#include "LatencyAnalyzer.h"
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+using namespace lpt;
+
+static void usage(){
+    cerr << "usage: lpt-latency -s start end [-v via] [-s start end ...] [-g start,end,via] [-p property]" << endl;
+    cerr << "                   [-u unit] [--histogram] [--live count] tracefile" << endl;
+}
+
+static void printHistogram(const LatencyHistogram &histogram, double scale, const string &unit){
+    //One row per power of two of ticks
+    vector<unsigned long long> octaves;
+    for (size_t i = 0; i < histogram.getBucketCount(); i++){
+        unsigned long long low = histogram.getBucketLow(i);
+        size_t octave = 0;
+        while ((low >> octave) > 1) octave++;
+        if (low == 0) octave = 0;
+        if (octaves.size() <= octave) octaves.resize(octave + 1, 0);
+        octaves[octave] += histogram.getBucketValueCount(i);
+    }
+    unsigned long long most = 0;
+    for (size_t i = 0; i < octaves.size(); i++){
+        if (octaves[i] > most) most = octaves[i];
+    }
+    size_t first = 0;
+    while (first < octaves.size() && !octaves[first]) first++;
+    for (size_t i = first; i < octaves.size(); i++){
+        double low = (i == 0) ? 0 : (double)(1ULL << i) * scale;
+        double high = (double)(2ULL << i) * scale;
+        int bar = most ? (int)(octaves[i] * 50 / most) : 0;
+        cout << "    [" << setw(12) << low << ", " << setw(12) << high << ") " << unit << " " << setw(12) << octaves[i] << " " << string(bar, '#') << '\n';
+    }
+}
+
+int main(int argc, char **argv){
+    LatencyAnalyzer analyzer;
+    string filename, unit = "ns";
+    bool histograms = false;
+    int spanCount = 0;
+    vector<string> starts, ends, vias;
+    for (int i = 1; i < argc; i++){
+        string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if ((arg == "-s" || arg == "--span") && i + 2 < argc){
+            starts.push_back(argv[i+1]);
+            ends.push_back(argv[i+2]);
+            vias.push_back("");
+            i += 2;
+        }
+        else if ((arg == "-v" || arg == "--via") && hasValue && !vias.empty()) vias.back() = argv[++i];
+        else if ((arg == "-g" || arg == "--group") && hasValue){
+            string list = string(",") + argv[++i] + ",";
+            analyzer.setGroupModules(list.find(",start,") != string::npos, list.find(",end,") != string::npos,
+                                     list.find(",via,") != string::npos);
+        }
+        else if ((arg == "-p" || arg == "--property") && hasValue) analyzer.setGroupProperty(argv[++i]);
+        else if ((arg == "-u" || arg == "--unit") && hasValue) unit = argv[++i];
+        else if (arg == "--histogram") histograms = true;
+        else if (arg == "--live" && hasValue) analyzer.setMaxLiveTraces((unsigned int)strtoul(argv[++i], 0, 10));
+        else if (arg[0] != '-' && filename.empty()) filename = arg;
+        else {
+            usage();
+            return 2;
+        }
+    }
+    if (filename.empty() || starts.empty()){
+        usage();
+        return 2;
+    }
+    for (size_t i = 0; i < starts.size(); i++){
+        analyzer.addSpan(starts[i] + " -> " + ends[i], starts[i], ends[i], vias[i]);
+        spanCount++;
+    }
+    double unitSeconds;
+    if (unit == "s") unitSeconds = 1;
+    else if (unit == "ms") unitSeconds = 1e-3;
+    else if (unit == "us") unitSeconds = 1e-6;
+    else if (unit == "ns") unitSeconds = 1e-9;
+    else if (unit == "ps") unitSeconds = 1e-12;
+    else {
+        cerr << "Unknown unit " << unit << endl;
+        return 2;
+    }
+
+    TraceReader reader;
+    if (!reader.open(filename)){
+        cerr << reader.getError() << endl;
+        return 1;
+    }
+    if (!analyzer.analyze(reader)){
+        cerr << analyzer.getError() << endl;
+        return 1;
+    }
+
+    double scale = reader.getResolution() / unitSeconds;
+    const vector<LatencyAnalyzer::Group> &groups = analyzer.getGroups();
+    for (int span = 0; span < spanCount; span++){
+        cout << analyzer.getSpanName(span) << "  (" << unit << ")\n";
+        cout << left << setw(40) << "  group" << right;
+        const char *columns[] = {"count", "min", "mean", "p50", "p90", "p99", "p99.9", "max", 0};
+        for (int c = 0; columns[c]; c++) cout << setw(12) << columns[c];
+        cout << '\n';
+        for (size_t i = 0; i < groups.size(); i++){
+            if (groups[i].span != span) continue;
+            const LatencyHistogram &histogram = groups[i].histogram;
+            cout << "  " << left << setw(38) << analyzer.getGroupName(groups[i], reader) << right;
+            cout << setw(12) << histogram.getCount();
+            cout << setw(12) << histogram.getMin() * scale;
+            cout << setw(12) << histogram.getMean() * scale;
+            cout << setw(12) << histogram.getPercentile(50) * scale;
+            cout << setw(12) << histogram.getPercentile(90) * scale;
+            cout << setw(12) << histogram.getPercentile(99) * scale;
+            cout << setw(12) << histogram.getPercentile(99.9) * scale;
+            cout << setw(12) << histogram.getMax() * scale << '\n';
+            if (histograms) printHistogram(histogram, scale, unit);
+        }
+        cout << '\n';
+    }
+    cout << "Unfinished spans: " << analyzer.getUnfinished() << "  dropped: " << analyzer.getDropped() << endl;
+    return 0;
+}
@@ -0,0 +1,156 @@
+/*
+ *  lpt-query.cpp
+ *  LPTracer
+ *
+ *  http://www.logicpoet.com
+ *
+ *  Copyright 2008 Logic Poet. All rights reserved.
+ *
+ *  The MIT License
+ *  Permission is hereby granted, free of charge, to any person
+ *  obtaining a copy of this software and associated documentation
+ *  files (the "Software"), to deal in the Software without
+ *  restriction, including without limitation the rights to use,
+ *  copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following
+ *  conditions:
+ *
+ *  The above copyright notice and this permission notice shall be
+ *  included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *  OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+//Prints or counts the events of a trace file that match a filter:
+//  lpt-query [options] tracefile
+//    -m, --module PATH     events of this module or its children (top.router)
+//    -e, --event PATTERN   event type names, * and ? wildcards
+//    -t, --trace ID        events of this trace (5 or T5)
+//    --from TIME           events at or after TIME, ticks or with a unit (10us)
+//    --to TIME             events at or before TIME
+//    -w, --where EXPR      property predicate: Command==Write && Adress>=0x100
+//    -c, --count           print the number of matches only
+//    -n, --limit N         stop after N matches
+//    --no-index            ignore tracefile.idx
+//Options that take a list (-m, -e, -t) can be repeated.  Matches are printed
+//one per line: time in ticks, module path, event type, trace and properties.
+//Spans print their time as start+duration.
+//
+//This does not need SystemC.  Build with:
+//  g++ -O2 -I../source -I../reader lpt-query.cpp ../reader/TraceReader.cpp ../reader/IndexReader.cpp ../reader/TraceQuery.cpp -o lpt-query
+//Add -DLPTRACE_ZLIB and -lz to read compressed traces.
+
+#include "TraceQuery.h"
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+using namespace lpt;
+
+static void usage(){
+    cerr << "usage: lpt-query [-m module] [-e eventtype] [-t trace] [--from time] [--to time]" << endl;
+    cerr << "                 [-w predicate] [-c] [-n limit] [--no-index] tracefile" << endl;
+}
+
+static int parseTraceId(const char *text){
+    if (*text == 'T') text++;
+    return atoi(text);
+}
+
+int main(int argc, char **argv){
+    TraceQuery query;
+    string filename, fromText, toText, predicate;
+    bool countOnly = false;
+    bool useIndex = true;
+    unsigned long long limit = 0;
+    for (int i = 1; i < argc; i++){
+        string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if ((arg == "-m" || arg == "--module") && hasValue) query.addModule(argv[++i]);
+        else if ((arg == "-e" || arg == "--event") && hasValue) query.addEventType(argv[++i]);
+        else if ((arg == "-t" || arg == "--trace") && hasValue) query.addTrace(parseTraceId(argv[++i]));
+        else if (arg == "--from" && hasValue) fromText = argv[++i];
+        else if (arg == "--to" && hasValue) toText = argv[++i];
+        else if ((arg == "-w" || arg == "--where") && hasValue) predicate = argv[++i];
+        else if ((arg == "-n" || arg == "--limit") && hasValue) limit = strtoull(argv[++i], 0, 10);
+        else if (arg == "-c" || arg == "--count") countOnly = true;
+        else if (arg == "--no-index") useIndex = false;
+        else if (arg[0] != '-' && filename.empty()) filename = arg;
+        else {
+            usage();
+            return 2;
+        }
+    }
+    if (filename.empty()){
+        usage();
+        return 2;
+    }
+    if (!query.setPredicate(predicate)){
+        cerr << query.getError() << endl;
+        return 2;
+    }
+
+    TraceReader reader;
+    if (!reader.open(filename)){
+        cerr << reader.getError() << endl;
+        return 1;
+    }
+    //Times with units need the file's resolution
+    unsigned long long from = 0, to = ~0ULL;
+    if (!fromText.empty() && !parseTraceTime(fromText, reader.getResolution(), from)){
+        cerr << "Bad time " << fromText << endl;
+        return 2;
+    }
+    if (!toText.empty() && !parseTraceTime(toText, reader.getResolution(), to)){
+        cerr << "Bad time " << toText << endl;
+        return 2;
+    }
+    query.setTimeWindow(from, to);
+    IndexReader index;
+    bool hasIndex = useIndex && index.open(filename + ".idx");
+    if (!query.start(reader, hasIndex ? &index : 0)){
+        cerr << query.getError() << endl;
+        return 1;
+    }
+
+    unsigned long long matches = 0;
+    vector<string> modulePaths;
+    TraceRecord record;
+    while ((limit == 0 || matches < limit) && query.next(record)){
+        matches++;
+        if (countOnly) continue;
+        if (modulePaths.size() <= (size_t)record.moduleId) modulePaths.resize(record.moduleId + 1);
+        string &path = modulePaths[record.moduleId];
+        if (path.empty()) path = reader.getModulePath(record.moduleId);
+        const EventTypeInfo *type = reader.getEventType(record.eventTypeId);
+        const TraceInfo *trace = reader.getTrace(record.traceId);
+        cout << record.time;
+        if (record.span) cout << '+' << record.duration;
+        cout << '\t' << path << '\t';
+        if (type) cout << type->name.str();
+        else cout << 'E' << record.eventTypeId;
+        cout << '\t';
+        if (trace) cout << trace->name.str();
+        else cout << 'T' << record.traceId;
+        for (size_t i = 0; i < record.properties.size(); i++){
+            cout << '\t' << record.properties[i].name.str() << '=' << record.properties[i].toString();
+        }
+        cout << '\n';
+    }
+    if (!query.getError().empty()){
+        cerr << query.getError() << endl;
+        return 1;
+    }
+    if (countOnly) cout << matches << endl;
+    return 0;
+}